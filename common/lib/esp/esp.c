@@ -47,7 +47,7 @@
 static espr_t           def_callback(esp_evt_t* evt);
 static esp_evt_func_t   def_evt_link;
 
-esp_t esp;
+esp_t esp ESP_CFG_MEM_CPU_ATTR;
 
 /**
  * \brief           Default callback function for events
@@ -80,13 +80,24 @@ esp_init(esp_evt_fn evt_func, const uint32_t blocking) {
     memset(&esp, 0x00, sizeof(esp));
     esp.status.f.initialized = 0;               /* Clear possible init flag */
     def_evt_link.fn = evt_func != NULL ? evt_func : def_callback;
+    def_evt_link.mask = ESP_EVT_MASK_ALL;       /* Default callback gets all events */
     esp.evt_func = &def_evt_link;               /* Set callback function */
     esp.evt_server = NULL;                      /* Set default server callback function */
+    esp.conn_poll_interval = ESP_CFG_CONN_POLL_INTERVAL;    /* Set default poll tick interval */
 
     if (!esp_sys_init()) {                      /* Init low-level system */
         goto cleanup;
     }
 
+    /* Core domain uses system protection, other domains have own mutex */
+    for (size_t i = ESP_LOCK_CORE + 1; i < ESP_LOCK_END; ++i) {
+        if (!esp_sys_mutex_create(&esp.locks[i].mutex)) {
+            ESP_DEBUGF(ESP_CFG_DBG_INIT | ESP_DBG_LVL_SEVERE | ESP_DBG_TYPE_TRACE,
+                "[CORE] Cannot allocate lock mutex!\r\n");
+            goto cleanup;
+        }
+    }
+
     if (!esp_sys_sem_create(&esp.sem_sync, 1)) {/* Create sync semaphore between threads */
         ESP_DEBUGF(ESP_CFG_DBG_INIT | ESP_DBG_LVL_SEVERE | ESP_DBG_TYPE_TRACE,
             "[CORE] Cannot allocate sync semaphore!\r\n");
@@ -112,6 +123,14 @@ esp_init(esp_evt_fn evt_func, const uint32_t blocking) {
      * This is to make sure threads start immediately after they are created
      */
     esp_sys_sem_wait(&esp.sem_sync, 0);         /* Lock semaphore */
+#if ESP_CFG_SINGLE_THREAD
+    if (!esp_sys_thread_create(&esp.thread_produce, "esp_single", esp_thread_single, &esp.sem_sync, ESP_CFG_SINGLE_THREAD_SS, ESP_SYS_THREAD_PRIO)) {
+        ESP_DEBUGF(ESP_CFG_DBG_INIT | ESP_DBG_LVL_SEVERE | ESP_DBG_TYPE_TRACE,
+            "[CORE] Cannot create stack thread!\r\n");
+        esp_sys_sem_release(&esp.sem_sync);     /* Release semaphore and return */
+        goto cleanup;
+    }
+#else /* ESP_CFG_SINGLE_THREAD */
     if (!esp_sys_thread_create(&esp.thread_produce, "esp_produce", esp_thread_produce, &esp.sem_sync, ESP_SYS_THREAD_SS, ESP_SYS_THREAD_PRIO)) {
         ESP_DEBUGF(ESP_CFG_DBG_INIT | ESP_DBG_LVL_SEVERE | ESP_DBG_TYPE_TRACE,
             "[CORE] Cannot create producing thread!\r\n");
@@ -126,7 +145,8 @@ esp_init(esp_evt_fn evt_func, const uint32_t blocking) {
         esp_sys_sem_release(&esp.sem_sync);     /* Release semaphore and return */
         goto cleanup;
     }
-    esp_sys_sem_wait(&esp.sem_sync, 0);         /* Wait semaphore, should be unlocked in produce thread */
+#endif /* !ESP_CFG_SINGLE_THREAD */
+    esp_sys_sem_wait(&esp.sem_sync, 0);         /* Wait semaphore, should be unlocked in last created thread */
     esp_sys_sem_release(&esp.sem_sync);         /* Release semaphore manually */
 
     esp_core_lock();
@@ -350,8 +370,7 @@ esp_update_sw(const esp_api_cmd_evt_fn evt_fn, void* const evt_arg, const uint32
  */
 espr_t
 esp_core_lock(void) {
-    esp_sys_protect();
-    ++esp.locked_cnt;
+    espi_lock(ESP_LOCK_CORE);
     return espOK;
 }
 
@@ -367,11 +386,115 @@ esp_core_lock(void) {
  */
 espr_t
 esp_core_unlock(void) {
-    --esp.locked_cnt;
-    esp_sys_unprotect();
+    espi_unlock(ESP_LOCK_CORE);
+    return espOK;
+}
+
+/**
+ * \brief           Acquire lock domain
+ *
+ * Locks are recursive. Before domain mutex is created, function does nothing,
+ * as stack is not yet used by multiple threads at that point
+ *
+ * \param[in]       id: Lock domain
+ */
+void
+espi_lock(esp_lock_id_t id) {
+    esp_lock_t* l = &esp.locks[id];
+    esp_sys_thread_t self;
+#if ESP_CFG_LOCK_STAT
+    uint32_t time = 0, wait;
+    uint8_t contended;
+#endif /* ESP_CFG_LOCK_STAT */
+
+    if (id != ESP_LOCK_CORE && !esp_sys_mutex_isvalid(&l->mutex)) {
+        return;
+    }
+    self = esp_sys_thread_get_id();
+#if ESP_CFG_LOCK_STAT
+    contended = l->cnt > 0 && l->owner != self; /* Snapshot only, exact value is not required */
+    if (contended) {
+        time = esp_sys_now();
+    }
+#endif /* ESP_CFG_LOCK_STAT */
+
+    if (id == ESP_LOCK_CORE) {
+        esp_sys_protect();
+    } else {
+        esp_sys_mutex_lock(&l->mutex);
+    }
+    l->owner = self;
+    ++l->cnt;
+
+#if ESP_CFG_LOCK_STAT
+    ++l->stat.acquired;
+    if (contended) {
+        wait = esp_sys_now() - time;
+        ++l->stat.contended;
+        l->stat.wait_total += wait;
+        if (wait > l->stat.wait_max) {
+            l->stat.wait_max = wait;
+        }
+    }
+#endif /* ESP_CFG_LOCK_STAT */
+}
+
+/**
+ * \brief           Release lock domain acquired with \ref espi_lock
+ * \param[in]       id: Lock domain
+ */
+void
+espi_unlock(esp_lock_id_t id) {
+    esp_lock_t* l = &esp.locks[id];
+
+    if (id != ESP_LOCK_CORE && !esp_sys_mutex_isvalid(&l->mutex)) {
+        return;
+    }
+    if (--l->cnt == 0) {
+        l->owner = NULL;
+    }
+    if (id == ESP_LOCK_CORE) {
+        esp_sys_unprotect();
+    } else {
+        esp_sys_mutex_unlock(&l->mutex);
+    }
+}
+
+/**
+ * \brief           Check if current thread holds lock domain
+ *
+ * Function does not lock. Result is exact for current thread,
+ * as only owner thread changes owner while it holds the lock
+ *
+ * \param[in]       id: Lock domain
+ * \return          `1` if current thread holds the lock, `0` otherwise
+ */
+uint8_t
+espi_lock_is_owner(esp_lock_id_t id) {
+    return esp.locks[id].cnt > 0 && esp.locks[id].owner == esp_sys_thread_get_id();
+}
+
+#if ESP_CFG_LOCK_STAT || __DOXYGEN__
+
+/**
+ * \brief           Get lock contention statistics
+ * \param[in]       id: Lock domain
+ * \param[out]      stat: Pointer to output statistics structure
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_lock_get_stat(esp_lock_id_t id, esp_lock_stat_t* stat) {
+    ESP_ASSERT("id < ESP_LOCK_END", id < ESP_LOCK_END);
+    ESP_ASSERT("stat != NULL", stat != NULL);
+
+    espi_lock(id);
+    *stat = esp.locks[id].stat;
+    espi_unlock(id);
     return espOK;
 }
 
+#endif /* ESP_CFG_LOCK_STAT || __DOXYGEN__ */
+
 /**
  * \brief           Notify stack if device is present or not
  *
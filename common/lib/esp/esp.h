@@ -60,6 +60,9 @@ espr_t      esp_update_sw(const esp_api_cmd_evt_fn evt_fn, void* const evt_arg,
 
 espr_t      esp_core_lock(void);
 espr_t      esp_core_unlock(void);
+#if ESP_CFG_LOCK_STAT || __DOXYGEN__
+espr_t      esp_lock_get_stat(esp_lock_id_t id, esp_lock_stat_t* stat);
+#endif /* ESP_CFG_LOCK_STAT || __DOXYGEN__ */
 
 espr_t      esp_device_set_present(uint8_t present, const esp_api_cmd_evt_fn evt_fn, void* const evt_arg, const uint32_t blocking);
 uint8_t     esp_device_is_present(void);
@@ -0,0 +1,364 @@
+/**
+ * \file            esp_async.c
+ * \brief           Asynchronous connection API
+ */
+
+/*
+ * Copyright (c) 2018 Tilen Majerle
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE
+ * AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of ESP-AT library.
+ *
+ * Author:          Tilen MAJERLE <tilen@majerle.eu>
+ */
+#include "esp/esp_async.h"
+#include "esp/esp_private.h"
+#include "esp/esp_conn.h"
+#include "esp/esp_mem.h"
+
+#if ESP_CFG_ASYNC || __DOXYGEN__
+
+/**
+ * \brief           Queued connection event
+ */
+typedef struct {
+    esp_evt_type_t type;                        /*!< Event type */
+    esp_conn_p conn;                            /*!< Connection handle */
+    const esp_async_handler_t* h;               /*!< Connection handler at the time of event */
+    esp_pbuf_p pbuf;                            /*!< Received data for \ref ESP_EVT_CONN_RECV */
+    size_t len;                                 /*!< Sent length for \ref ESP_EVT_CONN_SEND */
+    espr_t res;                                 /*!< Event result */
+    uint8_t forced;                             /*!< Forced flag for \ref ESP_EVT_CONN_CLOSE */
+} async_evt_t;
+
+static async_evt_t evts[ESP_CFG_ASYNC_QUEUE_LEN];   /*!< Event ring buffer */
+static size_t evts_w, evts_r;                   /*!< Ring buffer write and read indexes */
+static esp_sys_mbox_t evts_mbox;                /*!< One entry per queued event, used to wake up event loop */
+static const esp_async_handler_t* listener;     /*!< Handler for connections accepted by server */
+static size_t sends;                            /*!< Sends queued to stack with event slot reserved */
+static uint8_t opened[ESP_CFG_MAX_CONNS];       /*!< Connections with event slot reserved for close */
+static size_t opened_cnt;                       /*!< Number of set entries in \ref opened */
+
+/**
+ * \brief           Get number of free ring entries not reserved for send and close events
+ * \note            Called with core locked
+ * \return          Number of entries available to other events
+ */
+static size_t
+async_evt_free(void) {
+    size_t used = (evts_w + ESP_CFG_ASYNC_QUEUE_LEN - evts_r) % ESP_CFG_ASYNC_QUEUE_LEN;
+    size_t res = sends + opened_cnt;
+
+    return ESP_CFG_ASYNC_QUEUE_LEN - 1 - used > res ? ESP_CFG_ASYNC_QUEUE_LEN - 1 - used - res : 0;
+}
+
+/**
+ * \brief           Queue event for event loop
+ *
+ * Send and close events use entry reserved for them when send was queued
+ * or connection became active, so they are never dropped.
+ * Other events only use entries left after reservations.
+ *
+ * \note            Called from ESP processing thread with core locked
+ * \param[in]       e: Event to queue
+ * \param[in]       reserved: Set to `1` if entry was reserved for this event
+ * \return          `1` on success, `0` if queue is full
+ */
+static uint8_t
+async_evt_put(const async_evt_t* e, uint8_t reserved) {
+    size_t w = (evts_w + 1) % ESP_CFG_ASYNC_QUEUE_LEN;
+
+    if (w == evts_r || (!reserved && async_evt_free() == 0) || !esp_sys_mbox_isvalid(&evts_mbox)) {
+        ESP_DEBUGF(ESP_CFG_DBG_CONN | ESP_DBG_LVL_WARNING,
+            "[ASYNC] Event queue full, dropping event %d\r\n", (int)e->type);
+        return 0;
+    }
+    evts[evts_w] = *e;
+    evts_w = w;
+    esp_sys_mbox_putnow(&evts_mbox, NULL);      /* Wake up event loop */
+    return 1;
+}
+
+/**
+ * \brief           Connection callback, executed in ESP processing thread
+ * \param[in]       evt: Event information
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+static espr_t
+async_conn_evt(esp_evt_t* evt) {
+    async_evt_t e = {0};
+    uint8_t reserved;
+    int8_t num;
+
+    e.type = esp_evt_get_type(evt);
+    switch (e.type) {
+        case ESP_EVT_CONN_ACTIVE: {
+            e.conn = esp_conn_get_from_evt(evt);
+            if (!esp_evt_conn_active_is_client(evt)) {  /* Connection accepted by server */
+                esp_conn_set_arg(e.conn, (void *)listener);
+            }
+            e.h = esp_conn_get_arg(e.conn);
+            num = esp_conn_getnum(e.conn);
+
+            /* Reserve entry for close event together with this one */
+            if (e.h == NULL || num < 0 || opened[num] || async_evt_free() < 2) {
+                esp_conn_close(e.conn, 0);      /* Nobody can handle it */
+                break;
+            }
+            opened[num] = 1;
+            ++opened_cnt;
+            async_evt_put(&e, 0);
+            break;
+        }
+        case ESP_EVT_CONN_ERROR: {
+            e.h = esp_evt_conn_error_get_arg(evt);
+            e.res = esp_evt_conn_error_get_error(evt);
+            if (e.h != NULL) {
+                async_evt_put(&e, 0);
+            }
+            break;
+        }
+        case ESP_EVT_CONN_RECV: {
+            e.conn = esp_conn_get_from_evt(evt);
+            e.h = esp_conn_get_arg(e.conn);
+            e.pbuf = esp_evt_conn_recv_get_buff(evt);
+
+            esp_conn_recved(e.conn, e.pbuf);    /* Notify stack about received data */
+            esp_pbuf_ref(e.pbuf);               /* Keep buffer until dispatched */
+            if (e.h == NULL || !async_evt_put(&e, 0)) {
+                esp_pbuf_free(e.pbuf);
+                return espOKIGNOREMORE;         /* Return OK to free the memory and ignore further data */
+            }
+            break;
+        }
+        case ESP_EVT_CONN_SEND: {
+            e.conn = esp_conn_get_from_evt(evt);
+            e.h = esp_conn_get_arg(e.conn);
+            e.len = esp_evt_conn_send_get_length(evt);
+            e.res = esp_evt_conn_send_get_result(evt);
+
+            /* Every queued send reports exactly one event, even after close */
+            reserved = sends > 0;
+            if (reserved) {
+                --sends;
+            }
+            if (e.h != NULL) {
+                async_evt_put(&e, reserved);
+            }
+            break;
+        }
+        case ESP_EVT_CONN_CLOSE: {
+            e.conn = esp_conn_get_from_evt(evt);
+            e.h = esp_conn_get_arg(e.conn);
+            e.forced = esp_evt_conn_close_is_forced(evt);
+            e.res = esp_evt_conn_close_get_result(evt);
+            num = esp_conn_getnum(e.conn);
+
+            reserved = num >= 0 && opened[num];
+            if (reserved) {
+                opened[num] = 0;
+                --opened_cnt;
+            }
+            if (e.h != NULL) {
+                async_evt_put(&e, reserved);
+            }
+            break;
+        }
+        default: break;
+    }
+    return espOK;
+}
+
+/**
+ * \brief           Initialize asynchronous API
+ * \note            Function must be called before any other asynchronous API function
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_async_init(void) {
+    espr_t res = espOK;
+
+    esp_core_lock();
+    if (!esp_sys_mbox_isvalid(&evts_mbox)) {
+        evts_w = evts_r = 0;
+        sends = opened_cnt = 0;
+        ESP_MEMSET(opened, 0x00, sizeof(opened));
+        if (!esp_sys_mbox_create(&evts_mbox, ESP_CFG_ASYNC_QUEUE_LEN)) {
+            res = espERRMEM;
+        }
+    }
+    esp_core_unlock();
+    return res;
+}
+
+/**
+ * \brief           Start client connection in non-blocking mode
+ *
+ * Result is reported with \ref esp_async_handler_t.connect_fn callback from event loop
+ *
+ * \param[in]       type: Connection type
+ * \param[in]       host: Connection host, domain name or IP address in string format
+ * \param[in]       port: Connection port
+ * \param[in]       h: Connection handler, must stay valid while connection is used
+ * \return          \ref espOK if command was queued, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_async_conn_start(esp_conn_type_t type, const char* const host, esp_port_t port, const esp_async_handler_t* h) {
+    ESP_ASSERT("h != NULL", h != NULL);
+
+    return esp_conn_start(NULL, type, host, port, (void *)h, async_conn_evt, 0);
+}
+
+/**
+ * \brief           Enable server and handle all accepted connections with single handler
+ * \param[in]       port: Port number used to listen on
+ * \param[in]       max_conn: Number of maximal connections populated by server
+ * \param[in]       timeout: Time used to automatically close the connection in units of seconds.
+ *                      Set to `0` to disable timeout feature
+ * \param[in]       h: Handler for accepted connections, must stay valid while server is enabled
+ * \return          \ref espOK if command was queued, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_async_listen(esp_port_t port, uint16_t max_conn, uint16_t timeout, const esp_async_handler_t* h) {
+    ESP_ASSERT("h != NULL", h != NULL);
+
+    esp_core_lock();
+    listener = h;
+    esp_core_unlock();
+    return esp_set_server(1, port, max_conn, timeout, async_conn_evt, NULL, NULL, 0);
+}
+
+/**
+ * \brief           Send data on connection in non-blocking mode
+ *
+ * Completion is reported with \ref esp_async_handler_t.sent_fn callback from event loop
+ *
+ * \note            Data memory must stay valid until sent callback is called
+ * \param[in]       conn: Connection handle
+ * \param[in]       data: Data to send
+ * \param[in]       btw: Number of bytes to send
+ * \return          \ref espOK if command was queued,
+ *                      \ref espERRMEM if event queue has no room left for sent event,
+ *                      member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_async_send(esp_conn_p conn, const void* data, size_t btw) {
+    espr_t res;
+
+    esp_core_lock();
+    if (async_evt_free() == 0) {
+        esp_core_unlock();
+        return espERRMEM;
+    }
+    ++sends;                                    /* Reserve entry for sent event */
+    esp_core_unlock();
+
+    res = esp_conn_send(conn, data, btw, NULL, 0);
+    if (res != espOK) {
+        esp_core_lock();
+        --sends;
+        esp_core_unlock();
+    }
+    return res;
+}
+
+/**
+ * \brief           Close connection in non-blocking mode
+ *
+ * Completion is reported with \ref esp_async_handler_t.close_fn callback from event loop
+ *
+ * \param[in]       conn: Connection handle
+ * \return          \ref espOK if command was queued, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_async_close(esp_conn_p conn) {
+    return esp_conn_close(conn, 0);
+}
+
+/**
+ * \brief           Event loop helper, dispatch queued connection events in caller thread
+ *
+ * Function waits for first event up to `timeout`, then dispatches
+ * all events already queued and returns.
+ * Call it in a loop from single thread to drive all connections.
+ *
+ * \param[in]       timeout: Maximal time to wait for first event in units of milliseconds.
+ *                      Set to `0` to wait until event is received
+ * \return          Number of dispatched events
+ */
+size_t
+esp_async_poll(uint32_t timeout) {
+    async_evt_t e;
+    const esp_async_handler_t* h;
+    void* m;
+    size_t cnt = 0;
+
+    if (!esp_sys_mbox_isvalid(&evts_mbox)
+        || esp_sys_mbox_get(&evts_mbox, &m, timeout) == ESP_SYS_TIMEOUT) {
+        return 0;
+    }
+    do {
+        esp_core_lock();
+        if (evts_r == evts_w) {
+            esp_core_unlock();
+            break;
+        }
+        e = evts[evts_r];
+        evts_r = (evts_r + 1) % ESP_CFG_ASYNC_QUEUE_LEN;
+        esp_core_unlock();
+
+        h = e.h;
+        switch (e.type) {
+            case ESP_EVT_CONN_ACTIVE:
+                if (h->connect_fn != NULL) {
+                    h->connect_fn(e.conn, espOK, h->arg);
+                }
+                break;
+            case ESP_EVT_CONN_ERROR:
+                if (h->connect_fn != NULL) {
+                    h->connect_fn(NULL, e.res, h->arg);
+                }
+                break;
+            case ESP_EVT_CONN_RECV:
+                if (h->recv_fn != NULL) {
+                    h->recv_fn(e.conn, e.pbuf, h->arg);
+                }
+                esp_pbuf_free(e.pbuf);
+                break;
+            case ESP_EVT_CONN_SEND:
+                if (h->sent_fn != NULL) {
+                    h->sent_fn(e.conn, e.len, e.res, h->arg);
+                }
+                break;
+            case ESP_EVT_CONN_CLOSE:
+                if (h->close_fn != NULL) {
+                    h->close_fn(e.conn, e.forced, e.res, h->arg);
+                }
+                break;
+            default: break;
+        }
+        ++cnt;
+    } while (esp_sys_mbox_getnow(&evts_mbox, &m));
+    return cnt;
+}
+
+#endif /* ESP_CFG_ASYNC || __DOXYGEN__ */
@@ -0,0 +1,116 @@
+/**
+ * \file            esp_async.h
+ * \brief           Asynchronous connection API
+ */
+
+/*
+ * Copyright (c) 2018 Tilen Majerle
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE
+ * AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of ESP-AT library.
+ *
+ * Author:          Tilen MAJERLE <tilen@majerle.eu>
+ */
+#ifndef ESP_HDR_ASYNC_H
+#define ESP_HDR_ASYNC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "esp/esp.h"
+
+/**
+ * \ingroup         ESP_API
+ * \defgroup        ESP_ASYNC Asynchronous connection API
+ * \brief           Non-blocking connection API with callbacks executed in user event loop
+ *
+ * Connection events are queued by ESP processing thread and dispatched
+ * from \ref esp_async_poll, so single user thread can drive all connections.
+ * \{
+ */
+
+/**
+ * \brief           Connection established or failed to establish
+ * \param[in]       conn: Connection handle, `NULL` when client connection failed
+ * \param[in]       res: \ref espOK on success, member of \ref espr_t enumeration otherwise
+ * \param[in]       arg: User argument from \ref esp_async_handler_t
+ */
+typedef void (*esp_async_connect_fn)(esp_conn_p conn, espr_t res, void* arg);
+
+/**
+ * \brief           Data received on connection
+ * \note            Packet buffer is freed after function returns,
+ *                  use \ref esp_pbuf_ref to keep it
+ * \param[in]       conn: Connection handle
+ * \param[in]       pbuf: Received packet buffer
+ * \param[in]       arg: User argument from \ref esp_async_handler_t
+ */
+typedef void (*esp_async_recv_fn)(esp_conn_p conn, esp_pbuf_p pbuf, void* arg);
+
+/**
+ * \brief           Data started with \ref esp_async_send were sent
+ * \param[in]       conn: Connection handle
+ * \param[in]       len: Number of bytes sent
+ * \param[in]       res: \ref espOK on success, member of \ref espr_t enumeration otherwise
+ * \param[in]       arg: User argument from \ref esp_async_handler_t
+ */
+typedef void (*esp_async_sent_fn)(esp_conn_p conn, size_t len, espr_t res, void* arg);
+
+/**
+ * \brief           Connection closed
+ * \param[in]       conn: Connection handle
+ * \param[in]       forced: `1` if closed by local side, `0` otherwise
+ * \param[in]       res: \ref espOK on success, member of \ref espr_t enumeration otherwise
+ * \param[in]       arg: User argument from \ref esp_async_handler_t
+ */
+typedef void (*esp_async_close_fn)(esp_conn_p conn, uint8_t forced, espr_t res, void* arg);
+
+/**
+ * \brief           Completion callbacks for connection
+ * \note            Structure must stay valid while connections use it.
+ *                  Any callback may be set to `NULL` when not used
+ */
+typedef struct {
+    esp_async_connect_fn connect_fn;            /*!< Connection active or failed callback */
+    esp_async_recv_fn recv_fn;                  /*!< Data received callback */
+    esp_async_sent_fn sent_fn;                  /*!< Data sent callback */
+    esp_async_close_fn close_fn;                /*!< Connection closed callback */
+    void* arg;                                  /*!< User argument passed to callbacks */
+} esp_async_handler_t;
+
+espr_t      esp_async_init(void);
+espr_t      esp_async_conn_start(esp_conn_type_t type, const char* const host, esp_port_t port, const esp_async_handler_t* h);
+espr_t      esp_async_listen(esp_port_t port, uint16_t max_conn, uint16_t timeout, const esp_async_handler_t* h);
+espr_t      esp_async_send(esp_conn_p conn, const void* data, size_t btw);
+espr_t      esp_async_close(esp_conn_p conn);
+size_t      esp_async_poll(uint32_t timeout);
+
+/**
+ * \}
+ */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* ESP_HDR_ASYNC_H */
@@ -117,6 +117,90 @@
 #define ESP_CFG_MEM_ALIGNMENT               4
 #endif
 
+/**
+ * \brief           Enables `1` or disables `0` two-level segregated fit (TLSF) allocator
+ *
+ * When enabled, internal memory manager keeps free blocks in segregated
+ * lists indexed by size class instead of single address-ordered list.
+ * Allocation and free operations are executed in constant time,
+ * independent of number of free blocks in heap.
+ *
+ * \note            Only used when \ref ESP_CFG_MEM_CUSTOM is set to `0`
+ */
+#ifndef ESP_CFG_MEM_TLSF
+#define ESP_CFG_MEM_TLSF                    0
+#endif
+
+/**
+ * \brief           Maximal block size for TLSF allocator, expressed as power of `2`
+ *
+ * Single memory block (and single assigned region) cannot be larger than `2 ^ ESP_CFG_MEM_TLSF_FL_INDEX_MAX` bytes.
+ * Larger regions are truncated when assigned to memory manager.
+ *
+ * \note            Used only when \ref ESP_CFG_MEM_TLSF is enabled
+ */
+#ifndef ESP_CFG_MEM_TLSF_FL_INDEX_MAX
+#define ESP_CFG_MEM_TLSF_FL_INDEX_MAX       17
+#endif
+
+/**
+ * \brief           Number of second level lists for each first level class, expressed as power of `2`
+ *
+ * Higher value reduces internal fragmentation at the cost of RAM for list heads.
+ *
+ * \note            Used only when \ref ESP_CFG_MEM_TLSF is enabled. Value must be between `1` and `5`
+ */
+#ifndef ESP_CFG_MEM_TLSF_SL_INDEX_LOG2
+#define ESP_CFG_MEM_TLSF_SL_INDEX_LOG2      4
+#endif
+
+/**
+ * \brief           Enables `1` or disables `0` memory manager statistics
+ *
+ * When enabled, free and minimal free bytes, largest free block, number of free blocks,
+ * allocation size histogram and failure counters are available with \ref esp_mem_get_stat
+ *
+ * \note            Only used when \ref ESP_CFG_MEM_CUSTOM is set to `0`
+ */
+#ifndef ESP_CFG_MEM_STAT
+#define ESP_CFG_MEM_STAT                    0
+#endif
+
+/**
+ * \brief           Enables `1` or disables `0` memory usage accounting per allocation site
+ *
+ * Each allocated block keeps \ref esp_mem_tag_t tag, set with \ref esp_mem_set_tag.
+ * It increases metadata size of every block.
+ *
+ * \note            Used only when \ref ESP_CFG_MEM_STAT is enabled
+ */
+#ifndef ESP_CFG_MEM_STAT_TAG
+#define ESP_CFG_MEM_STAT_TAG                0
+#endif
+
+/**
+ * \brief           Enables `1` or disables `0` lock contention statistics
+ *
+ * Stack uses separate locks for core, timeouts and memory.
+ * When enabled, number of acquisitions, contended acquisitions and wait time
+ * of each lock are available with \ref esp_lock_get_stat
+ */
+#ifndef ESP_CFG_LOCK_STAT
+#define ESP_CFG_LOCK_STAT                   0
+#endif
+
+/**
+ * \brief           Attribute for internal static memory accessed by CPU only
+ *
+ * Applied to core state, parser buffer and memory pools.
+ * Can be used to place them to a dedicated section, such as core-coupled memory.
+ *
+ * \note            Memory with this attribute is never used as DMA buffer
+ */
+#ifndef ESP_CFG_MEM_CPU_ATTR
+#define ESP_CFG_MEM_CPU_ATTR
+#endif
+
 /**
  * \brief           Enables `1` or disables `0` callback function and custom parameter for API functions
  *
@@ -166,6 +250,69 @@
 #define ESP_CFG_IPD_MAX_BUFF_SIZE           1460
 #endif
 
+/**
+ * \brief           Number of preallocated blocks in packet buffer pool
+ *
+ * Each block holds packet buffer with payload of up to \ref ESP_CFG_IPD_MAX_BUFF_SIZE bytes.
+ * When pool is empty or bigger buffer is requested, memory is allocated from \ref ESP_MEM
+ *
+ * \note            Set to `0` to disable pool
+ */
+#ifndef ESP_CFG_MEMPOOL_PBUF_NUM
+#define ESP_CFG_MEMPOOL_PBUF_NUM            0
+#endif
+
+/**
+ * \brief           Number of preallocated blocks in small packet buffer pool
+ *
+ * Packet buffers with payload of up to \ref ESP_CFG_MEMPOOL_PBUF_SMALL_SIZE bytes
+ * are taken from this pool first, so short responses do not occupy full size blocks.
+ * When pool is empty, \ref ESP_CFG_MEMPOOL_PBUF_NUM pool is used
+ *
+ * \note            Set to `0` to disable pool
+ */
+#ifndef ESP_CFG_MEMPOOL_PBUF_SMALL_NUM
+#define ESP_CFG_MEMPOOL_PBUF_SMALL_NUM      0
+#endif
+
+/**
+ * \brief           Maximal payload size of block in small packet buffer pool
+ */
+#ifndef ESP_CFG_MEMPOOL_PBUF_SMALL_SIZE
+#define ESP_CFG_MEMPOOL_PBUF_SMALL_SIZE     128
+#endif
+
+/**
+ * \brief           Number of preallocated blocks in API message pool
+ *
+ * \note            Set to `0` to disable pool
+ */
+#ifndef ESP_CFG_MEMPOOL_MSG_NUM
+#define ESP_CFG_MEMPOOL_MSG_NUM             0
+#endif
+
+/**
+ * \brief           Enables `1` or disables `0` API messages on caller stack for blocking calls
+ *
+ * Blocking call waits for command completion, so message does not outlive
+ * calling function and is placed to its stack instead of \ref ESP_CFG_MEMPOOL_MSG_NUM pool.
+ * Non-blocking calls still allocate message from pool or heap.
+ *
+ * \note            Each API function using blocking call needs `sizeof(esp_msg_t)` more stack
+ */
+#ifndef ESP_CFG_MSG_ON_STACK
+#define ESP_CFG_MSG_ON_STACK                0
+#endif
+
+/**
+ * \brief           Number of preallocated blocks in timeout entry pool
+ *
+ * \note            Set to `0` to disable pool
+ */
+#ifndef ESP_CFG_MEMPOOL_TIMEOUT_NUM
+#define ESP_CFG_MEMPOOL_TIMEOUT_NUM         0
+#endif
+
 /**
  * \brief           Default baudrate used for AT port
  *
@@ -451,6 +598,34 @@
 #define ESP_CFG_INPUT_USE_PROCESS           1
 #endif
 
+/**
+ * \brief           Enables `1` or disables `0` single-thread stack mode
+ *
+ * Producer, process and low-level receive threads are replaced by one thread.
+ * It runs commands, received data and timeouts to completion in single event loop,
+ * woken by \ref esp_input_notify, API messages and timeouts.
+ * It saves stacks of removed threads and thread switches on each command.
+ *
+ * Low-level driver must set \ref esp_ll_t.recv_fn function to read received data
+ * and call \ref esp_input_notify on receive events instead of using own thread
+ *
+ * \note            \ref ESP_CFG_INPUT_USE_PROCESS must be enabled to use this mode
+ */
+#ifndef ESP_CFG_SINGLE_THREAD
+#define ESP_CFG_SINGLE_THREAD               0
+#endif
+
+/**
+ * \brief           Stack size of thread in single-thread mode, in units of bytes
+ *
+ * Input is parsed in this thread, so it needs more than producer thread
+ *
+ * \note            Used only when \ref ESP_CFG_SINGLE_THREAD is enabled
+ */
+#ifndef ESP_CFG_SINGLE_THREAD_SS
+#define ESP_CFG_SINGLE_THREAD_SS            1024
+#endif
+
 /**
  * \brief           Producer thread hook, called each time thread wakes-up and does the processing.
  *
@@ -527,6 +702,40 @@
 #define ESP_CFG_NETCONN_RECEIVE_QUEUE_LEN   8
 #endif
 
+/**
+ * \brief           Enables `1` or disables `0` persistent TX buffer for netconn
+ *
+ * When enabled, write buffer of \ref ESP_CFG_CONN_MAX_DATA_LEN bytes is allocated on first write
+ * and kept until netconn is deleted, instead of being allocated and freed for each flush.
+ * This avoids heap fragmentation when connection writes often
+ */
+#ifndef ESP_CFG_NETCONN_PERSIST_TX_BUFF
+#define ESP_CFG_NETCONN_PERSIST_TX_BUFF     0
+#endif
+
+/**
+ * \brief           Enables `1` or disables `0` asynchronous connection API
+ *
+ * Connection events are dispatched to callbacks from single user event loop,
+ * without dedicated thread per connection
+ *
+ * \sa              ESP_ASYNC
+ */
+#ifndef ESP_CFG_ASYNC
+#define ESP_CFG_ASYNC                       0
+#endif
+
+/**
+ * \brief           Event queue length for asynchronous connection API
+ *
+ * One entry is reserved per active connection for close event
+ * and per queued send for sent event, \ref esp_async_send fails when no entry is left.
+ * Received data events over this limit are ignored and memory is freed
+ */
+#ifndef ESP_CFG_ASYNC_QUEUE_LEN
+#define ESP_CFG_ASYNC_QUEUE_LEN             16
+#endif
+
 /**
  * \}
  */
@@ -537,14 +746,46 @@
  * \{
  */
 
+/**
+ * \brief           Enables `1` or disables `0` MQTT client
+ *
+ * \sa              ESP_MQTT_CLIENT
+ */
+#ifndef ESP_CFG_MQTT
+#define ESP_CFG_MQTT                        0
+#endif
+
 /**
  * \brief           Maximal number of open MQTT requests at a time
  *
+ * Subscribe, unsubscribe and publish requests with quality of service `1`
+ * occupy one entry until acknowledged by broker. New requests fail when all are used.
  */
 #ifndef ESP_CFG_MQTT_MAX_REQUESTS
 #define ESP_CFG_MQTT_MAX_REQUESTS           8
 #endif
 
+/**
+ * \brief           Time in units of milliseconds to wait for broker acknowledge
+ *
+ * Connect and in-flight requests fail after this time.
+ * Resolution is equal to connection poll interval.
+ */
+#ifndef ESP_CFG_MQTT_REQUEST_TIMEOUT
+#define ESP_CFG_MQTT_REQUEST_TIMEOUT        10000
+#endif
+
+/**
+ * \brief           Enables `1` or disables `0` coalescing of MQTT publish packets
+ *
+ * When enabled, publish packets stay in connection write buffer and are sent
+ * together on next poll event, when buffer is full or on explicit flush.
+ * When disabled, every publish packet is sent immediately.
+ */
+#ifndef ESP_CFG_MQTT_PUBLISH_COALESCE
+#define ESP_CFG_MQTT_PUBLISH_COALESCE       1
+#endif
+
 /**
  * \brief           Set debug level for MQTT client module
  *
@@ -639,16 +880,41 @@
  */
 
 /**
- * \brief           Poll interval for connections in units of milliseconds
+ * \brief           Default poll interval for connections in units of milliseconds
  *
  * Value indicates interval time to call poll event on active connections.
+ * Single poll tick serves all connections, it can be changed or disabled
+ * at runtime with \ref esp_conn_set_poll_interval
  *
- * \note            Single poll interval applies for all connections
+ * \note            Set to `0` to disable poll events by default
  */
 #ifndef ESP_CFG_CONN_POLL_INTERVAL
 #define ESP_CFG_CONN_POLL_INTERVAL          500
 #endif
 
+/**
+ * \brief           Number of slots in timeout wheel
+ *
+ * Timeouts are hashed to slots by their expiry tick.
+ * Wheel covers `ESP_CFG_TIMEOUT_WHEEL_SIZE * ESP_CFG_TIMEOUT_WHEEL_TICK` milliseconds,
+ * longer timeouts stay in slot for multiple wheel rounds.
+ *
+ * \note            Value must be power of `2` and at least `32`
+ */
+#ifndef ESP_CFG_TIMEOUT_WHEEL_SIZE
+#define ESP_CFG_TIMEOUT_WHEEL_SIZE          64
+#endif
+
+/**
+ * \brief           Timeout wheel tick in units of milliseconds
+ *
+ * Timeouts are rounded up to tick and all timeouts in the same tick
+ * are processed with single process thread wakeup
+ */
+#ifndef ESP_CFG_TIMEOUT_WHEEL_TICK
+#define ESP_CFG_TIMEOUT_WHEEL_TICK          10
+#endif
+
 /**
  * \brief           Enables `1` or disables `0` manual `TCP` data receive from ESP device
  *
@@ -743,7 +1009,13 @@ void *  my_memset(void* dst, int b, size_t len);
     #if ESP_CFG_INPUT_USE_PROCESS
     #error "ESP_CFG_INPUT_USE_PROCESS may only be enabled when OS is used!"
     #endif /* ESP_CFG_INPUT_USE_PROCESS */
+    #if ESP_CFG_SINGLE_THREAD
+    #error "ESP_CFG_SINGLE_THREAD may only be enabled when OS is used!"
+    #endif /* ESP_CFG_SINGLE_THREAD */
 #endif /* !ESP_CFG_OS */
+#if ESP_CFG_SINGLE_THREAD && !ESP_CFG_INPUT_USE_PROCESS
+#error "ESP_CFG_SINGLE_THREAD may only be enabled together with ESP_CFG_INPUT_USE_PROCESS!"
+#endif /* ESP_CFG_SINGLE_THREAD && !ESP_CFG_INPUT_USE_PROCESS */
 
 /* Device config */
 #if !ESP_CFG_ESP8266 || ESP_CFG_ESP32
@@ -758,6 +1030,22 @@ void *  my_memset(void* dst, int b, size_t len);
 #error "WPS function may only be used when station mode is enabled!"
 #endif /* ESP_CFG_WPS && !ESP_CFG_MODE_STATION */
 
+/* Memory manager config */
+#if ESP_CFG_MEM_TLSF && (ESP_CFG_MEM_TLSF_SL_INDEX_LOG2 < 1 || ESP_CFG_MEM_TLSF_SL_INDEX_LOG2 > 5)
+#error "ESP_CFG_MEM_TLSF_SL_INDEX_LOG2 must be between 1 and 5!"
+#endif /* ESP_CFG_MEM_TLSF && (ESP_CFG_MEM_TLSF_SL_INDEX_LOG2 < 1 || ESP_CFG_MEM_TLSF_SL_INDEX_LOG2 > 5) */
+#if ESP_CFG_MEM_STAT_TAG && !ESP_CFG_MEM_STAT
+#error "ESP_CFG_MEM_STAT_TAG may only be enabled when ESP_CFG_MEM_STAT is enabled!"
+#endif /* ESP_CFG_MEM_STAT_TAG && !ESP_CFG_MEM_STAT */
+
+#if ESP_CFG_TIMEOUT_WHEEL_SIZE < 32 || (ESP_CFG_TIMEOUT_WHEEL_SIZE & (ESP_CFG_TIMEOUT_WHEEL_SIZE - 1))
+#error "ESP_CFG_TIMEOUT_WHEEL_SIZE must be power of 2 and at least 32!"
+#endif /* ESP_CFG_TIMEOUT_WHEEL_SIZE < 32 || ... */
+
+#if ESP_CFG_TIMEOUT_WHEEL_TICK < 1
+#error "ESP_CFG_TIMEOUT_WHEEL_TICK must be at least 1 millisecond!"
+#endif /* ESP_CFG_TIMEOUT_WHEEL_TICK < 1 */
+
 #endif /* !__DOXYGEN__ */
 
 #endif /* ESP_HDR_DEFAULT_CONFIG_H */
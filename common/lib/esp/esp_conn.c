@@ -53,31 +53,85 @@
 } while (0)
 
 /**
- * \brief           Timeout callback for connection
- * \param[in]       arg: Timeout callback custom argument
+ * \brief           Poll tick callback, common for all connections
+ *
+ * Sends poll event to every active connection and schedules next tick.
+ * Tick is not rescheduled when there are no active connections left.
+ *
+ * \param[in]       arg: Timeout callback custom argument, not used
  */
 static void
-conn_timeout_cb(void* arg) {
-    esp_conn_p conn = arg;                      /* Argument is actual connection */
-
-    if (conn->status.f.active) {                /* Handle only active connections */
-        esp.evt.type = ESP_EVT_CONN_POLL;       /* Poll connection event */
-        esp.evt.evt.conn_poll.conn = conn;      /* Set connection pointer */
-        espi_send_conn_cb(conn, NULL);          /* Send connection callback */
+conn_poll_cb(void* arg) {
+    esp_conn_p conn;
+    uint8_t active = 0;
+
+    ESP_UNUSED(arg);
+
+    for (size_t i = 0; i < ESP_CFG_MAX_CONNS; ++i) {
+        conn = &esp.m.conns[i];
+        if (conn->status.f.active) {            /* Handle only active connections */
+            esp.evt.type = ESP_EVT_CONN_POLL;   /* Poll connection event */
+            esp.evt.evt.conn_poll.conn = conn;  /* Set connection pointer */
+            espi_send_conn_cb(conn, NULL);      /* Send connection callback */
+            ESP_DEBUGF(ESP_CFG_DBG_CONN | ESP_DBG_TYPE_TRACE,
+                "[CONN] Poll event: %p\r\n", conn);
 
-        espi_conn_start_timeout(conn);          /* Schedule new timeout */
-        ESP_DEBUGF(ESP_CFG_DBG_CONN | ESP_DBG_TYPE_TRACE,
-            "[CONN] Poll event: %p\r\n", conn);
+            active = active || conn->status.f.active;   /* Callback may close connection */
+        }
+    }
+    if (active && esp.conn_poll_interval > 0) {
+        esp_timeout_start(&esp.conn_poll_timeout, esp.conn_poll_interval, conn_poll_cb, NULL);
     }
 }
 
 /**
- * \brief           Start timeout function for connection
- * \param[in]       conn: Connection handle as user argument
+ * \brief           Start poll tick for active connections if not already running
  */
 void
-espi_conn_start_timeout(esp_conn_p conn) {
-    esp_timeout_add(ESP_CFG_CONN_POLL_INTERVAL, conn_timeout_cb, conn); /* Add connection timeout */
+espi_conn_poll_start(void) {
+    if (esp.conn_poll_interval > 0 && !esp_timeout_is_active(&esp.conn_poll_timeout)) {
+        esp_timeout_start(&esp.conn_poll_timeout, esp.conn_poll_interval, conn_poll_cb, NULL);
+    }
+}
+
+/**
+ * \brief           Set interval of \ref ESP_EVT_CONN_POLL event for all active connections
+ *
+ * Single poll tick is shared by all connections and runs only while
+ * at least one connection is active.
+ *
+ * \param[in]       interval: Poll interval in units of milliseconds.
+ *                      Set to `0` to disable poll events, e.g. for idle links
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ * \sa              esp_conn_get_poll_interval
+ */
+espr_t
+esp_conn_set_poll_interval(uint32_t interval) {
+    esp_core_lock();
+    esp.conn_poll_interval = interval;
+    if (interval > 0) {
+        for (size_t i = 0; i < ESP_CFG_MAX_CONNS; ++i) {
+            if (esp.m.conns[i].status.f.active) {
+                /* Restart with new interval */
+                esp_timeout_start(&esp.conn_poll_timeout, interval, conn_poll_cb, NULL);
+                break;
+            }
+        }
+    } else {
+        esp_timeout_stop(&esp.conn_poll_timeout);
+    }
+    esp_core_unlock();
+    return espOK;
+}
+
+/**
+ * \brief           Get interval of \ref ESP_EVT_CONN_POLL event
+ * \return          Poll interval in units of milliseconds, `0` if disabled
+ * \sa              esp_conn_set_poll_interval
+ */
+uint32_t
+esp_conn_get_poll_interval(void) {
+    return esp.conn_poll_interval;
 }
 
 #if ESP_CFG_CONN_MANUAL_TCP_RECEIVE
@@ -434,11 +488,11 @@ esp_get_conns_status(const uint32_t blocking) {
  */
 uint8_t
 esp_conn_is_client(esp_conn_p conn) {
+    esp_conn_status_t status;
     uint8_t res = 0;
     if (conn != NULL && espi_is_valid_conn_ptr(conn)) {
-        esp_core_lock();
-        res = conn->status.f.active && conn->status.f.client;
-        esp_core_unlock();
+        status = conn->status;                  /* Single byte read, no lock needed */
+        res = status.f.active && status.f.client;
     }
     return res;
 }
@@ -450,11 +504,11 @@ esp_conn_is_client(esp_conn_p conn) {
  */
 uint8_t
 esp_conn_is_server(esp_conn_p conn) {
+    esp_conn_status_t status;
     uint8_t res = 0;
     if (conn != NULL && espi_is_valid_conn_ptr(conn)) {
-        esp_core_lock();
-        res = conn->status.f.active && !conn->status.f.client;
-        esp_core_unlock();
+        status = conn->status;                  /* Single byte read, no lock needed */
+        res = status.f.active && !status.f.client;
     }
     return res;
 }
@@ -466,11 +520,11 @@ esp_conn_is_server(esp_conn_p conn) {
  */
 uint8_t
 esp_conn_is_active(esp_conn_p conn) {
+    esp_conn_status_t status;
     uint8_t res = 0;
     if (conn != NULL && espi_is_valid_conn_ptr(conn)) {
-        esp_core_lock();
-        res = conn->status.f.active;
-        esp_core_unlock();
+        status = conn->status;                  /* Single byte read, no lock needed */
+        res = status.f.active;
     }
     return res;
 }
@@ -482,11 +536,11 @@ esp_conn_is_active(esp_conn_p conn) {
  */
 uint8_t
 esp_conn_is_closed(esp_conn_p conn) {
+    esp_conn_status_t status;
     uint8_t res = 0;
     if (conn != NULL && espi_is_valid_conn_ptr(conn)) {
-        esp_core_lock();
-        res = !conn->status.f.active;
-        esp_core_unlock();
+        status = conn->status;                  /* Single byte read, no lock needed */
+        res = !status.f.active;
     }
     return res;
 }
@@ -602,6 +656,7 @@ esp_conn_write(esp_conn_p conn, const void* data, size_t btw, uint8_t flush,
         uint8_t* buff;
         buff = esp_mem_malloc(sizeof(*buff) * ESP_CFG_CONN_MAX_DATA_LEN);
         if (buff != NULL) {
+            esp_mem_set_tag(buff, ESP_MEM_TAG_CONN_BUFF);
             ESP_MEMCPY(buff, d, ESP_CFG_CONN_MAX_DATA_LEN); /* Copy data to buffer */
             if (conn_send(conn, NULL, 0, buff, ESP_CFG_CONN_MAX_DATA_LEN, NULL, 1, 0) != espOK) {
                 ESP_DEBUGF(ESP_CFG_DBG_CONN | ESP_DBG_TYPE_TRACE,
@@ -622,6 +677,7 @@ esp_conn_write(esp_conn_p conn, const void* data, size_t btw, uint8_t flush,
         conn->buff.buff = esp_mem_malloc(sizeof(*conn->buff.buff) * ESP_CFG_CONN_MAX_DATA_LEN);
         conn->buff.len = ESP_CFG_CONN_MAX_DATA_LEN;
         conn->buff.ptr = 0;
+        esp_mem_set_tag(conn->buff.buff, ESP_MEM_TAG_CONN_BUFF);
 
         ESP_DEBUGW(ESP_CFG_DBG_CONN | ESP_DBG_TYPE_TRACE, conn->buff.buff != NULL,
             "[CONN] New write buffer allocated, addr = %p\r\n", conn->buff.buff);
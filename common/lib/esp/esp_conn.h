@@ -57,6 +57,8 @@ uint8_t     esp_conn_is_server(esp_conn_p conn);
 uint8_t     esp_conn_is_active(esp_conn_p conn);
 uint8_t     esp_conn_is_closed(esp_conn_p conn);
 int8_t      esp_conn_getnum(esp_conn_p conn);
+espr_t      esp_conn_set_poll_interval(uint32_t interval);
+uint32_t    esp_conn_get_poll_interval(void);
 espr_t      esp_conn_set_ssl_buffersize(size_t size, const uint32_t blocking);
 espr_t      esp_get_conns_status(const uint32_t blocking);
 esp_conn_p  esp_conn_get_from_evt(esp_evt_t* evt);
@@ -36,11 +36,24 @@
 
 /**
  * \brief           Register event function for global (non-connection based) events
+ * \note            Function is called for all event types, use \ref esp_evt_register_mask
+ *                  to receive only events function is interested in
  * \param[in]       fn: Callback function to call on specific event
  * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
  */
 espr_t
 esp_evt_register(esp_evt_fn fn) {
+    return esp_evt_register_mask(fn, ESP_EVT_MASK_ALL);
+}
+
+/**
+ * \brief           Register event function for selected global (non-connection based) events
+ * \param[in]       fn: Callback function to call on specific event
+ * \param[in]       mask: Events to subscribe, combination of \ref ESP_EVT_MASK values
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_evt_register_mask(esp_evt_fn fn, uint32_t mask) {
     espr_t res = espOK;
     esp_evt_func_t* func, *new_func;
 
@@ -61,6 +74,7 @@ esp_evt_register(esp_evt_fn fn) {
         if (new_func != NULL) {
             ESP_MEMSET(new_func, 0x00, sizeof(*new_func));
             new_func->fn = fn;                   /* Set function pointer */
+            new_func->mask = mask;               /* Set subscribed events */
             for (func = esp.evt_func; func != NULL && func->next != NULL; func = func->next) {}
             if (func != NULL) {
                 func->next = new_func;           /* Set new function as next */
@@ -77,6 +91,31 @@ esp_evt_register(esp_evt_fn fn) {
     return res;
 }
 
+/**
+ * \brief           Change subscribed events for registered callback function
+ * \note            Applies also to callback function set with \ref esp_init
+ * \param[in]       fn: Registered callback function
+ * \param[in]       mask: Events to subscribe, combination of \ref ESP_EVT_MASK values
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_evt_set_mask(esp_evt_fn fn, uint32_t mask) {
+    espr_t res = espERR;
+
+    ESP_ASSERT("fn != NULL", fn != NULL);
+
+    esp_core_lock();
+    for (esp_evt_func_t* func = esp.evt_func; func != NULL; func = func->next) {
+        if (func->fn == fn) {
+            func->mask = mask;
+            res = espOK;
+            break;
+        }
+    }
+    esp_core_unlock();
+    return res;
+}
+
 /**
  * \brief           Unregister callback function for global (non-connection based) events
  * \note            Function must be first registered using \ref esp_evt_register
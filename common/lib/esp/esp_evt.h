@@ -46,7 +46,21 @@ extern "C" {
  * \{
  */
 
+/**
+ * \brief           Get subscription mask bit for event type
+ * \note            Number of event types must not exceed `32`
+ * \param[in]       type: Member of \ref esp_evt_type_t enumeration
+ */
+#define ESP_EVT_MASK(type)              ((uint32_t)1 << (type))
+
+/**
+ * \brief           Subscription mask for all event types
+ */
+#define ESP_EVT_MASK_ALL                ((uint32_t)0xFFFFFFFF)
+
 espr_t          esp_evt_register(esp_evt_fn fn);
+espr_t          esp_evt_register_mask(esp_evt_fn fn, uint32_t mask);
+espr_t          esp_evt_set_mask(esp_evt_fn fn, uint32_t mask);
 espr_t          esp_evt_unregister(esp_evt_fn fn);
 esp_evt_type_t  esp_evt_get_type(esp_evt_t* cc);
 
@@ -57,6 +57,9 @@ extern "C" {
 #if ESP_CFG_NETCONN || __DOXYGEN__
 #include "esp/esp_netconn.h"
 #endif /* ESP_CFG_NETCONN || __DOXYGEN__ */
+#if ESP_CFG_ASYNC || __DOXYGEN__
+#include "esp/esp_async.h"
+#endif /* ESP_CFG_ASYNC || __DOXYGEN__ */
 #if ESP_CFG_PING || __DOXYGEN__
 #include "esp/esp_ping.h"
 #endif /* ESP_CFG_PING || __DOXYGEN__ */
@@ -72,6 +75,9 @@ extern "C" {
 #if ESP_CFG_DNS || __DOXYGEN__
 #include "esp/esp_dns.h"
 #endif /* ESP_CFG_DNS || __DOXYGEN__ */
+#if ESP_CFG_MQTT || __DOXYGEN__
+#include "esp/esp_mqtt_client.h"
+#endif /* ESP_CFG_MQTT || __DOXYGEN__ */
 
 #ifdef __cplusplus
 }
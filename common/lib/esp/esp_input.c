@@ -94,3 +94,25 @@ esp_input_process(const void* data, size_t len) {
 }
 
 #endif /* ESP_CFG_INPUT_USE_PROCESS || __DOXYGEN__ */
+
+#if ESP_CFG_SINGLE_THREAD || __DOXYGEN__
+
+/**
+ * \brief           Notify stack thread about new received data
+ *
+ * Stack thread wakes up and reads data with \ref esp_ll_t.recv_fn function.
+ * Function does not block and may be called from interrupt context
+ *
+ * \note            \ref ESP_CFG_SINGLE_THREAD must be enabled to use this function
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_input_notify(void) {
+    if (!esp.status.f.initialized) {
+        return espERR;
+    }
+    esp_sys_mbox_putnow(&esp.mbox_process, NULL);   /* Write empty box, don't care if write fails */
+    return espOK;
+}
+
+#endif /* ESP_CFG_SINGLE_THREAD || __DOXYGEN__ */
@@ -49,6 +49,7 @@ extern "C" {
 
 espr_t      esp_input(const void* data, size_t len);
 espr_t      esp_input_process(const void* data, size_t len);
+espr_t      esp_input_notify(void);
 
 /**
  * \}
@@ -36,6 +36,7 @@
 #include "esp/esp_mem.h"
 #include "esp/esp_parser.h"
 #include "esp/esp_unicode.h"
+#include "esp/esp_timeout.h"
 #include "system/esp_ll.h"
 
 #include "log.h"
@@ -81,7 +82,7 @@ static void AT_PORT_SEND_CUR_DEF(uint8_t is_d, uint8_t e) {
 }
 #endif /* !__DOXYGEN__ */
 
-static esp_recv_t recv_buff;
+static esp_recv_t recv_buff ESP_CFG_MEM_CPU_ATTR;
 static espr_t espi_process_sub_cmd(esp_msg_t* msg, uint8_t* is_ok, uint8_t* is_error, uint8_t* is_ready);
 
 /**
@@ -401,9 +402,11 @@ espr_t
 espi_send_cb(esp_evt_type_t type) {
     esp.evt.type = type;                        /* Set callback type to process */
 
-    /* Call callback function for all registered functions */
+    /* Call callback function for all functions subscribed to event */
     for (esp_evt_func_t* link = esp.evt_func; link != NULL; link = link->next) {
-        link->fn(&esp.evt);
+        if (link->mask & ESP_EVT_MASK(type)) {
+            link->fn(&esp.evt);
+        }
     }
     return espOK;
 }
@@ -908,7 +911,7 @@ espi_parse_received(esp_recv_t* rcv) {
                 esp.evt.evt.conn_active_close.client = conn->status.f.client;   /* Set if it is client or not */
                 esp.evt.evt.conn_active_close.forced = conn->status.f.client;   /* Set if action was forced = if client mode */
                 espi_send_conn_cb(conn, NULL);  /* Send event */
-                espi_conn_start_timeout(conn);  /* Start connection timeout timer */
+                espi_conn_poll_start();         /* Start poll tick if not running yet */
             }
         }
     /*
@@ -992,7 +995,11 @@ espi_parse_received(esp_recv_t* rcv) {
              * from user thread and start with next command
              */
             if (res != espCONT) {               /* Do we have to continue to wait for command? */
+#if ESP_CFG_SINGLE_THREAD
+                esp.msg_done = 1;               /* Stack thread finishes message after input is processed */
+#else /* ESP_CFG_SINGLE_THREAD */
                 esp_sys_sem_release(&esp.sem_sync); /* Release semaphore */
+#endif /* !ESP_CFG_SINGLE_THREAD */
             }
         }
     }
@@ -1392,7 +1399,20 @@ espi_process_sub_cmd(esp_msg_t* msg, uint8_t* is_ok, uint8_t* is_error, uint8_t*
             SET_NEW_CMD(ESP_CMD_WIFI_CIPSTA_GET);
         }
     } else if (CMD_IS_DEF(ESP_CMD_WIFI_CWLAP)) {
-        STA_LIST_AP_SEND_EVT(msg, *is_ok ? espOK : espERR);
+        if (CMD_IS_CUR(ESP_CMD_WIFI_CWLAPOPT)) {
+            if (!msg->msg.ap_list.opt_restore && *is_ok) {
+                SET_NEW_CMD(ESP_CMD_WIFI_CWLAP);/* Filter is set, start scan */
+            } else if (msg->msg.ap_list.opt_restore) {
+                *is_ok = msg->msg.ap_list.scan_res == espOK;    /* Report scan result, not filter restore */
+            }
+        } else if (msg->msg.ap_list.rssi_min != 0) {
+            msg->msg.ap_list.scan_res = *is_ok ? espOK : espERR;
+            msg->msg.ap_list.opt_restore = 1;
+            SET_NEW_CMD(ESP_CMD_WIFI_CWLAPOPT); /* Restore default filter */
+        }
+        if (n_cmd == ESP_CMD_IDLE) {
+            STA_LIST_AP_SEND_EVT(msg, *is_ok ? espOK : espERR);
+        }
     } else if (CMD_IS_DEF(ESP_CMD_WIFI_CWJAP_GET)) {
         STA_INFO_AP_SEND_EVT(msg, *is_ok ? espOK : espERR);
     } else if (CMD_IS_DEF(ESP_CMD_WIFI_CIPSTA_GET) || CMD_IS_CUR(ESP_CMD_WIFI_CIPSTA_GET)) {
@@ -1563,6 +1583,11 @@ espi_initiate_cmd(esp_msg_t* msg) {
         case ESP_CMD_WIFI_CWLAPOPT: {           /* Set visible data on CWLAP command */
             AT_PORT_SEND_BEGIN();
             AT_PORT_SEND_CONST_STR("+CWLAPOPT=1,2047");
+#if ESP_CFG_MODE_STATION
+            if (CMD_IS_DEF(ESP_CMD_WIFI_CWLAP)) {   /* RSSI filter for scan, restore default after */
+                espi_send_signed_number(msg->msg.ap_list.opt_restore ? -100 : msg->msg.ap_list.rssi_min, 0, 1);
+            }
+#endif /* ESP_CFG_MODE_STATION */
             AT_PORT_SEND_END();
             break;
         }
@@ -2063,17 +2088,19 @@ espr_t
 espi_send_msg_to_producer_mbox(esp_msg_t* msg, espr_t (*process_fn)(esp_msg_t *), uint32_t max_block_time) {
     espr_t res = msg->res = espOK;
 
-    /* Check here if stack is even enabled or shall we disable new command entry? */
-    esp_core_lock();
-    /* If locked more than 1 time, means we were called from callback or internally */
-    if (esp.locked_cnt > 1 && msg->is_blocking) {
+    /*
+     * Check here if stack is even enabled or shall we disable new command entry?
+     *
+     * Core is not locked, so API call does not wait for receive processing.
+     * If current thread holds the core lock, we were called from callback or internally
+     */
+    if (msg->is_blocking && espi_lock_is_owner(ESP_LOCK_CORE)) {
         res = espERRBLOCKING;                   /* Blocking mode not allowed */
     }
-    /* Check if device present */
+    /* Check if device present, single flag read */
     if (res == espOK && !esp.status.f.dev_present) {
         res = espERRNODEVICE;                   /* No device connected */
     }
-    esp_core_unlock();
     if (res != espOK) {
         ESP_MSG_VAR_FREE(msg);                  /* Free memory and return */
         return res;
@@ -2098,6 +2125,9 @@ espi_send_msg_to_producer_mbox(esp_msg_t* msg, espr_t (*process_fn)(esp_msg_t *)
             return espERRMEM;
         }
     }
+#if ESP_CFG_SINGLE_THREAD
+    esp_sys_mbox_putnow(&esp.mbox_process, NULL);   /* Wakeup stack thread, don't care if write fails */
+#endif /* ESP_CFG_SINGLE_THREAD */
     if (res == espOK && msg->is_blocking) {     /* In case we have blocking request */
         uint32_t time;
         time = esp_sys_sem_wait(&msg->sem, 0);  /* Wait forever for semaphore */
@@ -33,14 +33,30 @@
 #include "esp/esp_private.h"
 #include "esp/esp_mem.h"
 #include <limits.h>
+#include <stddef.h>
 
 #if !ESP_CFG_MEM_CUSTOM || __DOXYGEN__
 
 #if !__DOXYGEN__
+#if ESP_CFG_MEM_TLSF
+typedef struct mem_block {
+    struct mem_block* prev_phys;                /*!< Pointer to physically previous block in region, `NULL` for first block */
+    size_t size;                                /*!< Size of block including metadata, upper bit set when allocated */
+#if ESP_CFG_MEM_STAT_TAG
+    size_t tag;                                 /*!< Allocation site tag. Valid only when block is allocated */
+#endif /* ESP_CFG_MEM_STAT_TAG */
+    struct mem_block* next_free;                /*!< Pointer to next free block in size class list. Valid only when block is free */
+    struct mem_block* prev_free;                /*!< Pointer to previous free block in size class list. Valid only when block is free */
+} mem_block_t;
+#else /* ESP_CFG_MEM_TLSF */
 typedef struct mem_block {
     struct mem_block* next;                     /*!< Pointer to next free block */
     size_t size;                                /*!< Size of block */
+#if ESP_CFG_MEM_STAT_TAG
+    size_t tag;                                 /*!< Allocation site tag. Valid only when block is allocated */
+#endif /* ESP_CFG_MEM_STAT_TAG */
 } mem_block_t;
+#endif /* !ESP_CFG_MEM_TLSF */
 #endif /* !__DOXYGEN__ */
 
 /**
@@ -50,11 +66,387 @@ typedef struct mem_block {
 #define MEM_ALIGN_NUM               ESP_SZ(ESP_CFG_MEM_ALIGNMENT)
 #define MEM_ALIGN(x)                ESP_MEM_ALIGN(x)
 
+#if ESP_CFG_MEM_TLSF
+#define MEMBLOCK_METASIZE           MEM_ALIGN(offsetof(mem_block_t, next_free))
+#else /* ESP_CFG_MEM_TLSF */
 #define MEMBLOCK_METASIZE           MEM_ALIGN(sizeof(mem_block_t))
+#endif /* !ESP_CFG_MEM_TLSF */
 
 #define MEM_ALLOC_BIT               ((size_t)((size_t)1 << (sizeof(size_t) * CHAR_BIT - 1)))
 #define MEM_BLOCK_FROM_PTR(ptr)     ((mem_block_t *)(((uint8_t *)(ptr)) - MEMBLOCK_METASIZE))
-#define MEM_BLOCK_USER_SIZE(ptr)    ((MEM_BLOCK_FROM_PTR(ptr)->size & ~MEM_ALLOC_BIT) - MEMBLOCK_METASIZE)
+#define MEM_BLOCK_SIZE(b)           ((b)->size & ~MEM_ALLOC_BIT)
+#define MEM_BLOCK_USER_SIZE(ptr)    (MEM_BLOCK_SIZE(MEM_BLOCK_FROM_PTR(ptr)) - MEMBLOCK_METASIZE)
+
+#if ESP_CFG_MEM_STAT
+static esp_mem_stat_t mem_stat;                 /*!< Memory statistics. Free block figures are calculated on request */
+#endif /* ESP_CFG_MEM_STAT */
+
+#if ESP_CFG_MEM_TLSF
+
+/* Alignment expressed as power of 2, used for size class mapping */
+#if ESP_CFG_MEM_ALIGNMENT == 1
+#define MEM_ALIGN_LOG2              0
+#elif ESP_CFG_MEM_ALIGNMENT == 2
+#define MEM_ALIGN_LOG2              1
+#elif ESP_CFG_MEM_ALIGNMENT == 4
+#define MEM_ALIGN_LOG2              2
+#elif ESP_CFG_MEM_ALIGNMENT == 8
+#define MEM_ALIGN_LOG2              3
+#elif ESP_CFG_MEM_ALIGNMENT == 16
+#define MEM_ALIGN_LOG2              4
+#else
+#error "ESP_CFG_MEM_ALIGNMENT must be 1, 2, 4, 8 or 16 when ESP_CFG_MEM_TLSF is enabled!"
+#endif
+
+/**
+ * \brief           TLSF size class parameters
+ *
+ * Blocks smaller than `MEM_SMALL_BLOCK_SIZE` are stored in first level list `0`,
+ * linearly split to second level lists by alignment size.
+ * Larger blocks are classified by most significant bit (first level)
+ * and next `ESP_CFG_MEM_TLSF_SL_INDEX_LOG2` bits (second level)
+ */
+#define MEM_SL_INDEX_LOG2           ESP_CFG_MEM_TLSF_SL_INDEX_LOG2
+#define MEM_SL_INDEX_COUNT          ESP_SZ(1 << MEM_SL_INDEX_LOG2)
+#define MEM_FL_INDEX_SHIFT          (MEM_SL_INDEX_LOG2 + MEM_ALIGN_LOG2)
+#define MEM_FL_INDEX_COUNT          (ESP_CFG_MEM_TLSF_FL_INDEX_MAX - MEM_FL_INDEX_SHIFT + 1)
+#define MEM_SMALL_BLOCK_SIZE        ESP_SZ(1 << MEM_FL_INDEX_SHIFT)
+#define MEM_BLOCK_MAX_SIZE          (ESP_SZ(1 << ESP_CFG_MEM_TLSF_FL_INDEX_MAX) - MEM_ALIGN_NUM)
+
+#define MEMBLOCK_MINSIZE            MEM_ALIGN(sizeof(mem_block_t))
+#define MEM_BLOCK_IS_FREE(b)        (!((b)->size & MEM_ALLOC_BIT))
+#define MEM_BLOCK_NEXT_PHYS(b)      ((mem_block_t *)(((uint8_t *)(b)) + MEM_BLOCK_SIZE(b)))
+
+#if MEM_FL_INDEX_COUNT < 1 || ESP_CFG_MEM_TLSF_FL_INDEX_MAX > 30
+#error "ESP_CFG_MEM_TLSF_FL_INDEX_MAX is out of range for selected alignment and second level count!"
+#endif
+
+static mem_block_t* free_lists[MEM_FL_INDEX_COUNT][MEM_SL_INDEX_COUNT]; /*!< Heads of free lists for each size class */
+static uint32_t fl_bitmap;                      /*!< Bit is set when first level class has at least one free block */
+static uint32_t sl_bitmap[MEM_FL_INDEX_COUNT];  /*!< Bit is set when second level list has at least one free block */
+static uint8_t mem_regions_assigned;            /*!< Set to `1` when regions are assigned */
+static size_t mem_available_bytes;              /*!< Number of available bytes for allocations */
+
+/**
+ * \brief           Get index of most significant set bit
+ * \param[in]       val: Non-zero input value
+ * \return          Bit index, starting with `0` for LSB
+ */
+static size_t
+mem_fls(size_t val) {
+#if defined(__GNUC__)
+    return ESP_SZ(sizeof(unsigned long) * CHAR_BIT - 1 - __builtin_clzl((unsigned long)val));
+#else /* defined(__GNUC__) */
+    size_t bit = 0;
+    while (val >>= 1) {
+        bit++;
+    }
+    return bit;
+#endif /* !defined(__GNUC__) */
+}
+
+/**
+ * \brief           Get index of least significant set bit
+ * \param[in]       val: Non-zero input value
+ * \return          Bit index, starting with `0` for LSB
+ */
+static size_t
+mem_ffs(uint32_t val) {
+#if defined(__GNUC__)
+    return ESP_SZ(__builtin_ctzl((unsigned long)val));
+#else /* defined(__GNUC__) */
+    size_t bit = 0;
+    while (!(val & 0x01)) {
+        val >>= 1;
+        bit++;
+    }
+    return bit;
+#endif /* !defined(__GNUC__) */
+}
+
+/**
+ * \brief           Map block size to first and second level list indexes
+ * \param[in]       size: Block size including metadata
+ * \param[out]      fl: First level index
+ * \param[out]      sl: Second level index
+ */
+static void
+mem_mapping(size_t size, size_t* fl, size_t* sl) {
+    size_t f, s;
+
+    if (size < MEM_SMALL_BLOCK_SIZE) {
+        f = 0;
+        s = size >> MEM_ALIGN_LOG2;             /* Small blocks are split linearly by alignment */
+    } else {
+        f = mem_fls(size);
+        s = (size >> (f - MEM_SL_INDEX_LOG2)) ^ MEM_SL_INDEX_COUNT;
+        f -= MEM_FL_INDEX_SHIFT - 1;
+    }
+    *fl = f;
+    *sl = s;
+}
+
+/**
+ * \brief           Remove free block from its size class list
+ * \param[in]       block: Free block to remove
+ */
+static void
+mem_removefreeblock(mem_block_t* block) {
+    size_t fl, sl;
+
+    mem_mapping(MEM_BLOCK_SIZE(block), &fl, &sl);
+    if (block->next_free != NULL) {
+        block->next_free->prev_free = block->prev_free;
+    }
+    if (block->prev_free != NULL) {
+        block->prev_free->next_free = block->next_free;
+    } else {                                    /* Block is head of list */
+        free_lists[fl][sl] = block->next_free;
+        if (free_lists[fl][sl] == NULL) {       /* List is now empty, clear bitmaps */
+            sl_bitmap[fl] &= ~(1UL << sl);
+            if (!sl_bitmap[fl]) {
+                fl_bitmap &= ~(1UL << fl);
+            }
+        }
+    }
+}
+
+/**
+ * \brief           Insert a new block to list of free blocks for its size class
+ * \param[in]       nb: Pointer to new block to insert with known size
+ */
+static void
+mem_insertfreeblock(mem_block_t* nb) {
+    size_t fl, sl;
+
+    mem_mapping(MEM_BLOCK_SIZE(nb), &fl, &sl);
+    nb->prev_free = NULL;
+    nb->next_free = free_lists[fl][sl];
+    if (nb->next_free != NULL) {
+        nb->next_free->prev_free = nb;
+    }
+    free_lists[fl][sl] = nb;
+    fl_bitmap |= 1UL << fl;
+    sl_bitmap[fl] |= 1UL << sl;
+}
+
+/**
+ * \brief           Find free block large enough for requested size
+ *
+ * Size is first rounded up to next size class, which guarantees that
+ * head of any non-empty list found with bitmap search is large enough.
+ * Only when this fails, list of exact size class is scanned,
+ * to still satisfy requests close to size of largest free block
+ *
+ * \param[in]       size: Block size including metadata
+ * \return          Free block on success, `NULL` otherwise
+ */
+static mem_block_t *
+mem_findfreeblock(size_t size) {
+    mem_block_t* block;
+    size_t fl, sl, sl_map, fl_map;
+
+    if (size >= MEM_SMALL_BLOCK_SIZE) {
+        mem_mapping(size + (ESP_SZ(1) << (mem_fls(size) - MEM_SL_INDEX_LOG2)) - 1, &fl, &sl);
+    } else {
+        mem_mapping(size, &fl, &sl);
+    }
+
+    /* Find first non-empty list with the same or larger size class */
+    sl_map = fl < MEM_FL_INDEX_COUNT ? (sl_bitmap[fl] & (~0UL << sl)) : 0;
+    if (!sl_map && (fl + 1) < MEM_FL_INDEX_COUNT) {
+        fl_map = fl_bitmap & (~0UL << (fl + 1));
+        if (fl_map) {
+            fl = mem_ffs(fl_map);
+            sl_map = sl_bitmap[fl];
+        }
+    }
+    if (sl_map) {
+        return free_lists[fl][mem_ffs(sl_map)];
+    }
+
+    /* Fallback to first fit in exact size class */
+    mem_mapping(size, &fl, &sl);
+    for (block = free_lists[fl][sl]; block != NULL; block = block->next_free) {
+        if (MEM_BLOCK_SIZE(block) >= size) {
+            break;
+        }
+    }
+    return block;
+}
+
+/**
+ * \brief           Assign memory for HEAP allocations
+ * \param[in]       regions: Pointer to list of regions.
+ *                  Set regions in ascending order by address
+ * \param[in]       len: Number of regions to assign
+ */
+static uint8_t
+mem_assignmem(const esp_mem_region_t* regions, size_t len) {
+    uint8_t* mem_start_addr;
+    size_t mem_size;
+    mem_block_t *first_block, *end_block;
+
+    if (mem_regions_assigned) {                 /* Regions already defined */
+        return 0;
+    }
+
+    /* Check if region address are linear and rising */
+    mem_start_addr = (uint8_t *)0;
+    for (size_t i = 0; i < len; i++) {
+        if (mem_start_addr >= (uint8_t *)regions[i].start_addr) {   /* Check if previous greater than current */
+            return 0;                           /* Return as invalid and failed */
+        }
+        mem_start_addr = (uint8_t *)regions[i].start_addr;  /* Save as previous address */
+    }
+
+    for (; len--; regions++) {
+        /* Get start address and check memory alignment */
+        mem_size = regions->size;
+        mem_start_addr = (uint8_t *)regions->start_addr;
+        if (ESP_SZ(mem_start_addr) & MEM_ALIGN_BITS) {
+            if (mem_size < MEM_ALIGN_NUM) {
+                continue;
+            }
+            mem_start_addr += MEM_ALIGN_NUM - (ESP_SZ(mem_start_addr) & MEM_ALIGN_BITS);
+            mem_size -= mem_start_addr - (uint8_t *)regions->start_addr;
+        }
+        mem_size &= ~MEM_ALIGN_BITS;            /* Clear lower bits of memory size only */
+
+        /* Single block cannot exceed largest size class */
+        if (mem_size > (MEM_BLOCK_MAX_SIZE + MEMBLOCK_METASIZE)) {
+            mem_size = MEM_BLOCK_MAX_SIZE + MEMBLOCK_METASIZE;
+        }
+        if (mem_size < (MEMBLOCK_MINSIZE + MEMBLOCK_METASIZE)) {
+            continue;
+        }
+
+        /*
+         * Each region consists of one big free block
+         * followed by allocated end block with size 0,
+         * which prevents merging over region boundary
+         */
+        first_block = (mem_block_t *)mem_start_addr;
+        first_block->prev_phys = NULL;
+        first_block->size = mem_size - MEMBLOCK_METASIZE;
+
+        end_block = MEM_BLOCK_NEXT_PHYS(first_block);
+        end_block->prev_phys = first_block;
+        end_block->size = MEM_ALLOC_BIT;
+
+        mem_insertfreeblock(first_block);
+        mem_available_bytes += first_block->size;
+        mem_regions_assigned = 1;
+    }
+
+    return mem_regions_assigned;                /* Regions set as expected */
+}
+
+/**
+ * \brief           Allocate memory of specific size
+ * \param[in]       size: Number of bytes to allocate
+ * \return          Memory address on success, `NULL` otherwise
+ */
+static void *
+mem_alloc(size_t size) {
+    mem_block_t *block, *next;
+
+    if (!mem_regions_assigned || size == 0 || size > MEM_BLOCK_MAX_SIZE) {
+        return NULL;
+    }
+
+    size = MEM_ALIGN(size) + MEMBLOCK_METASIZE; /* Increase size for metadata */
+    if (size < MEMBLOCK_MINSIZE) {
+        size = MEMBLOCK_MINSIZE;                /* Free block must hold list pointers */
+    }
+    if (size > mem_available_bytes || size > MEM_BLOCK_MAX_SIZE) { /* Check if we have enough memory available */
+        return NULL;
+    }
+
+    if ((block = mem_findfreeblock(size)) == NULL) {
+        return NULL;                            /* No free block of required size */
+    }
+    mem_removefreeblock(block);
+
+    /* Split block when remaining part can be used as standalone free block */
+    if ((block->size - size) >= MEMBLOCK_MINSIZE) {
+        next = (mem_block_t *)(((uint8_t *)block) + size);
+        next->size = block->size - size;
+        next->prev_phys = block;
+        MEM_BLOCK_NEXT_PHYS(next)->prev_phys = next;
+        block->size = size;
+        mem_insertfreeblock(next);
+    }
+    mem_available_bytes -= block->size;         /* Decrease available memory */
+    block->size |= MEM_ALLOC_BIT;               /* Set allocated bit = memory is allocated */
+    return (void *)(((uint8_t *)block) + MEMBLOCK_METASIZE);
+}
+
+/**
+ * \brief           Free memory
+ * \param[in]       ptr: Pointer to memory previously returned using \ref esp_mem_malloc,
+ *                      \ref esp_mem_calloc or \ref esp_mem_realloc functions
+ */
+static void
+mem_free(void* ptr) {
+    mem_block_t *block, *prev, *next;
+
+    if (ptr == NULL) {                          /* To be in compliance with C free function */
+        return;
+    }
+
+    block = MEM_BLOCK_FROM_PTR(ptr);            /* Get block data pointer from input pointer */
+    if (MEM_BLOCK_IS_FREE(block)) {             /* Block must be allocated */
+        return;
+    }
+    block->size &= ~MEM_ALLOC_BIT;              /* Clear allocated bit */
+    mem_available_bytes += block->size;         /* Increase available bytes back */
+
+    /* Merge with physically previous block if free */
+    prev = block->prev_phys;
+    if (prev != NULL && MEM_BLOCK_IS_FREE(prev)) {
+        mem_removefreeblock(prev);
+        prev->size += block->size;
+        block = prev;
+    }
+
+    /* Merge with physically next block if free. End block is always marked as allocated */
+    next = MEM_BLOCK_NEXT_PHYS(block);
+    if (MEM_BLOCK_IS_FREE(next)) {
+        mem_removefreeblock(next);
+        block->size += next->size;
+    }
+    MEM_BLOCK_NEXT_PHYS(block)->prev_phys = block;
+    mem_insertfreeblock(block);
+}
+
+#if ESP_CFG_MEM_STAT
+/**
+ * \brief           Count free blocks and find the largest one
+ * \param[out]      cnt: Output variable to save number of free blocks
+ * \param[out]      largest: Output variable to save size of largest free block
+ */
+static void
+mem_scanfree(size_t* cnt, size_t* largest) {
+    mem_block_t* block;
+    uint32_t fl_map, sl_map;
+    size_t fl;
+
+    *cnt = 0;
+    *largest = 0;
+    for (fl_map = fl_bitmap; fl_map; fl_map &= fl_map - 1) {
+        fl = mem_ffs(fl_map);
+        for (sl_map = sl_bitmap[fl]; sl_map; sl_map &= sl_map - 1) {
+            for (block = free_lists[fl][mem_ffs(sl_map)]; block != NULL; block = block->next_free) {
+                ++*cnt;
+                *largest = ESP_MAX(*largest, MEM_BLOCK_SIZE(block));
+            }
+        }
+    }
+}
+#endif /* ESP_CFG_MEM_STAT */
+
+#else /* ESP_CFG_MEM_TLSF */
 
 static mem_block_t start_block;                 /*!< First block data for allocations */
 static mem_block_t* end_block;                  /*!< Pointer to last block in linked list */
@@ -263,10 +655,9 @@ mem_alloc(size_t size) {
              */
             mem_insertfreeblock(next);          /* Insert free memory block to list of free memory blocks (linked list chain) */
         }
+        mem_available_bytes -= curr->size;      /* Decrease available memory, block may be larger than requested when not split */
         curr->size |= MEM_ALLOC_BIT;            /* Set allocated bit = memory is allocated */
         curr->next = NULL;                      /* Clear next free block pointer as there is no one */
-
-        mem_available_bytes -= size;            /* Decrease available memory */
     } else {
         /* Allocation failed, no free blocks of required size */
     }
@@ -303,6 +694,103 @@ mem_free(void* ptr) {
     }
 }
 
+#if ESP_CFG_MEM_STAT
+/**
+ * \brief           Count free blocks and find the largest one
+ * \param[out]      cnt: Output variable to save number of free blocks
+ * \param[out]      largest: Output variable to save size of largest free block
+ */
+static void
+mem_scanfree(size_t* cnt, size_t* largest) {
+    *cnt = 0;
+    *largest = 0;
+    for (mem_block_t* block = start_block.next; block != NULL; block = block->next) {
+        if (block->size > 0) {                  /* End blocks of regions have size 0 */
+            ++*cnt;
+            *largest = ESP_MAX(*largest, block->size);
+        }
+    }
+}
+#endif /* ESP_CFG_MEM_STAT */
+
+#endif /* !ESP_CFG_MEM_TLSF */
+
+#if ESP_CFG_MEM_STAT_TAG
+/**
+ * \brief           Account allocated block to tag
+ * \param[in]       block: Allocated block
+ * \param[in]       tag: Tag to assign to block
+ */
+static void
+mem_tag_block(mem_block_t* block, size_t tag) {
+    esp_mem_tag_stat_t* ts = &mem_stat.tags[tag];
+
+    block->tag = tag;
+    ts->bytes += MEM_BLOCK_SIZE(block);
+    ts->max_bytes = ESP_MAX(ts->max_bytes, ts->bytes);
+    ts->blocks++;
+}
+
+/**
+ * \brief           Remove allocated block from its tag accounting
+ * \param[in]       block: Allocated block
+ */
+static void
+mem_untag_block(mem_block_t* block) {
+    esp_mem_tag_stat_t* ts = &mem_stat.tags[block->tag];
+
+    ts->bytes -= MEM_BLOCK_SIZE(block);
+    ts->blocks--;
+}
+#endif /* ESP_CFG_MEM_STAT_TAG */
+
+/**
+ * \brief           Allocate memory and update statistics
+ * \param[in]       size: Number of bytes to allocate
+ * \return          Memory address on success, `NULL` otherwise
+ */
+static void *
+mem_alloc_stat(size_t size) {
+    void* ptr;
+
+    ptr = mem_alloc(size);
+#if ESP_CFG_MEM_STAT
+    if (ptr != NULL) {
+        size_t i;
+
+        /* Entry `i` counts sizes up to `16 << i` bytes */
+        for (i = 0; i < (ESP_MEM_STAT_HIST_LEN - 1) && size > (ESP_SZ(16) << i); i++) {}
+        mem_stat.hist[i]++;
+        mem_stat.alloc_cnt++;
+        mem_stat.min_free = ESP_MIN(mem_stat.min_free, mem_available_bytes);
+#if ESP_CFG_MEM_STAT_TAG
+        mem_tag_block(MEM_BLOCK_FROM_PTR(ptr), ESP_MEM_TAG_NONE);
+#endif /* ESP_CFG_MEM_STAT_TAG */
+    } else if (size > 0) {
+        mem_stat.fail_cnt++;
+        mem_stat.last_fail_size = size;
+    }
+#endif /* ESP_CFG_MEM_STAT */
+    return ptr;
+}
+
+/**
+ * \brief           Free memory and update statistics
+ * \param[in]       ptr: Pointer to memory to free
+ */
+static void
+mem_free_stat(void* ptr) {
+#if ESP_CFG_MEM_STAT
+    if (ptr != NULL && (MEM_BLOCK_FROM_PTR(ptr)->size & MEM_ALLOC_BIT)) {
+        mem_stat.free_cnt++;
+#if ESP_CFG_MEM_STAT_TAG
+        mem_untag_block(MEM_BLOCK_FROM_PTR(ptr));
+#endif /* ESP_CFG_MEM_STAT_TAG */
+    }
+#endif /* ESP_CFG_MEM_STAT */
+    mem_free(ptr);
+}
+
 /**
  * \brief           Allocate memory of specific size
  * \param[in]       size: Number of bytes to allocate
@@ -313,7 +801,7 @@ mem_calloc(size_t num, size_t size) {
     void* ptr;
     size_t tot_len = num * size;
 
-    if ((ptr = mem_alloc(tot_len)) != NULL) {   /* Try to allocate memory */
+    if ((ptr = mem_alloc_stat(tot_len)) != NULL) {   /* Try to allocate memory */
         ESP_MEMSET(ptr, 0x00, tot_len);         /* Reset entire memory */
     }
     return ptr;
@@ -333,14 +821,18 @@ mem_realloc(void* ptr, size_t size) {
     size_t old_size;
 
     if (ptr == NULL) {                          /* If pointer is not valid */
-        return mem_alloc(size);                 /* Only allocate memory */
+        return mem_alloc_stat(size);            /* Only allocate memory */
     }
 
     old_size = MEM_BLOCK_USER_SIZE(ptr);       	/* Get size of old pointer */
-    new_ptr = mem_alloc(size);                  /* Try to allocate new memory block */
+    new_ptr = mem_alloc_stat(size);             /* Try to allocate new memory block */
     if (new_ptr != NULL) {
         ESP_MEMCPY(new_ptr, ptr, ESP_MIN(size, old_size));  /* Copy old data to new array */
-        mem_free(ptr);                          /* Free old pointer */
+#if ESP_CFG_MEM_STAT_TAG
+        mem_untag_block(MEM_BLOCK_FROM_PTR(new_ptr));
+        mem_tag_block(MEM_BLOCK_FROM_PTR(new_ptr), MEM_BLOCK_FROM_PTR(ptr)->tag);   /* Keep tag of old block */
+#endif /* ESP_CFG_MEM_STAT_TAG */
+        mem_free_stat(ptr);                     /* Free old pointer */
     }
     return new_ptr;
 }
@@ -354,9 +846,9 @@ mem_realloc(void* ptr, size_t size) {
 void *
 esp_mem_malloc(size_t size) {
     void* ptr;
-    esp_core_lock();
+    espi_lock(ESP_LOCK_MEM);
     ptr = mem_calloc(1, size);                  /* Allocate memory and return pointer */
-    esp_core_unlock();
+    espi_unlock(ESP_LOCK_MEM);
     ESP_DEBUGW(ESP_CFG_DBG_MEM | ESP_DBG_TYPE_TRACE, ptr == NULL,
         "[MEM] Allocation failed: %d bytes\r\n", (int)size);
     ESP_DEBUGW(ESP_CFG_DBG_MEM | ESP_DBG_TYPE_TRACE, ptr != NULL,
@@ -375,9 +867,9 @@ esp_mem_malloc(size_t size) {
  */
 void *
 esp_mem_realloc(void* ptr, size_t size) {
-    esp_core_lock();
+    espi_lock(ESP_LOCK_MEM);
     ptr = mem_realloc(ptr, size);               /* Reallocate and return pointer */
-    esp_core_unlock();
+    espi_unlock(ESP_LOCK_MEM);
     ESP_DEBUGW(ESP_CFG_DBG_MEM | ESP_DBG_TYPE_TRACE, ptr == NULL,
         "[MEM] Reallocation failed: %d bytes\r\n", (int)size);
     ESP_DEBUGW(ESP_CFG_DBG_MEM | ESP_DBG_TYPE_TRACE, ptr != NULL,
@@ -395,9 +887,9 @@ esp_mem_realloc(void* ptr, size_t size) {
 void *
 esp_mem_calloc(size_t num, size_t size) {
     void* ptr;
-    esp_core_lock();
+    espi_lock(ESP_LOCK_MEM);
     ptr = mem_calloc(num, size);               /* Allocate memory and clear it to 0. Then return pointer */
-    esp_core_unlock();
+    espi_unlock(ESP_LOCK_MEM);
     ESP_DEBUGW(ESP_CFG_DBG_MEM | ESP_DBG_TYPE_TRACE, ptr == NULL,
         "[MEM] Callocation failed: %d bytes\r\n", (int)size * (int)num);
     ESP_DEBUGW(ESP_CFG_DBG_MEM | ESP_DBG_TYPE_TRACE, ptr != NULL,
@@ -419,9 +911,9 @@ esp_mem_free(void* ptr) {
     ESP_DEBUGF(ESP_CFG_DBG_MEM | ESP_DBG_TYPE_TRACE,
         "[MEM] Free size: %d, address: %p\r\n",
         (int)MEM_BLOCK_USER_SIZE(ptr), ptr);
-    esp_core_lock();
-    mem_free(ptr);
-    esp_core_unlock();
+    espi_lock(ESP_LOCK_MEM);
+    mem_free_stat(ptr);
+    espi_unlock(ESP_LOCK_MEM);
 }
 
 /**
@@ -436,9 +928,68 @@ uint8_t
 esp_mem_assignmemory(const esp_mem_region_t* regions, size_t len) {
     uint8_t ret;
     ret = mem_assignmem(regions, len);          /* Assign memory */
+#if ESP_CFG_MEM_STAT
+    if (ret) {
+        mem_stat.total = mem_available_bytes;
+        mem_stat.min_free = mem_available_bytes;
+    }
+#endif /* ESP_CFG_MEM_STAT */
     return ret;
 }
 
+#if ESP_CFG_MEM_STAT || __DOXYGEN__
+
+/**
+ * \brief           Get memory manager statistics
+ * \param[out]      stat: Pointer to output structure to fill
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ * \note            Function is available only when \ref ESP_CFG_MEM_STAT is `1`
+ */
+espr_t
+esp_mem_get_stat(esp_mem_stat_t* stat) {
+    ESP_ASSERT("stat != NULL", stat != NULL);
+
+    espi_lock(ESP_LOCK_MEM);
+    ESP_MEMCPY(stat, &mem_stat, sizeof(*stat));
+    stat->free = mem_available_bytes;
+    mem_scanfree(&stat->free_blocks, &stat->largest_free);
+    espi_unlock(ESP_LOCK_MEM);
+    return espOK;
+}
+
+#endif /* ESP_CFG_MEM_STAT || __DOXYGEN__ */
+
+#if ESP_CFG_MEM_STAT_TAG || __DOXYGEN__
+
+/**
+ * \brief           Assign allocation site tag to memory block
+ *
+ * Memory is accounted as \ref ESP_MEM_TAG_NONE after allocation.
+ * Call this function after successful allocation to move it to another tag
+ *
+ * \param[in]       ptr: Pointer to memory previously returned using \ref esp_mem_malloc,
+ *                      \ref esp_mem_calloc or \ref esp_mem_realloc functions
+ * \param[in]       tag: Tag to assign. Member of \ref esp_mem_tag_t enumeration
+ * \note            Function is available only when \ref ESP_CFG_MEM_STAT_TAG is `1`
+ */
+void
+esp_mem_set_tag(void* ptr, esp_mem_tag_t tag) {
+    mem_block_t* block;
+
+    if (ptr == NULL || tag >= ESP_MEM_TAG_END) {
+        return;
+    }
+    block = MEM_BLOCK_FROM_PTR(ptr);
+    espi_lock(ESP_LOCK_MEM);
+    if (block->size & MEM_ALLOC_BIT) {
+        mem_untag_block(block);
+        mem_tag_block(block, tag);
+    }
+    espi_unlock(ESP_LOCK_MEM);
+}
+
+#endif /* ESP_CFG_MEM_STAT_TAG || __DOXYGEN__ */
+
 #endif /* !ESP_CFG_MEM_CUSTOM || __DOXYGEN__ */
 
 /**
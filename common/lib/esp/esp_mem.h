@@ -46,8 +46,54 @@ extern "C" {
  * \{
  */
 
+/**
+ * \brief           Allocation site tags for memory statistics
+ */
+typedef enum {
+    ESP_MEM_TAG_NONE = 0x00,                    /*!< Allocation without specific tag */
+    ESP_MEM_TAG_PBUF,                           /*!< Packet buffer */
+    ESP_MEM_TAG_MSG,                            /*!< API message */
+    ESP_MEM_TAG_CONN_BUFF,                      /*!< Connection and netconn transmit buffer */
+    ESP_MEM_TAG_TIMEOUT,                        /*!< Timeout entry */
+    ESP_MEM_TAG_END,                            /*!< Last entry, used to count tags */
+} esp_mem_tag_t;
+
 #if !ESP_CFG_MEM_CUSTOM || __DOXYGEN__
 
+/**
+ * \brief           Number of entries in allocation size histogram
+ */
+#define ESP_MEM_STAT_HIST_LEN               8
+
+/**
+ * \brief           Memory usage of single allocation site tag
+ */
+typedef struct {
+    size_t bytes;                               /*!< Currently allocated bytes, including block metadata */
+    size_t max_bytes;                           /*!< Maximal allocated bytes at the same time */
+    size_t blocks;                              /*!< Number of currently allocated blocks */
+} esp_mem_tag_stat_t;
+
+/**
+ * \brief           Memory manager statistics
+ */
+typedef struct {
+    size_t total;                               /*!< Total heap size in units of bytes */
+    size_t free;                                /*!< Currently free bytes */
+    size_t min_free;                            /*!< Minimal free bytes since memory was assigned */
+    size_t largest_free;                        /*!< Size of largest free block */
+    size_t free_blocks;                         /*!< Number of free blocks */
+    uint32_t alloc_cnt;                         /*!< Number of successful allocations */
+    uint32_t free_cnt;                          /*!< Number of free operations */
+    uint32_t fail_cnt;                          /*!< Number of failed allocations */
+    size_t last_fail_size;                      /*!< Requested size of last failed allocation */
+    uint32_t hist[ESP_MEM_STAT_HIST_LEN];       /*!< Histogram of requested sizes.
+                                                    Entry `i` counts sizes up to `16 << i` bytes, last entry counts all larger sizes */
+#if ESP_CFG_MEM_STAT_TAG || __DOXYGEN__
+    esp_mem_tag_stat_t tags[ESP_MEM_TAG_END];   /*!< Usage per allocation site tag */
+#endif /* ESP_CFG_MEM_STAT_TAG || __DOXYGEN__ */
+} esp_mem_stat_t;
+
 /**
  * \brief           Single memory region descriptor
  */
@@ -58,8 +104,18 @@ typedef struct {
 
 uint8_t esp_mem_assignmemory(const esp_mem_region_t* regions, size_t size);
 
+#if ESP_CFG_MEM_STAT || __DOXYGEN__
+espr_t  esp_mem_get_stat(esp_mem_stat_t* stat);
+#endif /* ESP_CFG_MEM_STAT || __DOXYGEN__ */
+
 #endif /* !ESP_CFG_MEM_CUSTOM || __DOXYGEN__ */
 
+#if (ESP_CFG_MEM_STAT_TAG && !ESP_CFG_MEM_CUSTOM) || __DOXYGEN__
+void    esp_mem_set_tag(void* ptr, esp_mem_tag_t tag);
+#else
+#define esp_mem_set_tag(ptr, tag)           do { ESP_UNUSED(ptr); ESP_UNUSED(tag); } while (0)
+#endif /* (ESP_CFG_MEM_STAT_TAG && !ESP_CFG_MEM_CUSTOM) || __DOXYGEN__ */
+
 void*   esp_mem_malloc(size_t size);
 void*   esp_mem_realloc(void* ptr, size_t size);
 void*   esp_mem_calloc(size_t num, size_t size);
@@ -0,0 +1,318 @@
+/**
+ * \file            esp_mempool.c
+ * \brief           Fixed-block memory pools
+ */
+
+/*
+ * Copyright (c) 2018 Tilen Majerle
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE
+ * AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of ESP-AT library.
+ *
+ * Author:          Tilen MAJERLE <tilen@majerle.eu>
+ */
+#include "esp/esp_private.h"
+#include "esp/esp_mempool.h"
+#include "esp/esp_mem.h"
+#include <limits.h>
+
+#if !__DOXYGEN__
+typedef struct {
+    uint64_t* mem;                              /*!< Pointer to pool storage */
+    size_t block_size;                          /*!< Aligned size of single block */
+    size_t num;                                 /*!< Number of blocks in pool */
+    uint32_t* map;                              /*!< Allocation bitmap, bit is set when block is used */
+    uint32_t used;                              /*!< Number of currently used blocks */
+    uint32_t max_used;                          /*!< High-water mark of used blocks */
+    uint32_t fallback;                          /*!< Number of allocations served from heap */
+} mempool_t;
+#endif /* !__DOXYGEN__ */
+
+#define MEMPOOL_BITS                (sizeof(uint32_t) * CHAR_BIT)
+#define MEMPOOL_MAP_LEN(num)        (((num) + MEMPOOL_BITS - 1) / MEMPOOL_BITS)
+#define MEMPOOL_MEM_LEN(size, num)  ((ESP_MEM_ALIGN(size) * (num) + sizeof(uint64_t) - 1) / sizeof(uint64_t))
+
+/* Define storage and allocation map for single pool */
+#define MEMPOOL_DEFINE(name, size, num)             \
+static uint64_t name ## _mem[MEMPOOL_MEM_LEN(size, num)] ESP_CFG_MEM_CPU_ATTR;  \
+static uint32_t name ## _map[MEMPOOL_MAP_LEN(num)] ESP_CFG_MEM_CPU_ATTR
+
+/* Initializer for pool entry in pools table */
+#define MEMPOOL_ENTRY(name, size, num)  { name ## _mem, ESP_MEM_ALIGN(size), (num), name ## _map, 0, 0, 0 }
+
+/* Size of single block in packet buffer pool */
+#define MEMPOOL_PBUF_SIZE           (ESP_MEM_ALIGN(sizeof(esp_pbuf_t)) + ESP_CFG_IPD_MAX_BUFF_SIZE)
+
+/* Size of single block in small packet buffer pool */
+#define MEMPOOL_PBUF_SMALL_SIZE     (ESP_MEM_ALIGN(sizeof(esp_pbuf_t)) + ESP_CFG_MEMPOOL_PBUF_SMALL_SIZE)
+
+#if ESP_CFG_MEMPOOL_PBUF_NUM > 0
+MEMPOOL_DEFINE(pbuf_pool, MEMPOOL_PBUF_SIZE, ESP_CFG_MEMPOOL_PBUF_NUM);
+#endif /* ESP_CFG_MEMPOOL_PBUF_NUM > 0 */
+#if ESP_CFG_MEMPOOL_PBUF_SMALL_NUM > 0
+MEMPOOL_DEFINE(pbuf_small_pool, MEMPOOL_PBUF_SMALL_SIZE, ESP_CFG_MEMPOOL_PBUF_SMALL_NUM);
+#endif /* ESP_CFG_MEMPOOL_PBUF_SMALL_NUM > 0 */
+#if ESP_CFG_MEMPOOL_MSG_NUM > 0
+MEMPOOL_DEFINE(msg_pool, sizeof(esp_msg_t), ESP_CFG_MEMPOOL_MSG_NUM);
+#endif /* ESP_CFG_MEMPOOL_MSG_NUM > 0 */
+#if ESP_CFG_MEMPOOL_TIMEOUT_NUM > 0
+MEMPOOL_DEFINE(timeout_pool, sizeof(esp_timeout_t), ESP_CFG_MEMPOOL_TIMEOUT_NUM);
+#endif /* ESP_CFG_MEMPOOL_TIMEOUT_NUM > 0 */
+
+/* List of pools, disabled pools have no memory */
+static mempool_t pools[ESP_MEMPOOL_END] = {
+#if ESP_CFG_MEMPOOL_PBUF_NUM > 0
+    [ESP_MEMPOOL_PBUF] = MEMPOOL_ENTRY(pbuf_pool, MEMPOOL_PBUF_SIZE, ESP_CFG_MEMPOOL_PBUF_NUM),
+#endif /* ESP_CFG_MEMPOOL_PBUF_NUM > 0 */
+#if ESP_CFG_MEMPOOL_PBUF_SMALL_NUM > 0
+    [ESP_MEMPOOL_PBUF_SMALL] = MEMPOOL_ENTRY(pbuf_small_pool, MEMPOOL_PBUF_SMALL_SIZE, ESP_CFG_MEMPOOL_PBUF_SMALL_NUM),
+#endif /* ESP_CFG_MEMPOOL_PBUF_SMALL_NUM > 0 */
+#if ESP_CFG_MEMPOOL_MSG_NUM > 0
+    [ESP_MEMPOOL_MSG] = MEMPOOL_ENTRY(msg_pool, sizeof(esp_msg_t), ESP_CFG_MEMPOOL_MSG_NUM),
+#endif /* ESP_CFG_MEMPOOL_MSG_NUM > 0 */
+#if ESP_CFG_MEMPOOL_TIMEOUT_NUM > 0
+    [ESP_MEMPOOL_TIMEOUT] = MEMPOOL_ENTRY(timeout_pool, sizeof(esp_timeout_t), ESP_CFG_MEMPOOL_TIMEOUT_NUM),
+#endif /* ESP_CFG_MEMPOOL_TIMEOUT_NUM > 0 */
+};
+
+/* Memory manager tags for allocations served from heap */
+static const esp_mem_tag_t mempool_tags[ESP_MEMPOOL_END] = {
+    [ESP_MEMPOOL_PBUF] = ESP_MEM_TAG_PBUF,
+    [ESP_MEMPOOL_PBUF_SMALL] = ESP_MEM_TAG_PBUF,
+    [ESP_MEMPOOL_MSG] = ESP_MEM_TAG_MSG,
+    [ESP_MEMPOOL_TIMEOUT] = ESP_MEM_TAG_TIMEOUT,
+};
+
+/*
+ * Atomic operations on allocation bitmap and counters.
+ *
+ * With GCC compatible compilers, builtins compile to exclusive load/store
+ * instructions and pools are lock-free. Other compilers use core lock instead.
+ */
+#if defined(__GNUC__)
+#define MEMPOOL_LOAD(ptr)           __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define MEMPOOL_CAS(ptr, exp, des)  __atomic_compare_exchange_n((ptr), (exp), (des), 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+#define MEMPOOL_AND(ptr, val)       __atomic_fetch_and((ptr), (val), __ATOMIC_RELEASE)
+#define MEMPOOL_ADD(ptr, val)       __atomic_add_fetch((ptr), (val), __ATOMIC_RELAXED)
+#else /* defined(__GNUC__) */
+#define MEMPOOL_LOAD(ptr)           (*(ptr))
+#define MEMPOOL_CAS(ptr, exp, des)  mempool_cas((ptr), (exp), (des))
+#define MEMPOOL_AND(ptr, val)       mempool_and((ptr), (val))
+#define MEMPOOL_ADD(ptr, val)       mempool_add((ptr), (val))
+
+static uint8_t
+mempool_cas(uint32_t* ptr, uint32_t* exp, uint32_t des) {
+    uint8_t res = 0;
+    espi_lock(ESP_LOCK_MEM);
+    if (*ptr == *exp) {
+        *ptr = des;
+        res = 1;
+    } else {
+        *exp = *ptr;
+    }
+    espi_unlock(ESP_LOCK_MEM);
+    return res;
+}
+
+static uint32_t
+mempool_and(uint32_t* ptr, uint32_t val) {
+    uint32_t old;
+    espi_lock(ESP_LOCK_MEM);
+    old = *ptr;
+    *ptr &= val;
+    espi_unlock(ESP_LOCK_MEM);
+    return old;
+}
+
+static uint32_t
+mempool_add(uint32_t* ptr, uint32_t val) {
+    uint32_t res;
+    espi_lock(ESP_LOCK_MEM);
+    res = (*ptr += val);
+    espi_unlock(ESP_LOCK_MEM);
+    return res;
+}
+#endif /* !defined(__GNUC__) */
+
+/**
+ * \brief           Get index of first cleared bit in bitmap word
+ * \param[in]       val: Bitmap word with at least one cleared bit
+ * \return          Bit index, starting with `0` for LSB
+ */
+static size_t
+mempool_first_free(uint32_t val) {
+    val = ~val;
+#if defined(__GNUC__)
+    return ESP_SZ(__builtin_ctzl((unsigned long)val));
+#else /* defined(__GNUC__) */
+    size_t bit = 0;
+    while (!(val & 0x01)) {
+        val >>= 1;
+        bit++;
+    }
+    return bit;
+#endif /* !defined(__GNUC__) */
+}
+
+/**
+ * \brief           Take free block from pool
+ * \param[in]       pool: Pool to allocate from
+ * \return          Pointer to block on success, `NULL` if pool is empty
+ */
+static void *
+mempool_take(mempool_t* pool) {
+    uint32_t old, used, max_used;
+    size_t bit, idx;
+
+    for (size_t w = 0; w < MEMPOOL_MAP_LEN(pool->num); w++) {
+        old = MEMPOOL_LOAD(&pool->map[w]);
+        while (~old) {                          /* Try while word has free block */
+            bit = mempool_first_free(old);
+            idx = w * MEMPOOL_BITS + bit;
+            if (idx >= pool->num) {             /* Unused bits of last word */
+                break;
+            }
+            if (MEMPOOL_CAS(&pool->map[w], &old, old | (1UL << bit))) {
+                /* Update high-water mark */
+                used = MEMPOOL_ADD(&pool->used, 1);
+                max_used = MEMPOOL_LOAD(&pool->max_used);
+                while (used > max_used && !MEMPOOL_CAS(&pool->max_used, &max_used, used)) {}
+                return ((uint8_t *)pool->mem) + idx * pool->block_size;
+            }
+            /* Another thread modified bitmap, `old` holds new value */
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \brief           Allocate memory block for object of specific type
+ *
+ * Block is taken from dedicated pool in constant time when pool is enabled,
+ * not empty and requested size fits to pool block.
+ * Packet buffers which fit to \ref ESP_MEMPOOL_PBUF_SMALL block are taken from it first.
+ * Otherwise memory is allocated with \ref esp_mem_malloc
+ *
+ * \note            Unlike \ref esp_mem_malloc, memory taken from pool is not cleared
+ * \param[in]       id: Pool to allocate from. Member of \ref esp_mempool_id_t enumeration
+ * \param[in]       size: Number of bytes to allocate
+ * \return          Memory address on success, `NULL` otherwise
+ */
+void *
+esp_mempool_alloc(esp_mempool_id_t id, size_t size) {
+    mempool_t *pool, *last = NULL;
+    void* ptr = NULL;
+
+    if (id >= ESP_MEMPOOL_END) {
+        return NULL;
+    }
+
+    /* Small packet buffers do not need full size block */
+    pool = &pools[ESP_MEMPOOL_PBUF_SMALL];
+    if (id == ESP_MEMPOOL_PBUF && pool->num > 0 && size <= pool->block_size) {
+        last = pool;
+        ptr = mempool_take(pool);
+    }
+    pool = &pools[id];
+    if (ptr == NULL && pool->num > 0) {
+        last = pool;
+        if (size <= pool->block_size) {
+            ptr = mempool_take(pool);
+        }
+    }
+    if (ptr == NULL) {
+        if (last != NULL) {                     /* Disabled pools do not count fallbacks */
+            MEMPOOL_ADD(&last->fallback, 1);
+        }
+        ptr = esp_mem_malloc(size);
+        esp_mem_set_tag(ptr, mempool_tags[id]);
+    }
+    return ptr;
+}
+
+/**
+ * \brief           Free memory previously allocated with \ref esp_mempool_alloc
+ *
+ * Block is returned to the pool it was taken from,
+ * or to \ref ESP_MEM when it was allocated from heap
+ *
+ * \param[in]       ptr: Pointer to memory to free
+ */
+void
+esp_mempool_free(void* ptr) {
+    mempool_t* pool;
+    uint8_t* start;
+    size_t idx;
+
+    if (ptr == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < ESP_MEMPOOL_END; i++) {
+        pool = &pools[i];
+        start = (uint8_t *)pool->mem;
+        if (pool->num > 0 && (uint8_t *)ptr >= start
+            && (uint8_t *)ptr < (start + pool->num * pool->block_size)) {
+            idx = ((uint8_t *)ptr - start) / pool->block_size;
+            MEMPOOL_ADD(&pool->used, (uint32_t)-1);
+            MEMPOOL_AND(&pool->map[idx / MEMPOOL_BITS], ~(1UL << (idx % MEMPOOL_BITS)));
+            return;
+        }
+    }
+    esp_mem_free(ptr);
+}
+
+/**
+ * \brief           Free memory in safe way by invalidating pointer after freeing
+ * \param[in]       ptr: Pointer to pointer to memory allocated with \ref esp_mempool_alloc
+ * \return          `1` on success, `0` otherwise
+ */
+uint8_t
+esp_mempool_free_s(void** ptr) {
+    if (ptr != NULL) {
+        esp_mempool_free(*ptr);
+        *ptr = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * \brief           Get statistics of memory pool
+ * \param[in]       id: Pool to get statistics for. Member of \ref esp_mempool_id_t enumeration
+ * \param[out]      stat: Pointer to output structure to fill
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_mempool_get_stat(esp_mempool_id_t id, esp_mempool_stat_t* stat) {
+    mempool_t* pool;
+
+    ESP_ASSERT("id < ESP_MEMPOOL_END", id < ESP_MEMPOOL_END);
+    ESP_ASSERT("stat != NULL", stat != NULL);
+
+    pool = &pools[id];
+    stat->block_size = pool->block_size;
+    stat->num = pool->num;
+    stat->used = MEMPOOL_LOAD(&pool->used);
+    stat->max_used = MEMPOOL_LOAD(&pool->max_used);
+    stat->fallback = MEMPOOL_LOAD(&pool->fallback);
+    return espOK;
+}
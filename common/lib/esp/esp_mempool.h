@@ -0,0 +1,86 @@
+/**
+ * \file            esp_mempool.h
+ * \brief           Fixed-block memory pools
+ */
+
+/*
+ * Copyright (c) 2018 Tilen Majerle
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE
+ * AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of ESP-AT library.
+ *
+ * Author:          Tilen MAJERLE <tilen@majerle.eu>
+ */
+#ifndef ESP_HDR_MEMPOOL_H
+#define ESP_HDR_MEMPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp/esp.h"
+
+/**
+ * \ingroup         ESP
+ * \defgroup        ESP_MEMPOOL Fixed-block memory pools
+ * \brief           Preallocated pools for most frequently allocated objects
+ * \{
+ */
+
+/**
+ * \brief           List of available memory pools
+ */
+typedef enum {
+    ESP_MEMPOOL_PBUF = 0x00,                    /*!< Packet buffer with payload up to \ref ESP_CFG_IPD_MAX_BUFF_SIZE bytes */
+    ESP_MEMPOOL_PBUF_SMALL,                     /*!< Packet buffer with payload up to \ref ESP_CFG_MEMPOOL_PBUF_SMALL_SIZE bytes.
+                                                    Used first for small \ref ESP_MEMPOOL_PBUF requests */
+    ESP_MEMPOOL_MSG,                            /*!< API message */
+    ESP_MEMPOOL_TIMEOUT,                        /*!< Timeout entry */
+    ESP_MEMPOOL_END,                            /*!< Last entry, used to count pools */
+} esp_mempool_id_t;
+
+/**
+ * \brief           Memory pool statistics
+ */
+typedef struct {
+    size_t block_size;                          /*!< Size of single block in units of bytes */
+    size_t num;                                 /*!< Number of blocks in pool */
+    size_t used;                                /*!< Number of currently used blocks */
+    size_t max_used;                            /*!< High-water mark of used blocks */
+    size_t fallback;                            /*!< Number of allocations served from \ref ESP_MEM because pool was empty or too small.
+                                                    Counted only when pool is enabled */
+} esp_mempool_stat_t;
+
+void *          esp_mempool_alloc(esp_mempool_id_t id, size_t size);
+void            esp_mempool_free(void* ptr);
+uint8_t         esp_mempool_free_s(void** ptr);
+espr_t          esp_mempool_get_stat(esp_mempool_id_t id, esp_mempool_stat_t* stat);
+
+/**
+ * \}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESP_HDR_MEMPOOL_H */
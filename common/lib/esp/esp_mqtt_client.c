@@ -0,0 +1,969 @@
+/**
+ * \file            esp_mqtt_client.c
+ * \brief           MQTT client
+ */
+
+/*
+ * Copyright (c) 2018 Tilen Majerle
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE
+ * AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of ESP-AT library.
+ *
+ * Author:          Tilen MAJERLE <tilen@majerle.eu>
+ */
+#include "esp/esp_mqtt_client.h"
+#include "esp/esp_private.h"
+#include "esp/esp_conn.h"
+#include "esp/esp_mem.h"
+#include "esp/esp_stream.h"
+
+#if ESP_CFG_MQTT || __DOXYGEN__
+
+/**
+ * \brief           MQTT control packet types
+ */
+typedef enum {
+    MQTT_CONNECT = 0x01,                        /*!< Client requests a connection to a server */
+    MQTT_CONNACK = 0x02,                        /*!< Acknowledge connection request */
+    MQTT_PUBLISH = 0x03,                        /*!< Publish message */
+    MQTT_PUBACK = 0x04,                         /*!< Publish acknowledgement */
+    MQTT_SUBSCRIBE = 0x08,                      /*!< Subscribe to topics */
+    MQTT_SUBACK = 0x09,                         /*!< Subscribe acknowledgement */
+    MQTT_UNSUBSCRIBE = 0x0A,                    /*!< Unsubscribe from topics */
+    MQTT_UNSUBACK = 0x0B,                       /*!< Unsubscribe acknowledgement */
+    MQTT_PINGREQ = 0x0C,                        /*!< Ping request */
+    MQTT_PINGRESP = 0x0D,                       /*!< Ping response */
+    MQTT_DISCONNECT = 0x0E,                     /*!< Disconnect notification */
+} mqtt_msg_type_t;
+
+/**
+ * \brief           Client connection state
+ */
+typedef enum {
+    MQTT_CONN_DISCONNECTED,                     /*!< No connection to broker */
+    MQTT_CONN_CONNECTING,                       /*!< TCP connection is being established */
+    MQTT_CONNECTING,                            /*!< TCP connected, waiting for CONNACK */
+    MQTT_CONNECTED,                             /*!< Client accepted by broker */
+    MQTT_CONN_DISCONNECTING,                    /*!< DISCONNECT sent, waiting for TCP close */
+} mqtt_state_t;
+
+/**
+ * \brief           Request waiting for acknowledge from broker
+ */
+typedef struct {
+    uint8_t in_use;                             /*!< Status if entry is used */
+    mqtt_msg_type_t type;                       /*!< Packet type waiting for acknowledge */
+    uint16_t packet_id;                         /*!< Packet identifier */
+    uint32_t time;                              /*!< Time when request was sent */
+    void* arg;                                  /*!< User argument */
+} mqtt_request_t;
+
+/**
+ * \brief           MQTT client structure
+ */
+typedef struct esp_mqtt_client {
+    esp_conn_p conn;                            /*!< Active connection, `NULL` if not connected */
+    const esp_mqtt_client_info_t* info;         /*!< Connection information */
+    esp_mqtt_evt_fn evt_fn;                     /*!< Event callback function */
+    esp_mqtt_evt_t evt;                         /*!< Event data */
+    void* arg;                                  /*!< User argument */
+
+    mqtt_state_t state;                         /*!< Connection state */
+    uint16_t last_packet_id;                    /*!< Last used packet identifier */
+    uint32_t link_time;                         /*!< Time when connection was started */
+    uint32_t connect_time;                      /*!< Time when CONNECT was sent */
+    uint32_t tx_time;                           /*!< Time of last packet written to connection */
+    uint32_t ping_time;                         /*!< Time when PINGREQ was sent, `0` when no ping is pending */
+    size_t tx_pending;                          /*!< Number of bytes written but not flushed yet */
+    uint8_t tx_err;                             /*!< Set when write to connection buffer failed */
+
+    mqtt_request_t requests[ESP_CFG_MQTT_MAX_REQUESTS]; /*!< In-flight window of requests waiting for acknowledge */
+
+    esp_stream_t rx;                            /*!< Receive stream decoder */
+    uint8_t hdr;                                /*!< Fixed header byte of received packet */
+    uint8_t rem_len_byte;                       /*!< Last received remaining length byte */
+    uint8_t rem_len_mult;                       /*!< Number of decoded remaining length bytes */
+    size_t rem_len;                             /*!< Remaining length of received packet */
+    uint8_t* rx_buff;                           /*!< Receive buffer */
+    size_t rx_buff_len;                         /*!< Length of receive buffer */
+
+    esp_mqtt_client_stat_t stat;                /*!< Client statistics */
+    uint32_t stat_time;                         /*!< Start time of rate measurement interval */
+    uint32_t stat_pub;                          /*!< Published packets at start of rate measurement interval */
+} esp_mqtt_client_t;
+
+/**
+ * \brief           Close connection to broker
+ * \param[in]       client: Client handle
+ */
+static void
+close_conn(esp_mqtt_client_p client) {
+    if (client->state == MQTT_CONNECTED) {
+        client->state = MQTT_CONN_DISCONNECTING;    /* No more packets on this connection */
+    }
+    esp_conn_close(client->conn, 0);
+}
+
+/**
+ * \brief           Write data to connection buffer without flushing it
+ * \param[in]       client: Client handle
+ * \param[in]       data: Data to write
+ * \param[in]       len: Length of data
+ */
+static void
+write_data(esp_mqtt_client_p client, const void* data, size_t len) {
+    size_t mem;
+
+    if (client->tx_err || len == 0) {
+        return;
+    }
+    if (esp_conn_write(client->conn, data, len, 0, &mem) != espOK) {
+        client->tx_err = 1;
+        return;
+    }
+    /* Full buffers are sent by connection module, only count what stays in current one */
+    client->tx_pending = ESP_CFG_CONN_MAX_DATA_LEN - mem;
+}
+
+/**
+ * \brief           Write single byte to connection buffer
+ * \param[in]       client: Client handle
+ * \param[in]       num: Byte to write
+ */
+static void
+write_u8(esp_mqtt_client_p client, uint8_t num) {
+    write_data(client, &num, 1);
+}
+
+/**
+ * \brief           Write 16-bit value in network byte order
+ * \param[in]       client: Client handle
+ * \param[in]       num: Value to write
+ */
+static void
+write_u16(esp_mqtt_client_p client, uint16_t num) {
+    uint8_t d[2] = {ESP_U8(num >> 8), ESP_U8(num)};
+    write_data(client, d, sizeof(d));
+}
+
+/**
+ * \brief           Write length prefixed string
+ * \param[in]       client: Client handle
+ * \param[in]       str: String to write
+ * \param[in]       len: String length
+ */
+static void
+write_string(esp_mqtt_client_p client, const char* str, uint16_t len) {
+    write_u16(client, len);
+    write_data(client, str, len);
+}
+
+/**
+ * \brief           Write fixed header of packet
+ * \param[in]       client: Client handle
+ * \param[in]       type: Packet type
+ * \param[in]       flags: Lower 4 bits of fixed header
+ * \param[in]       rem_len: Remaining length of packet
+ */
+static void
+write_fixed_header(esp_mqtt_client_p client, mqtt_msg_type_t type, uint8_t flags, size_t rem_len) {
+    uint8_t d[5], i = 0;
+
+    d[i++] = ESP_U8((type << 4) | (flags & 0x0F));
+    do {
+        d[i] = ESP_U8(rem_len & 0x7F);
+        rem_len >>= 7;
+        if (rem_len > 0) {
+            d[i] |= 0x80;
+        }
+        ++i;
+    } while (rem_len > 0 && i < sizeof(d));
+    write_data(client, d, i);
+    client->tx_time = esp_sys_now();
+}
+
+/**
+ * \brief           Send written data to broker
+ * \param[in]       client: Client handle
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+static espr_t
+flush_data(esp_mqtt_client_p client) {
+    espr_t res = espOK;
+
+    if (client->tx_err) {
+        /* Stream is broken in the middle of packet, connection cannot be used anymore */
+        ESP_DEBUGF(ESP_CFG_DBG_MQTT | ESP_DBG_TYPE_TRACE | ESP_DBG_LVL_WARNING,
+            "[MQTT] Cannot write to connection, closing\r\n");
+        client->tx_err = 0;
+        client->tx_pending = 0;
+        close_conn(client);
+        return espERRMEM;
+    }
+    if (client->tx_pending > 0) {
+        res = esp_conn_write(client->conn, NULL, 0, 1, NULL);
+        client->tx_pending = 0;
+    }
+    return res;
+}
+
+/**
+ * \brief           Get new packet identifier
+ * \param[in]       client: Client handle
+ * \return          Packet identifier, never `0`
+ */
+static uint16_t
+create_packet_id(esp_mqtt_client_p client) {
+    if (++client->last_packet_id == 0) {
+        client->last_packet_id = 1;
+    }
+    return client->last_packet_id;
+}
+
+/**
+ * \brief           Get free request entry from in-flight window
+ * \param[in]       client: Client handle
+ * \return          Request entry or `NULL` if window is full
+ */
+static mqtt_request_t*
+request_create(esp_mqtt_client_p client, mqtt_msg_type_t type, void* arg) {
+    for (size_t i = 0; i < ESP_ARRAYSIZE(client->requests); ++i) {
+        mqtt_request_t* r = &client->requests[i];
+        if (!r->in_use) {
+            r->in_use = 1;
+            r->type = type;
+            r->packet_id = create_packet_id(client);
+            r->time = esp_sys_now();
+            r->arg = arg;
+            return r;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \brief           Find request waiting for acknowledge
+ * \param[in]       client: Client handle
+ * \param[in]       type: Packet type of request
+ * \param[in]       packet_id: Packet identifier
+ * \return          Request entry or `NULL` if not found
+ */
+static mqtt_request_t*
+request_find(esp_mqtt_client_p client, mqtt_msg_type_t type, uint16_t packet_id) {
+    for (size_t i = 0; i < ESP_ARRAYSIZE(client->requests); ++i) {
+        mqtt_request_t* r = &client->requests[i];
+        if (r->in_use && r->type == type && r->packet_id == packet_id) {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \brief           Release request and notify user about result
+ * \param[in]       client: Client handle
+ * \param[in]       r: Request to release
+ * \param[in]       res: Request result
+ */
+static void
+request_finish(esp_mqtt_client_p client, mqtt_request_t* r, espr_t res) {
+    r->in_use = 0;
+    if (r->type == MQTT_PUBLISH) {
+        if (res == espOK) {
+            ++client->stat.pub_acked;
+        } else {
+            ++client->stat.pub_failed;
+        }
+        client->evt.type = ESP_MQTT_EVT_PUBLISH;
+        client->evt.evt.publish.arg = r->arg;
+        client->evt.evt.publish.res = res;
+    } else {
+        client->evt.type = r->type == MQTT_SUBSCRIBE ? ESP_MQTT_EVT_SUBSCRIBE : ESP_MQTT_EVT_UNSUBSCRIBE;
+        client->evt.evt.sub_unsub_scribed.arg = r->arg;
+        client->evt.evt.sub_unsub_scribed.res = res;
+    }
+    client->evt_fn(client, &client->evt);
+}
+
+/**
+ * \brief           Send CONNECT packet after TCP connection is active
+ * \param[in]       client: Client handle
+ */
+static void
+send_connect(esp_mqtt_client_p client) {
+    const esp_mqtt_client_info_t* info = client->info;
+    uint16_t len_id, len_user = 0, len_pass = 0, len_wt = 0, len_wm = 0;
+    uint8_t flags = 0x02;                       /* Clean session */
+    size_t rem_len = 10;                        /* Protocol name, level, flags and keep-alive */
+
+    len_id = ESP_U16(strlen(info->id));
+    rem_len += 2 + len_id;
+    if (info->will_topic != NULL && info->will_message != NULL) {
+        len_wt = ESP_U16(strlen(info->will_topic));
+        len_wm = ESP_U16(strlen(info->will_message));
+        flags |= 0x04 | ESP_U8((info->will_qos & 0x03) << 3);
+        rem_len += 2 + len_wt + 2 + len_wm;
+    }
+    if (info->user != NULL) {
+        len_user = ESP_U16(strlen(info->user));
+        flags |= 0x80;
+        rem_len += 2 + len_user;
+    }
+    if (info->pass != NULL) {
+        len_pass = ESP_U16(strlen(info->pass));
+        flags |= 0x40;
+        rem_len += 2 + len_pass;
+    }
+
+    write_fixed_header(client, MQTT_CONNECT, 0, rem_len);
+    write_string(client, "MQTT", 4);            /* Protocol name */
+    write_u8(client, 4);                        /* Protocol level of MQTT 3.1.1 */
+    write_u8(client, flags);
+    write_u16(client, info->keep_alive);
+    write_string(client, info->id, len_id);
+    if (flags & 0x04) {
+        write_string(client, info->will_topic, len_wt);
+        write_string(client, info->will_message, len_wm);
+    }
+    if (flags & 0x80) {
+        write_string(client, info->user, len_user);
+    }
+    if (flags & 0x40) {
+        write_string(client, info->pass, len_pass);
+    }
+    if (flush_data(client) == espOK) {
+        client->state = MQTT_CONNECTING;
+        client->connect_time = esp_sys_now();
+    }
+}
+
+/**
+ * \brief           Process complete packet received from broker
+ * \param[in]       client: Client handle
+ */
+static void
+process_packet(esp_mqtt_client_p client) {
+    mqtt_msg_type_t type = (mqtt_msg_type_t)(client->hdr >> 4);
+    const uint8_t* d = client->rx_buff;
+    mqtt_request_t* r;
+    uint16_t packet_id;
+
+    if (client->rem_len > client->rx_buff_len) {
+        ESP_DEBUGF(ESP_CFG_DBG_MQTT | ESP_DBG_TYPE_TRACE | ESP_DBG_LVL_WARNING,
+            "[MQTT] Packet of %d bytes does not fit receive buffer, ignoring\r\n", (int)client->rem_len);
+        return;
+    }
+
+    switch (type) {
+        case MQTT_CONNACK: {
+            if (client->state != MQTT_CONNECTING || client->rem_len < 2) {
+                break;
+            }
+            client->stat.connack_time = esp_sys_now() - client->connect_time;
+            client->evt.type = ESP_MQTT_EVT_CONNECT;
+            client->evt.evt.connect.status = (esp_mqtt_conn_status_t)d[1];
+            if (d[1] == ESP_MQTT_CONN_STATUS_ACCEPTED) {
+                client->state = MQTT_CONNECTED;
+                client->ping_time = 0;
+            }
+            client->evt_fn(client, &client->evt);
+            if (client->state != MQTT_CONNECTED) {
+                close_conn(client);
+            }
+            break;
+        }
+        case MQTT_PUBLISH: {
+            size_t topic_len, pos;
+            esp_mqtt_qos_t qos = (esp_mqtt_qos_t)((client->hdr >> 1) & 0x03);
+
+            if (client->rem_len < 2) {
+                break;
+            }
+            topic_len = (size_t)((d[0] << 8) | d[1]);
+            pos = 2 + topic_len + (qos > ESP_MQTT_QOS_AT_MOST_ONCE ? 2 : 0);
+            if (pos > client->rem_len) {
+                break;
+            }
+            if (qos > ESP_MQTT_QOS_AT_MOST_ONCE) {
+                packet_id = ESP_U16((d[pos - 2] << 8) | d[pos - 1]);
+                write_fixed_header(client, MQTT_PUBACK, 0, 2);
+                write_u16(client, packet_id);
+                flush_data(client);
+            }
+            ++client->stat.pub_recv;
+            client->evt.type = ESP_MQTT_EVT_PUBLISH_RECV;
+            client->evt.evt.publish_recv.topic = &d[2];
+            client->evt.evt.publish_recv.topic_len = topic_len;
+            client->evt.evt.publish_recv.payload = &d[pos];
+            client->evt.evt.publish_recv.payload_len = client->rem_len - pos;
+            client->evt.evt.publish_recv.dup = ESP_U8((client->hdr >> 3) & 0x01);
+            client->evt.evt.publish_recv.qos = qos;
+            client->evt_fn(client, &client->evt);
+            break;
+        }
+        case MQTT_PUBACK:
+        case MQTT_SUBACK:
+        case MQTT_UNSUBACK: {
+            if (client->rem_len < 2) {
+                break;
+            }
+            packet_id = ESP_U16((d[0] << 8) | d[1]);
+            r = request_find(client, type == MQTT_PUBACK ? MQTT_PUBLISH :
+                                    (type == MQTT_SUBACK ? MQTT_SUBSCRIBE : MQTT_UNSUBSCRIBE), packet_id);
+            if (r != NULL) {
+                /* Return code 0x80 in SUBACK means failure */
+                request_finish(client, r, type == MQTT_SUBACK && client->rem_len > 2 && d[2] == 0x80 ? espERR : espOK);
+            }
+            break;
+        }
+        case MQTT_PINGRESP: {
+            client->ping_time = 0;
+            client->evt.type = ESP_MQTT_EVT_KEEP_ALIVE;
+            client->evt_fn(client, &client->evt);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static espr_t rx_hdr(esp_stream_t* s);
+static espr_t rx_rem_len(esp_stream_t* s);
+
+/**
+ * \brief           Receive step for packet body, variable header and payload
+ * \param[in]       s: Receive stream decoder
+ * \return          \ref espOK to continue decoding
+ */
+static espr_t
+rx_data(esp_stream_t* s) {
+    esp_mqtt_client_p client = s->arg;
+
+    process_packet(client);
+    esp_stream_expect(s, &client->hdr, 1, rx_hdr);
+    return espOK;
+}
+
+/**
+ * \brief           Receive step for fixed header byte
+ * \param[in]       s: Receive stream decoder
+ * \return          \ref espOK to continue decoding
+ */
+static espr_t
+rx_hdr(esp_stream_t* s) {
+    esp_mqtt_client_p client = s->arg;
+
+    client->rem_len = 0;
+    client->rem_len_mult = 0;
+    esp_stream_expect(s, &client->rem_len_byte, 1, rx_rem_len);
+    return espOK;
+}
+
+/**
+ * \brief           Receive step for remaining length byte
+ * \param[in]       s: Receive stream decoder
+ * \return          \ref espOK to continue decoding, \ref espERR on invalid length
+ */
+static espr_t
+rx_rem_len(esp_stream_t* s) {
+    esp_mqtt_client_p client = s->arg;
+    uint8_t ch = client->rem_len_byte;
+
+    client->rem_len |= (size_t)(ch & 0x7F) << (7 * client->rem_len_mult++);
+    if (ch & 0x80) {
+        if (client->rem_len_mult >= 4) {
+            ESP_DEBUGF(ESP_CFG_DBG_MQTT | ESP_DBG_TYPE_TRACE | ESP_DBG_LVL_WARNING,
+                "[MQTT] Invalid remaining length, closing\r\n");
+            close_conn(client);
+            return espERR;
+        }
+        esp_stream_expect(s, &client->rem_len_byte, 1, rx_rem_len);
+    } else {
+        /* Packets not fitting receive buffer are skipped without storing them */
+        esp_stream_expect(s, client->rem_len <= client->rx_buff_len ? client->rx_buff : NULL,
+                            client->rem_len, rx_data);
+    }
+    return espOK;
+}
+
+/**
+ * \brief           Reset receive decoder to wait for new packet
+ * \param[in]       client: Client handle
+ */
+static void
+rx_reset(esp_mqtt_client_p client) {
+    esp_stream_init(&client->rx, &client->hdr, 1, rx_hdr, client);
+}
+
+/**
+ * \brief           Periodic processing on connection poll event
+ * \param[in]       client: Client handle
+ */
+static void
+process_poll(esp_mqtt_client_p client) {
+    uint32_t now = esp_sys_now();
+    uint32_t keep_alive_ms = (uint32_t)client->info->keep_alive * 1000U;
+
+    if (client->state == MQTT_CONNECTING) {
+        if (now - client->connect_time >= ESP_CFG_MQTT_REQUEST_TIMEOUT) {
+            client->evt.type = ESP_MQTT_EVT_CONNECT;
+            client->evt.evt.connect.status = ESP_MQTT_CONN_STATUS_TIMEOUT;
+            client->evt_fn(client, &client->evt);
+            close_conn(client);
+        }
+        return;
+    }
+    if (client->state != MQTT_CONNECTED) {
+        return;
+    }
+
+    /* Fail requests without acknowledge */
+    for (size_t i = 0; i < ESP_ARRAYSIZE(client->requests); ++i) {
+        mqtt_request_t* r = &client->requests[i];
+        if (r->in_use && now - r->time >= ESP_CFG_MQTT_REQUEST_TIMEOUT) {
+            request_finish(client, r, espTIMEOUT);
+        }
+    }
+
+    if (keep_alive_ms > 0) {
+        if (client->ping_time != 0) {
+            if (now - client->ping_time >= keep_alive_ms) {
+                ESP_DEBUGF(ESP_CFG_DBG_MQTT | ESP_DBG_TYPE_TRACE | ESP_DBG_LVL_WARNING,
+                    "[MQTT] No ping response, closing\r\n");
+                close_conn(client);
+                return;
+            }
+        } else if (now - client->tx_time >= keep_alive_ms) {
+            write_fixed_header(client, MQTT_PINGREQ, 0, 0);
+            client->ping_time = now | 1;        /* Never zero */
+        }
+    }
+
+    /* Send coalesced packets */
+    flush_data(client);
+
+    if (now - client->stat_time >= 1000) {
+        client->stat.pub_rate = (client->stat.pub_sent - client->stat_pub) * 1000U / (now - client->stat_time);
+        client->stat_pub = client->stat.pub_sent;
+        client->stat_time = now;
+    }
+}
+
+/**
+ * \brief           Reset client to disconnected state and notify user
+ * \param[in]       client: Client handle
+ * \param[in]       status: Connect status, used when connection was not accepted yet
+ */
+static void
+process_closed(esp_mqtt_client_p client, esp_mqtt_conn_status_t status) {
+    mqtt_state_t state = client->state;
+
+    client->state = MQTT_CONN_DISCONNECTED;
+    client->conn = NULL;
+    client->tx_pending = 0;
+    client->tx_err = 0;
+    rx_reset(client);
+
+    for (size_t i = 0; i < ESP_ARRAYSIZE(client->requests); ++i) {
+        if (client->requests[i].in_use) {
+            request_finish(client, &client->requests[i], espCLOSED);
+        }
+    }
+
+    if (state == MQTT_CONN_CONNECTING) {
+        client->evt.type = ESP_MQTT_EVT_CONNECT;
+        client->evt.evt.connect.status = status;
+    } else {
+        client->evt.type = ESP_MQTT_EVT_DISCONNECT;
+        client->evt.evt.disconnect.is_accepted = ESP_U8(state == MQTT_CONNECTED || state == MQTT_CONN_DISCONNECTING);
+    }
+    client->evt_fn(client, &client->evt);
+}
+
+/**
+ * \brief           Connection callback
+ * \param[in]       evt: Event information
+ * \return          \ref espOK on success, member of \ref espr_t otherwise
+ */
+static espr_t
+mqtt_conn_cb(esp_evt_t* evt) {
+    esp_conn_p conn;
+    esp_mqtt_client_p client;
+
+    if (esp_evt_get_type(evt) == ESP_EVT_CONN_ERROR) {
+        client = esp_evt_conn_error_get_arg(evt);
+        if (client != NULL) {
+            process_closed(client, ESP_MQTT_CONN_STATUS_TCP_FAILED);
+        }
+        return espOK;
+    }
+
+    conn = esp_conn_get_from_evt(evt);
+    if (conn == NULL || (client = esp_conn_get_arg(conn)) == NULL) {
+        return espERR;
+    }
+
+    switch (esp_evt_get_type(evt)) {
+        case ESP_EVT_CONN_ACTIVE: {
+            client->conn = conn;
+            ++client->stat.connects;
+            client->stat.link_time = esp_sys_now() - client->link_time;
+            send_connect(client);
+            break;
+        }
+        case ESP_EVT_CONN_RECV: {
+            esp_pbuf_p pbuf = esp_evt_conn_recv_get_buff(evt);
+
+            esp_stream_feed_pbuf(&client->rx, pbuf);
+            esp_conn_recved(conn, pbuf);
+            break;
+        }
+        case ESP_EVT_CONN_SEND: {
+            if (esp_evt_conn_send_get_result(evt) == espOK) {
+                ++client->stat.tcp_sends;
+                client->stat.tx_bytes += esp_evt_conn_send_get_length(evt);
+            } else {
+                close_conn(client);
+            }
+            break;
+        }
+        case ESP_EVT_CONN_POLL: {
+            process_poll(client);
+            break;
+        }
+        case ESP_EVT_CONN_CLOSE: {
+            process_closed(client, ESP_MQTT_CONN_STATUS_TCP_FAILED);
+            break;
+        }
+        default:
+            break;
+    }
+    return espOK;
+}
+
+/**
+ * \brief           Allocate new MQTT client
+ * \param[in]       rx_buff_len: Length of receive buffer. Incoming packets longer than this are ignored
+ * \return          Client handle on success, `NULL` otherwise
+ */
+esp_mqtt_client_p
+esp_mqtt_client_new(size_t rx_buff_len) {
+    esp_mqtt_client_p client;
+
+    client = esp_mem_calloc(1, sizeof(*client) + rx_buff_len);
+    if (client != NULL) {
+        client->rx_buff = (uint8_t *)client + sizeof(*client);
+        client->rx_buff_len = rx_buff_len;
+    }
+    return client;
+}
+
+/**
+ * \brief           Delete MQTT client
+ * \note            Client must be disconnected first
+ * \param[in]       client: Client handle
+ */
+void
+esp_mqtt_client_delete(esp_mqtt_client_p client) {
+    esp_mem_free_s((void **)&client);
+}
+
+/**
+ * \brief           Connect to MQTT broker
+ *
+ * Function returns immediately, result is reported with \ref ESP_MQTT_EVT_CONNECT event
+ *
+ * \param[in]       client: Client handle
+ * \param[in]       host: Broker host name or IP. String must stay valid until connection is established
+ * \param[in]       port: Broker port
+ * \param[in]       evt_fn: Event callback function
+ * \param[in]       info: Client information, must stay valid while client is connected
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_mqtt_client_connect(esp_mqtt_client_p client, const char* host, esp_port_t port,
+                        esp_mqtt_evt_fn evt_fn, const esp_mqtt_client_info_t* info) {
+    espr_t res = espERR;
+
+    ESP_ASSERT("client != NULL", client != NULL);
+    ESP_ASSERT("host != NULL", host != NULL);
+    ESP_ASSERT("port > 0", port > 0);
+    ESP_ASSERT("evt_fn != NULL", evt_fn != NULL);
+    ESP_ASSERT("info != NULL && info->id != NULL", info != NULL && info->id != NULL);
+
+    if (esp_conn_get_poll_interval() == 0) {
+        /* Keep-alive and flushing of coalesced packets run on poll event */
+        return espERR;
+    }
+
+    esp_core_lock();
+    if (client->state == MQTT_CONN_DISCONNECTED) {
+        client->info = info;
+        client->evt_fn = evt_fn;
+        rx_reset(client);
+        client->stat_time = esp_sys_now();
+        client->stat_pub = client->stat.pub_sent;
+        client->link_time = esp_sys_now();
+        res = esp_conn_start(NULL, info->use_ssl ? ESP_CONN_TYPE_SSL : ESP_CONN_TYPE_TCP,
+                             host, port, client, mqtt_conn_cb, 0);
+        if (res == espOK) {
+            client->state = MQTT_CONN_CONNECTING;
+        }
+    }
+    esp_core_unlock();
+    return res;
+}
+
+/**
+ * \brief           Disconnect from MQTT broker
+ *
+ * Function returns immediately, \ref ESP_MQTT_EVT_DISCONNECT event is sent when connection is closed
+ *
+ * \param[in]       client: Client handle
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_mqtt_client_disconnect(esp_mqtt_client_p client) {
+    espr_t res = espERR;
+
+    ESP_ASSERT("client != NULL", client != NULL);
+
+    esp_core_lock();
+    if (client->conn != NULL && client->state != MQTT_CONN_DISCONNECTING) {
+        if (client->state == MQTT_CONNECTED) {
+            write_fixed_header(client, MQTT_DISCONNECT, 0, 0);
+            flush_data(client);
+        }
+        client->state = MQTT_CONN_DISCONNECTING;
+        res = esp_conn_close(client->conn, 0);
+    }
+    esp_core_unlock();
+    return res;
+}
+
+/**
+ * \brief           Test if client is connected and accepted by broker
+ * \param[in]       client: Client handle
+ * \return          `1` if connected, `0` otherwise
+ */
+uint8_t
+esp_mqtt_client_is_connected(esp_mqtt_client_p client) {
+    uint8_t res;
+
+    esp_core_lock();
+    res = ESP_U8(client->state == MQTT_CONNECTED);
+    esp_core_unlock();
+    return res;
+}
+
+/**
+ * \brief           Send subscribe or unsubscribe request
+ * \param[in]       client: Client handle
+ * \param[in]       topic: Topic name
+ * \param[in]       qos: Quality of service, used only for subscribe
+ * \param[in]       arg: User argument for event
+ * \param[in]       sub: `1` to subscribe, `0` to unsubscribe
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+static espr_t
+sub_unsub(esp_mqtt_client_p client, const char* topic, esp_mqtt_qos_t qos, void* arg, uint8_t sub) {
+    mqtt_request_t* r;
+    uint16_t len_topic;
+    espr_t res = espCLOSED;
+
+    ESP_ASSERT("client != NULL", client != NULL);
+    ESP_ASSERT("topic != NULL", topic != NULL);
+
+    len_topic = ESP_U16(strlen(topic));
+
+    esp_core_lock();
+    if (client->state == MQTT_CONNECTED) {
+        r = request_create(client, sub ? MQTT_SUBSCRIBE : MQTT_UNSUBSCRIBE, arg);
+        if (r != NULL) {
+            /* Packet identifier, topic and for subscribe requested QoS */
+            write_fixed_header(client, sub ? MQTT_SUBSCRIBE : MQTT_UNSUBSCRIBE, 0x02, 2 + 2 + len_topic + (sub ? 1 : 0));
+            write_u16(client, r->packet_id);
+            write_string(client, topic, len_topic);
+            if (sub) {
+                write_u8(client, ESP_U8(qos & 0x01));
+            }
+            res = flush_data(client);
+            if (res != espOK) {
+                r->in_use = 0;
+            }
+        } else {
+            res = espERRMEM;
+        }
+    }
+    esp_core_unlock();
+    return res;
+}
+
+/**
+ * \brief           Subscribe to topic
+ * \param[in]       client: Client handle
+ * \param[in]       topic: Topic name to subscribe to
+ * \param[in]       qos: Maximal quality of service for received messages
+ * \param[in]       arg: User argument passed with \ref ESP_MQTT_EVT_SUBSCRIBE event
+ * \return          \ref espOK on success, \ref espERRMEM if in-flight window is full,
+ *                      member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_mqtt_client_subscribe(esp_mqtt_client_p client, const char* topic, esp_mqtt_qos_t qos, void* arg) {
+    return sub_unsub(client, topic, qos, arg, 1);
+}
+
+/**
+ * \brief           Unsubscribe from topic
+ * \param[in]       client: Client handle
+ * \param[in]       topic: Topic name to unsubscribe from
+ * \param[in]       arg: User argument passed with \ref ESP_MQTT_EVT_UNSUBSCRIBE event
+ * \return          \ref espOK on success, \ref espERRMEM if in-flight window is full,
+ *                      member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_mqtt_client_unsubscribe(esp_mqtt_client_p client, const char* topic, void* arg) {
+    return sub_unsub(client, topic, ESP_MQTT_QOS_AT_MOST_ONCE, arg, 0);
+}
+
+/**
+ * \brief           Publish message to broker
+ *
+ * Packet is encoded directly to connection write buffer, no intermediate copy is made.
+ * With \ref ESP_CFG_MQTT_PUBLISH_COALESCE enabled, packet is sent together with other
+ * packets on next poll event, when write buffer is full or on \ref esp_mqtt_client_flush call.
+ *
+ * \param[in]       client: Client handle
+ * \param[in]       topic: Topic to publish to
+ * \param[in]       payload: Message payload, copied before function returns
+ * \param[in]       len: Length of payload
+ * \param[in]       qos: Quality of service. With \ref ESP_MQTT_QOS_AT_LEAST_ONCE message occupies
+ *                      request slot until \ref ESP_MQTT_EVT_PUBLISH event
+ * \param[in]       retain: Retain flag
+ * \param[in]       arg: User argument passed with \ref ESP_MQTT_EVT_PUBLISH event
+ * \return          \ref espOK on success, \ref espERRMEM if in-flight window is full,
+ *                      member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_mqtt_client_publish(esp_mqtt_client_p client, const char* topic, const void* payload,
+                        uint16_t len, esp_mqtt_qos_t qos, uint8_t retain, void* arg) {
+    mqtt_request_t* r = NULL;
+    uint16_t len_topic;
+    espr_t res = espCLOSED;
+
+    ESP_ASSERT("client != NULL", client != NULL);
+    ESP_ASSERT("topic != NULL", topic != NULL);
+    ESP_ASSERT("payload != NULL || len == 0", payload != NULL || len == 0);
+
+    len_topic = ESP_U16(strlen(topic));
+
+    esp_core_lock();
+    if (client->state == MQTT_CONNECTED) {
+        res = espOK;
+        if (qos > ESP_MQTT_QOS_AT_MOST_ONCE) {
+            qos = ESP_MQTT_QOS_AT_LEAST_ONCE;
+            r = request_create(client, MQTT_PUBLISH, arg);
+            if (r == NULL) {
+                res = espERRMEM;
+            }
+        }
+        if (res == espOK) {
+            write_fixed_header(client, MQTT_PUBLISH, ESP_U8((qos << 1) | (retain ? 0x01 : 0x00)),
+                2 + len_topic + (r != NULL ? 2 : 0) + len);
+            write_string(client, topic, len_topic);
+            if (r != NULL) {
+                write_u16(client, r->packet_id);
+            }
+            write_data(client, payload, len);
+            ++client->stat.pub_sent;
+#if ESP_CFG_MQTT_PUBLISH_COALESCE
+            if (client->tx_err) {
+                res = flush_data(client);
+            }
+#else /* ESP_CFG_MQTT_PUBLISH_COALESCE */
+            res = flush_data(client);
+#endif /* !ESP_CFG_MQTT_PUBLISH_COALESCE */
+            if (res != espOK && r != NULL) {
+                r->in_use = 0;
+            }
+        }
+    }
+    esp_core_unlock();
+    return res;
+}
+
+/**
+ * \brief           Send publish packets waiting in connection write buffer
+ *
+ * Use it after batch of \ref esp_mqtt_client_publish calls
+ * to send them without waiting for next poll event
+ *
+ * \param[in]       client: Client handle
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_mqtt_client_flush(esp_mqtt_client_p client) {
+    espr_t res = espCLOSED;
+
+    ESP_ASSERT("client != NULL", client != NULL);
+
+    esp_core_lock();
+    if (client->state == MQTT_CONNECTED) {
+        res = flush_data(client);
+    }
+    esp_core_unlock();
+    return res;
+}
+
+/**
+ * \brief           Get client statistics
+ * \param[in]       client: Client handle
+ * \param[out]      stat: Output statistics
+ */
+void
+esp_mqtt_client_get_stat(esp_mqtt_client_p client, esp_mqtt_client_stat_t* stat) {
+    esp_core_lock();
+    *stat = client->stat;
+    esp_core_unlock();
+}
+
+/**
+ * \brief           Get user argument of client
+ * \param[in]       client: Client handle
+ * \return          User argument
+ */
+void *
+esp_mqtt_client_get_arg(esp_mqtt_client_p client) {
+    return client->arg;
+}
+
+/**
+ * \brief           Set user argument of client
+ * \param[in]       client: Client handle
+ * \param[in]       arg: User argument
+ */
+void
+esp_mqtt_client_set_arg(esp_mqtt_client_p client, void* arg) {
+    client->arg = arg;
+}
+
+#endif /* ESP_CFG_MQTT || __DOXYGEN__ */
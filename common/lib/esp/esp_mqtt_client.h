@@ -0,0 +1,197 @@
+/**
+ * \file            esp_mqtt_client.h
+ * \brief           MQTT client
+ */
+
+/*
+ * Copyright (c) 2018 Tilen Majerle
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE
+ * AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of ESP-AT library.
+ *
+ * Author:          Tilen MAJERLE <tilen@majerle.eu>
+ */
+#ifndef ESP_HDR_MQTT_CLIENT_H
+#define ESP_HDR_MQTT_CLIENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "esp/esp.h"
+
+/**
+ * \ingroup         ESP_API
+ * \defgroup        ESP_MQTT_CLIENT MQTT client
+ * \brief           MQTT 3.1.1 client on top of connection API
+ *
+ * Packets are encoded directly to connection write buffer with \ref esp_conn_write.
+ * Consecutive publish packets are coalesced to single TCP send, which is flushed
+ * on \ref ESP_EVT_CONN_POLL event, when buffer is full or with \ref esp_mqtt_client_flush.
+ * Keep-alive is driven from the same poll event, no dedicated thread is used.
+ *
+ * \note            Connection poll tick must be enabled, see \ref esp_conn_set_poll_interval
+ * \{
+ */
+
+/**
+ * \brief           Quality of service
+ * \note            Exactly once delivery (QoS 2) is not supported
+ */
+typedef enum {
+    ESP_MQTT_QOS_AT_MOST_ONCE = 0x00,           /*!< Delivery is not confirmed */
+    ESP_MQTT_QOS_AT_LEAST_ONCE = 0x01,          /*!< Delivery is confirmed with PUBACK, occupies request slot until then */
+} esp_mqtt_qos_t;
+
+/**
+ * \brief           Client connection information
+ * \note            Structure and strings must stay valid while client is connected
+ */
+typedef struct {
+    const char* id;                             /*!< Client unique identifier. It is required and must be set by user */
+    const char* user;                           /*!< Authentication username. Set to `NULL` if not required */
+    const char* pass;                           /*!< Authentication password, set to `NULL` if not required */
+    uint16_t keep_alive;                        /*!< Keep-alive parameter in units of seconds, `0` to disable.
+                                                    Resolution is equal to connection poll interval */
+    const char* will_topic;                     /*!< Will topic, set to `NULL` if not used */
+    const char* will_message;                   /*!< Will message, used only if `will_topic` is set */
+    esp_mqtt_qos_t will_qos;                    /*!< Will topic quality of service */
+    uint8_t use_ssl;                            /*!< Set to `1` to connect over SSL. Configure certificates
+                                                    with \ref esp_conn_ssl_set_config before connecting */
+} esp_mqtt_client_info_t;
+
+/**
+ * \brief           Connection status returned by broker or by client
+ */
+typedef enum {
+    ESP_MQTT_CONN_STATUS_ACCEPTED = 0x00,       /*!< Connection accepted and ready to use */
+    ESP_MQTT_CONN_STATUS_REFUSED_PROTOCOL_VERSION = 0x01,   /*!< Refused, unacceptable protocol version */
+    ESP_MQTT_CONN_STATUS_REFUSED_ID = 0x02,     /*!< Refused, identifier rejected */
+    ESP_MQTT_CONN_STATUS_REFUSED_SERVER = 0x03, /*!< Refused, server unavailable */
+    ESP_MQTT_CONN_STATUS_REFUSED_USER_PASS = 0x04,  /*!< Refused, bad user name or password */
+    ESP_MQTT_CONN_STATUS_REFUSED_NOT_AUTHORIZED = 0x05, /*!< Refused, not authorized */
+    ESP_MQTT_CONN_STATUS_TCP_FAILED = 0x100,    /*!< TCP connection to broker failed */
+    ESP_MQTT_CONN_STATUS_TIMEOUT = 0x101,       /*!< Broker did not respond to connect request in time */
+} esp_mqtt_conn_status_t;
+
+/**
+ * \brief           Client event type
+ */
+typedef enum {
+    ESP_MQTT_EVT_CONNECT,                       /*!< Connect procedure finished, check status */
+    ESP_MQTT_EVT_SUBSCRIBE,                     /*!< Subscribe request finished */
+    ESP_MQTT_EVT_UNSUBSCRIBE,                   /*!< Unsubscribe request finished */
+    ESP_MQTT_EVT_PUBLISH,                       /*!< Publish request with \ref ESP_MQTT_QOS_AT_LEAST_ONCE finished */
+    ESP_MQTT_EVT_PUBLISH_RECV,                  /*!< Publish packet received from broker */
+    ESP_MQTT_EVT_KEEP_ALIVE,                    /*!< Ping response received from broker */
+    ESP_MQTT_EVT_DISCONNECT,                    /*!< Client disconnected from broker */
+} esp_mqtt_evt_type_t;
+
+/**
+ * \brief           Client event data
+ */
+typedef struct {
+    esp_mqtt_evt_type_t type;                   /*!< Event type */
+    union {
+        struct {
+            esp_mqtt_conn_status_t status;      /*!< Connection status */
+        } connect;                              /*!< Event for \ref ESP_MQTT_EVT_CONNECT */
+        struct {
+            uint8_t is_accepted;                /*!< Status if client was accepted by broker before disconnect */
+        } disconnect;                           /*!< Event for \ref ESP_MQTT_EVT_DISCONNECT */
+        struct {
+            void* arg;                          /*!< User argument of request */
+            espr_t res;                         /*!< Request result */
+        } sub_unsub_scribed;                    /*!< Event for \ref ESP_MQTT_EVT_SUBSCRIBE and \ref ESP_MQTT_EVT_UNSUBSCRIBE */
+        struct {
+            void* arg;                          /*!< User argument of request */
+            espr_t res;                         /*!< Request result */
+        } publish;                              /*!< Event for \ref ESP_MQTT_EVT_PUBLISH */
+        struct {
+            const uint8_t* topic;               /*!< Topic, not `NULL` terminated */
+            size_t topic_len;                   /*!< Length of topic */
+            const void* payload;                /*!< Payload data */
+            size_t payload_len;                 /*!< Length of payload */
+            uint8_t dup;                        /*!< Duplicate flag */
+            esp_mqtt_qos_t qos;                 /*!< Quality of service */
+        } publish_recv;                         /*!< Event for \ref ESP_MQTT_EVT_PUBLISH_RECV */
+    } evt;                                      /*!< Event data */
+} esp_mqtt_evt_t;
+
+/**
+ * \brief           Client statistics
+ */
+typedef struct {
+    uint32_t pub_sent;                          /*!< Number of publish packets written to connection */
+    uint32_t pub_acked;                         /*!< Number of publish packets acknowledged by broker */
+    uint32_t pub_failed;                        /*!< Number of publish requests failed with timeout or close */
+    uint32_t pub_recv;                          /*!< Number of publish packets received from broker */
+    uint32_t tcp_sends;                         /*!< Number of TCP sends. Ratio `pub_sent / tcp_sends` shows coalescing */
+    uint32_t tx_bytes;                          /*!< Number of bytes sent to broker */
+    uint32_t pub_rate;                          /*!< Publish packets per second, measured on last interval of at least one second */
+    uint32_t connects;                          /*!< Number of connections opened to broker */
+    uint32_t link_time;                         /*!< Time in ms to open last connection, includes SSL handshake */
+    uint32_t connack_time;                      /*!< Time in ms from CONNECT to CONNACK on last connection */
+} esp_mqtt_client_stat_t;
+
+struct esp_mqtt_client;
+
+/**
+ * \brief           Pointer to \ref esp_mqtt_client structure
+ */
+typedef struct esp_mqtt_client* esp_mqtt_client_p;
+
+/**
+ * \brief           Client event callback function
+ * \note            Function is called from ESP processing thread with core locked,
+ *                  it must not call blocking functions
+ * \param[in]       client: Client handle
+ * \param[in]       evt: Event information
+ */
+typedef void (*esp_mqtt_evt_fn)(esp_mqtt_client_p client, esp_mqtt_evt_t* evt);
+
+esp_mqtt_client_p   esp_mqtt_client_new(size_t rx_buff_len);
+void                esp_mqtt_client_delete(esp_mqtt_client_p client);
+
+espr_t              esp_mqtt_client_connect(esp_mqtt_client_p client, const char* host, esp_port_t port, esp_mqtt_evt_fn evt_fn, const esp_mqtt_client_info_t* info);
+espr_t              esp_mqtt_client_disconnect(esp_mqtt_client_p client);
+uint8_t             esp_mqtt_client_is_connected(esp_mqtt_client_p client);
+
+espr_t              esp_mqtt_client_subscribe(esp_mqtt_client_p client, const char* topic, esp_mqtt_qos_t qos, void* arg);
+espr_t              esp_mqtt_client_unsubscribe(esp_mqtt_client_p client, const char* topic, void* arg);
+
+espr_t              esp_mqtt_client_publish(esp_mqtt_client_p client, const char* topic, const void* payload, uint16_t len, esp_mqtt_qos_t qos, uint8_t retain, void* arg);
+espr_t              esp_mqtt_client_flush(esp_mqtt_client_p client);
+
+void                esp_mqtt_client_get_stat(esp_mqtt_client_p client, esp_mqtt_client_stat_t* stat);
+void *              esp_mqtt_client_get_arg(esp_mqtt_client_p client);
+void                esp_mqtt_client_set_arg(esp_mqtt_client_p client, void* arg);
+
+/**
+ * \}
+ */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* ESP_HDR_MQTT_CLIENT_H */
@@ -263,7 +263,8 @@ esp_netconn_new(esp_netconn_type_t type) {
     esp_core_lock();
     if (first) {
         first = 0;
-        esp_evt_register(esp_evt);              /* Register global event function */
+        esp_evt_register_mask(esp_evt,          /* Register global event function */
+            ESP_EVT_MASK(ESP_EVT_WIFI_DISCONNECTED) | ESP_EVT_MASK(ESP_EVT_DEVICE_PRESENT));
     }
     esp_core_unlock();
     a = esp_mem_calloc(1, sizeof(*a));          /* Allocate memory for core object */
@@ -341,6 +342,7 @@ esp_netconn_delete(esp_netconn_p nc) {
     }
     esp_core_unlock();
 
+    esp_mem_free_s((void **)&nc->buff.buff);    /* Free write buffer, if not flushed or persistent */
     esp_mem_free_s((void **)&nc);
     return espOK;
 }
@@ -513,15 +515,15 @@ esp_netconn_write(esp_netconn_p nc, const void* data, size_t btw) {
     /*
      * Several steps are done in write process
      *
-     * 1. Check if buffer is set and check if there is something to write to it.
-     *    1. In case buffer will be full after copy, send it and free memory.
+     * 1. Check if buffer has pending data and check if there is something to write to it.
+     *    1. In case buffer will be full after copy, send it and free memory (or keep it, when persistent).
      * 2. Check how many bytes we can write directly without needed to copy
      * 3. Try to allocate a new buffer and copy remaining input data to it
      * 4. In case buffer allocation fails, send data directly (may affect on speed and effectivenes)
      */
 
     /* Step 1 */
-    if (nc->buff.buff != NULL) {                /* Is there a write buffer ready to accept more data? */
+    if (nc->buff.buff != NULL && nc->buff.ptr > 0) {/* Is there a write buffer with pending data? */
         len = ESP_MIN(nc->buff.len - nc->buff.ptr, btw);    /* Get number of bytes we can write to buffer */
         if (len > 0) {
             ESP_MEMCPY(&nc->buff.buff[nc->buff.ptr], data, len);/* Copy memory to temporary write buffer */
@@ -534,7 +536,11 @@ esp_netconn_write(esp_netconn_p nc, const void* data, size_t btw) {
         if (nc->buff.ptr == nc->buff.len) {
             res = esp_conn_send(nc->conn, nc->buff.buff, nc->buff.len, &sent, 1);
 
+#if ESP_CFG_NETCONN_PERSIST_TX_BUFF
+            nc->buff.ptr = 0;                   /* Keep buffer for next writes */
+#else /* ESP_CFG_NETCONN_PERSIST_TX_BUFF */
             esp_mem_free_s((void **)&nc->buff.buff);
+#endif /* !ESP_CFG_NETCONN_PERSIST_TX_BUFF */
             if (res != espOK) {
                 return res;
             }
@@ -564,6 +570,7 @@ esp_netconn_write(esp_netconn_p nc, const void* data, size_t btw) {
         nc->buff.buff = esp_mem_malloc(sizeof(*nc->buff.buff) * ESP_CFG_CONN_MAX_DATA_LEN);
         nc->buff.len = ESP_CFG_CONN_MAX_DATA_LEN;   /* Save buffer length */
         nc->buff.ptr = 0;                       /* Save buffer pointer */
+        esp_mem_set_tag(nc->buff.buff, ESP_MEM_TAG_CONN_BUFF);
     }
 
     /* Step 4 */
@@ -596,7 +603,39 @@ esp_netconn_flush(esp_netconn_p nc) {
         if (nc->buff.ptr > 0) {                 /* Do we have data in current buffer? */
             esp_conn_send(nc->conn, nc->buff.buff, nc->buff.ptr, NULL, 1);  /* Send data */
         }
+#if ESP_CFG_NETCONN_PERSIST_TX_BUFF
+        nc->buff.ptr = 0;                       /* Buffer is freed in \ref esp_netconn_delete */
+#else /* ESP_CFG_NETCONN_PERSIST_TX_BUFF */
         esp_mem_free_s((void **)&nc->buff.buff);
+#endif /* !ESP_CFG_NETCONN_PERSIST_TX_BUFF */
+    }
+    return espOK;
+}
+
+/**
+ * \brief           Write multiple memory slices to connection output buffers
+ *
+ * Slices, such as protocol header and payload, are gathered to connection write buffer
+ * and sent in as few `CIPSEND` commands as possible, without merging them in user memory first.
+ * Call \ref esp_netconn_flush to send remaining buffered data.
+ *
+ * \note            This function may only be used on \e TCP or \e SSL connections
+ * \param[in]       nc: Netconn handle used to write data to
+ * \param[in]       iov: Array of memory slices to write
+ * \param[in]       iovcnt: Number of entries in `iov` array
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ * \sa              esp_netconn_write
+ */
+espr_t
+esp_netconn_writev(esp_netconn_p nc, const esp_netconn_iovec_t* iov, size_t iovcnt) {
+    espr_t res;
+
+    ESP_ASSERT("iov != NULL", iov != NULL);
+
+    for (size_t i = 0; i < iovcnt; ++i) {
+        if (iov[i].len > 0 && (res = esp_netconn_write(nc, iov[i].data, iov[i].len)) != espOK) {
+            return res;
+        }
     }
     return espOK;
 }
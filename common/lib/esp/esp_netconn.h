@@ -62,6 +62,14 @@ typedef enum {
     ESP_NETCONN_TYPE_UDP = ESP_CONN_TYPE_UDP,   /*!< UDP connection */
 } esp_netconn_type_t;
 
+/**
+ * \brief           Memory slice for vectored write, see \ref esp_netconn_writev
+ */
+typedef struct {
+    const void* data;                           /*!< Pointer to slice data */
+    size_t len;                                 /*!< Length of slice in units of bytes */
+} esp_netconn_iovec_t;
+
 esp_netconn_p   esp_netconn_new(esp_netconn_type_t type);
 espr_t          esp_netconn_delete(esp_netconn_p nc);
 espr_t          esp_netconn_bind(esp_netconn_p nc, esp_port_t port);
@@ -78,6 +86,7 @@ espr_t          esp_netconn_listen_with_max_conn(esp_netconn_p nc, uint16_t max_
 espr_t          esp_netconn_set_listen_conn_timeout(esp_netconn_p nc, uint16_t timeout);
 espr_t          esp_netconn_accept(esp_netconn_p nc, esp_netconn_p* client);
 espr_t          esp_netconn_write(esp_netconn_p nc, const void* data, size_t btw);
+espr_t          esp_netconn_writev(esp_netconn_p nc, const esp_netconn_iovec_t* iov, size_t iovcnt);
 espr_t          esp_netconn_flush(esp_netconn_p nc);
 
 /* UDP only */
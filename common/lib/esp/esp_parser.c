@@ -394,10 +394,22 @@ espi_parse_link_conn(const char* str) {
  */
 uint8_t
 espi_parse_cwlap(const char* str, esp_msg_t* msg) {
-    if (!CMD_IS_DEF(ESP_CMD_WIFI_CWLAP) ||      /* Do we have valid message here and enough memory to save everything? */
-        msg->msg.ap_list.aps == NULL || msg->msg.ap_list.apsi >= msg->msg.ap_list.apsl) {
+    esp_ap_t ap_tmp, *ap;
+
+    if (!CMD_IS_DEF(ESP_CMD_WIFI_CWLAP)) {
         return 0;
     }
+    if (msg->msg.ap_list.ap_fn != NULL) {       /* Streaming mode, entry is only passed to callback */
+        if (msg->msg.ap_list.stopped) {
+            return 0;
+        }
+        ap = &ap_tmp;
+    } else {                                    /* Do we have enough memory to save everything? */
+        if (msg->msg.ap_list.aps == NULL || msg->msg.ap_list.apsi >= msg->msg.ap_list.apsl) {
+            return 0;
+        }
+        ap = &msg->msg.ap_list.aps[msg->msg.ap_list.apsi];
+    }
     if (*str == '+') {                          /* Does string contain '+' as first character */
         str += 7;                               /* Skip this part */
     }
@@ -405,19 +417,22 @@ espi_parse_cwlap(const char* str, esp_msg_t* msg) {
         return 0;
     }
 
-    msg->msg.ap_list.aps[msg->msg.ap_list.apsi].ecn = (esp_ecn_t)espi_parse_number(&str);
-    espi_parse_string(&str, msg->msg.ap_list.aps[msg->msg.ap_list.apsi].ssid, sizeof(msg->msg.ap_list.aps[msg->msg.ap_list.apsi].ssid), 1);
-    msg->msg.ap_list.aps[msg->msg.ap_list.apsi].rssi = espi_parse_number(&str);
-    espi_parse_mac(&str, &msg->msg.ap_list.aps[msg->msg.ap_list.apsi].mac);
-    msg->msg.ap_list.aps[msg->msg.ap_list.apsi].ch = espi_parse_number(&str);
-    msg->msg.ap_list.aps[msg->msg.ap_list.apsi].offset = espi_parse_number(&str);
-    msg->msg.ap_list.aps[msg->msg.ap_list.apsi].cal = espi_parse_number(&str);
+    ap->ecn = (esp_ecn_t)espi_parse_number(&str);
+    espi_parse_string(&str, ap->ssid, sizeof(ap->ssid), 1);
+    ap->rssi = espi_parse_number(&str);
+    espi_parse_mac(&str, &ap->mac);
+    ap->ch = espi_parse_number(&str);
+    ap->offset = espi_parse_number(&str);
+    ap->cal = espi_parse_number(&str);
 
     espi_parse_number(&str);                    /* Parse pwc */
     espi_parse_number(&str);                    /* Parse gc */
-    msg->msg.ap_list.aps[msg->msg.ap_list.apsi].bgn = espi_parse_number(&str);
-    msg->msg.ap_list.aps[msg->msg.ap_list.apsi].wps = espi_parse_number(&str);
+    ap->bgn = espi_parse_number(&str);
+    ap->wps = espi_parse_number(&str);
 
+    if (msg->msg.ap_list.ap_fn != NULL && !msg->msg.ap_list.ap_fn(ap, msg->msg.ap_list.ap_arg)) {
+        msg->msg.ap_list.stopped = 1;           /* Ignore rest of entries */
+    }
     msg->msg.ap_list.apsi++;                    /* Increase number of found elements */
     if (msg->msg.ap_list.apf != NULL) {         /* Set pointer if necessary */
         *msg->msg.ap_list.apf = msg->msg.ap_list.apsi;
@@ -33,6 +33,7 @@
 #include "esp/esp_private.h"
 #include "esp/esp_pbuf.h"
 #include "esp/esp_mem.h"
+#include "esp/esp_mempool.h"
 
 /* Set size of pbuf structure */
 #define SIZEOF_PBUF_STRUCT          ESP_MEM_ALIGN(sizeof(esp_pbuf_t))
@@ -70,7 +71,7 @@ esp_pbuf_p
 esp_pbuf_new(size_t len) {
     esp_pbuf_p p;
 
-    p = esp_mem_malloc(SIZEOF_PBUF_STRUCT + sizeof(*p->payload) * len);
+    p = esp_mempool_alloc(ESP_MEMPOOL_PBUF, SIZEOF_PBUF_STRUCT + sizeof(*p->payload) * len);
     ESP_DEBUGW(ESP_CFG_DBG_PBUF | ESP_DBG_TYPE_TRACE, p == NULL,
         "[PBUF] Failed to allocate %d bytes\r\n", (int)len);
     ESP_DEBUGW(ESP_CFG_DBG_PBUF | ESP_DBG_TYPE_TRACE, p != NULL,
@@ -81,6 +82,8 @@ esp_pbuf_new(size_t len) {
         p->len = len;                           /* Set payload length */
         p->payload = (void *)(((char *)p) + SIZEOF_PBUF_STRUCT);/* Set pointer to payload data */
         p->ref = 1;                             /* Single reference is used on this pbuf */
+        ESP_MEMSET(&p->ip, 0x00, sizeof(p->ip));/* Pool memory is not cleared */
+        p->port = 0;
     }
     return p;
 }
@@ -110,7 +113,7 @@ esp_pbuf_free(esp_pbuf_p pbuf) {
             ESP_DEBUGF(ESP_CFG_DBG_PBUF | ESP_DBG_TYPE_TRACE,
                 "[PBUF] Deallocating %p with len/tot_len: %d/%d\r\n", p, (int)p->len, (int)p->tot_len);
             pn = p->next;                       /* Save next entry */
-            esp_mem_free_s((void **)&p);         /* Free memory for pbuf */
+            esp_mempool_free_s((void **)&p);    /* Free memory for pbuf */
             p = pn;                             /* Restore with next entry */
             cnt++;                              /* Increase number of freed pbufs */
         } else {
@@ -321,8 +324,37 @@ esp_pbuf_get_at(const esp_pbuf_p pbuf, size_t pos, uint8_t* el) {
     return 0;                                   /* Invalid character */
 }
 
+/**
+ * \brief           Compare memory with pbuf chain, starting at specific pbuf
+ * \note            Caller must make sure chain has at least `off + len` bytes
+ * \param[in]       p: Pbuf where compare starts
+ * \param[in]       off: Offset in `p` where compare starts
+ * \param[in]       d: Data to compare with
+ * \param[in]       len: Length of data in units of bytes
+ * \return          `1` if memory matches, `0` otherwise
+ */
+static uint8_t
+pbuf_seg_equal(esp_pbuf_p p, size_t off, const uint8_t* d, size_t len) {
+    size_t l;
+
+    for (; len > 0 && p != NULL; p = p->next, off = 0) {
+        l = ESP_MIN(p->len - off, len);
+        if (memcmp(&p->payload[off], d, l)) {
+            return 0;
+        }
+        d += l;
+        len -= l;
+    }
+    return len == 0;
+}
+
 /**
  * \brief           Find desired needle in a haystack
+ *
+ * First needle byte is searched with `memchr` in each segment,
+ * candidates are then verified across segment boundaries
+ * without walking chain from the beginning
+ *
  * \param[in]       pbuf: Pbuf used as haystack
  * \param[in]       needle: Data memory used as needle
  * \param[in]       len: Length of needle memory
@@ -332,14 +364,32 @@ esp_pbuf_get_at(const esp_pbuf_p pbuf, size_t pos, uint8_t* el) {
  */
 size_t
 esp_pbuf_memfind(const esp_pbuf_p pbuf, const void* needle, size_t len, size_t off) {
-    if (pbuf != NULL && needle != NULL && pbuf->tot_len >= (len + off)) {   /* Check if valid entries */
-        /*
-         * Try entire buffer element by element
-         * and in case we have a match, report it
-         */
-        for (size_t i = off; i <= pbuf->tot_len - len; i++) {
-            if (!esp_pbuf_memcmp(pbuf, needle, len, i)) {   /* Check if identical */
-                return i;                       /* We have a match! */
+    const uint8_t* n = needle;
+    const uint8_t* s;
+    esp_pbuf_p p;
+    size_t pos, base, last;
+
+    if (pbuf == NULL || needle == NULL || len == 0 || pbuf->tot_len < (len + off)) {    /* Check if valid entries */
+        return ESP_SIZET_MAX;
+    }
+
+    last = pbuf->tot_len - len;                 /* Last position where needle still fits */
+    base = off;
+    p = pbuf_skip(pbuf, off, &off);             /* Get start pbuf and offset inside it */
+    base -= off;                                /* Position of first byte of current pbuf */
+    for (; p != NULL && base <= last; base += p->len, p = p->next, off = 0) {
+        for (; off < p->len; ++off) {
+            s = memchr(&p->payload[off], n[0], p->len - off);
+            if (s == NULL) {
+                break;                          /* Go to next segment */
+            }
+            off = s - p->payload;
+            pos = base + off;
+            if (pos > last) {                   /* Needle does not fit anymore */
+                return ESP_SIZET_MAX;
+            }
+            if (pbuf_seg_equal(p, off, n, len)) {
+                return pos;                     /* We have a match! */
             }
         }
     }
@@ -359,6 +409,69 @@ esp_pbuf_strfind(const esp_pbuf_p pbuf, const char* str, size_t off) {
     return esp_pbuf_memfind(pbuf, str, strlen(str), off);
 }
 
+/**
+ * \brief           Call function for every linear memory segment of pbuf chain
+ *
+ * Segments are passed directly from pbuf memory, no data are copied.
+ * Use it to process chained data in-place
+ *
+ * \param[in]       pbuf: Pbuf chain to iterate
+ * \param[in]       offset: Start offset in pbuf chain
+ * \param[in]       len: Maximal number of bytes to iterate,
+ *                      use `ESP_SIZET_MAX` to iterate until end of chain
+ * \param[in]       fn: Callback function called for each segment
+ * \param[in]       arg: Custom user argument passed to callback function
+ * \return          Number of bytes passed to callback function
+ */
+size_t
+esp_pbuf_for_each_segment(const esp_pbuf_p pbuf, size_t offset, size_t len, esp_pbuf_seg_fn fn, void* arg) {
+    esp_pbuf_p p;
+    size_t l, tot = 0;
+
+    if (fn == NULL || (p = pbuf_skip(pbuf, offset, &offset)) == NULL) {
+        return 0;
+    }
+    for (; p != NULL && len > 0; p = p->next, offset = 0) {
+        l = ESP_MIN(p->len - offset, len);
+        if (l == 0) {
+            continue;                           /* Skip empty pbuf */
+        }
+        tot += l;
+        len -= l;
+        if (!fn(&p->payload[offset], l, tot - l, arg)) {
+            break;
+        }
+    }
+    return tot;
+}
+
+/**
+ * \brief           Segment compare state for \ref esp_pbuf_memcmp
+ */
+typedef struct {
+    const uint8_t* data;                        /*!< Data to compare with */
+    size_t diff;                                /*!< Set to `1` + position of first different segment */
+} pbuf_cmp_t;
+
+/**
+ * \brief           Segment callback for \ref esp_pbuf_memcmp
+ * \param[in]       data: Segment memory
+ * \param[in]       len: Segment length
+ * \param[in]       pos: Segment position from compare start
+ * \param[in]       arg: Pointer to \ref pbuf_cmp_t state
+ * \return          `1` to continue, `0` on mismatch
+ */
+static uint8_t
+pbuf_cmp_seg_fn(const void* data, size_t len, size_t pos, void* arg) {
+    pbuf_cmp_t* c = arg;
+
+    if (memcmp(data, &c->data[pos], len)) {
+        c->diff = pos + 1;
+        return 0;
+    }
+    return 1;
+}
+
 /**
  * \brief           Compare pbuf memory with memory from data
  * \note            Compare is done on entire pbuf chain
@@ -371,35 +484,16 @@ esp_pbuf_strfind(const esp_pbuf_p pbuf, const char* str, size_t off) {
  */
 size_t
 esp_pbuf_memcmp(const esp_pbuf_p pbuf, const void* data, size_t len, size_t offset) {
-    esp_pbuf_p p;
-    uint8_t el;
-    const uint8_t* d = data;
+    pbuf_cmp_t c = { .data = data, .diff = 0 };
 
     if (pbuf == NULL || data == NULL || len == 0 || /* Input parameters check */
         pbuf->tot_len < (offset + len)) {       /* Check of valid ranges */
         return ESP_SIZET_MAX;                   /* Invalid check here */
     }
 
-    /*
-     * Find start pbuf to have more optimized search at the end
-     * Since we had a check on beginning, we must pass this for loop without any problems
-     */
-    for (p = pbuf; p != NULL && p->len <= offset; p = p->next) {
-        offset -= p->len;                       /* Decrease offset by length of pbuf */
-    }
-
-    /*
-     * We have known starting pbuf.
-     * Now it is time to check byte by byte from pbuf and memory
-     *
-     * Use byte by byte read function to inspect bytes separatelly
-     */
-    for (size_t i = 0; i < len; i++) {
-        if (!esp_pbuf_get_at(p, offset + i, &el) || el != d[i]) {   /* Get value from pbuf at specific offset */
-            return offset + 1;                  /* Return value from offset where it failed */
-        }
-    }
-    return 0;                                   /* Memory matches at this point */
+    /* Compare segment by segment with direct memory compare */
+    esp_pbuf_for_each_segment(pbuf, offset, len, pbuf_cmp_seg_fn, &c);
+    return c.diff;                              /* `0` if memory matches */
 }
 
 /**
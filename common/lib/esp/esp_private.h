@@ -40,6 +40,7 @@ extern "C" {
 #include "esp/esp.h"
 #include "esp/esp_typedefs.h"
 #include "esp/esp_debug.h"
+#include "esp/esp_mempool.h"
 
 /**
  * \addtogroup      ESP_TYPEDEFS
@@ -142,6 +143,21 @@ typedef enum {
     ESP_CMD_TCPIP_CIPDINFO,                     /*!< Configure what data are received on +IPD statement */
 } esp_cmd_t;
 
+/**
+ * \brief           Connection status flags
+ *
+ * Flags fit single byte, so status can be read without core lock
+ */
+typedef union {
+    struct {
+        uint8_t active:1;                       /*!< Status whether connection is active */
+        uint8_t client:1;                       /*!< Status whether connection is in client mode */
+        uint8_t data_received:1;                /*!< Status whether first data were received on connection */
+        uint8_t in_closing:1;                   /*!< Status if connection is in closing mode.
+                                                    When in closing mode, ignore any possible received data from function */
+    } f;                                        /*!< Connection flags */
+} esp_conn_status_t;
+
 /**
  * \brief           Connection structure
  */
@@ -162,19 +178,12 @@ typedef struct esp_conn {
 
     size_t          total_recved;               /*!< Total number of bytes received */
 
+
 #if ESP_CFG_CONN_MANUAL_TCP_RECEIVE || __DOXYGEN__
     size_t          tcp_available_data;         /*!< Number of bytes ready to read from ESP device on TCP connection */
 #endif /* ESP_CFG_CONN_MANUAL_TCP_RECEIVE || __DOXYGEN__ */
 
-    union {
-        struct {
-            uint8_t active:1;                   /*!< Status whether connection is active */
-            uint8_t client:1;                   /*!< Status whether connection is in client mode */
-            uint8_t data_received:1;            /*!< Status whether first data were received on connection */
-            uint8_t in_closing:1;               /*!< Status if connection is in closing mode.
-                                                    When in closing mode, ignore any possible received data from function */
-        } f;                                    /*!< Connection flags */
-    } status;                                   /*!< Connection status union with flag bits */
+    esp_conn_status_t status;                   /*!< Connection status union with flag bits */
 } esp_conn_t;
 
 /**
@@ -216,6 +225,9 @@ typedef struct esp_msg {
     uint8_t         i;                          /*!< Variable to indicate order number of subcommands */
     esp_sys_sem_t   sem;                        /*!< Semaphore for the message */
     uint8_t         is_blocking;                /*!< Status if command is blocking */
+#if ESP_CFG_MSG_ON_STACK || __DOXYGEN__
+    uint8_t         is_local;                   /*!< Status if message is on stack of calling thread and must not be freed */
+#endif /* ESP_CFG_MSG_ON_STACK || __DOXYGEN__ */
     uint32_t        block_time;                 /*!< Maximal blocking time in units of milliseconds. Use 0 to for non-blocking call */
     espr_t          res;                        /*!< Result of message operation */
     espr_t          (*fn)(struct esp_msg *);    /*!< Processing callback function to process packet */
@@ -256,6 +268,12 @@ typedef struct esp_msg {
             size_t apsl;                        /*!< Length of input array of access points */
             size_t apsi;                        /*!< Current access point array */
             size_t* apf;                        /*!< Pointer to output variable holding number of access points found */
+            esp_sta_ap_fn ap_fn;                /*!< Callback for each access point, used instead of array when set */
+            void* ap_arg;                       /*!< Custom argument for callback */
+            int16_t rssi_min;                   /*!< Minimal RSSI of reported access points, `0` when filter is not used */
+            uint8_t stopped;                    /*!< Set to `1` when callback does not want more access points */
+            uint8_t opt_restore;                /*!< Set to `1` when default CWLAPOPT filter is being restored */
+            espr_t scan_res;                    /*!< Result of scan command when filter is restored after */
         } ap_list;                              /*!< List for access points */
 #endif /* ESP_CFG_MODE_STATION || __DOXYGEN__ */
 #if ESP_CFG_MODE_ACCESS_POINT || __DOXYGEN__
@@ -437,8 +455,21 @@ typedef struct {
 typedef struct esp_evt_func {
     struct esp_evt_func* next;                  /*!< Next function in the list */
     esp_evt_fn fn;                              /*!< Function pointer itself */
+    uint32_t mask;                              /*!< Subscribed events, see \ref ESP_EVT_MASK */
 } esp_evt_func_t;
 
+/**
+ * \brief           Lock domain structure
+ */
+typedef struct {
+    esp_sys_mutex_t     mutex;                  /*!< Domain mutex. Core domain uses \ref esp_sys_protect instead */
+    esp_sys_thread_t    owner;                  /*!< Thread currently holding the lock */
+    size_t              cnt;                    /*!< Recursive lock counter of owner thread */
+#if ESP_CFG_LOCK_STAT || __DOXYGEN__
+    esp_lock_stat_t     stat;                   /*!< Contention statistics */
+#endif /* ESP_CFG_LOCK_STAT || __DOXYGEN__ */
+} esp_lock_t;
+
 /**
  * \brief           ESP modules structure
  */
@@ -467,7 +498,7 @@ typedef struct {
  * \brief           ESP global structure
  */
 typedef struct {
-    size_t              locked_cnt;             /*!< Counter how many times (recursive) stack is currently locked */
+    esp_lock_t          locks[ESP_LOCK_END];    /*!< Lock domains, see \ref esp_lock_id_t */
 
     esp_sys_sem_t       sem_sync;               /*!< Synchronization semaphore between threads */
     esp_sys_mbox_t      mbox_producer;          /*!< Producer message queue handle */
@@ -480,11 +511,18 @@ typedef struct {
     esp_ll_t            ll;                     /*!< Low level functions */
 
     esp_msg_t*          msg;                    /*!< Pointer to current user message being executed */
+#if ESP_CFG_SINGLE_THREAD || __DOXYGEN__
+    esp_timeout_t       msg_timeout;            /*!< Timeout entry for maximal execution time of current message */
+    uint8_t             msg_done;               /*!< Set by parser when current message has finished */
+#endif /* ESP_CFG_SINGLE_THREAD || __DOXYGEN__ */
 
     esp_evt_t           evt;                    /*!< Callback processing structure */
     esp_evt_func_t*     evt_func;               /*!< Callback function linked list */
     esp_evt_fn          evt_server;             /*!< Default callback function for server connections */
 
+    esp_timeout_t       conn_poll_timeout;      /*!< Single poll tick for all active connections */
+    uint32_t            conn_poll_interval;     /*!< Poll tick interval in milliseconds, `0` when disabled */
+
     esp_modules_t       m;                      /*!< All modules. When resetting, reset structure */
 
     union {
@@ -524,16 +562,36 @@ typedef struct {
 
 extern esp_t esp;
 
+#if ESP_CFG_MSG_ON_STACK
+/* Blocking call waits until message is processed, so message can live on caller stack */
+#define ESP_MSG_VAR_DEFINE(name)                esp_msg_t name ## _local, *name
+#define ESP_MSG_VAR_ALLOC_LOCAL(name, blocking) do {\
+    (name) = NULL;                                  \
+    if ((blocking) > 0) {                           \
+        (name) = &name ## _local;                   \
+        ESP_MEMSET((name), 0x00, sizeof(*(name)));  \
+        (name)->is_blocking = 1;                    \
+        (name)->is_local = 1;                       \
+    }                                               \
+} while (0)
+#define ESP_MSG_VAR_IS_LOCAL(name)              ((name)->is_local)
+#else /* ESP_CFG_MSG_ON_STACK */
 #define ESP_MSG_VAR_DEFINE(name)                esp_msg_t* name
+#define ESP_MSG_VAR_ALLOC_LOCAL(name, blocking) (name) = NULL
+#define ESP_MSG_VAR_IS_LOCAL(name)              0
+#endif /* !ESP_CFG_MSG_ON_STACK */
 #define ESP_MSG_VAR_ALLOC(name, blocking)       do {\
-    (name) = esp_mem_malloc(sizeof(*(name)));       \
-    ESP_DEBUGW(ESP_CFG_DBG_VAR | ESP_DBG_TYPE_TRACE, (name) != NULL, "[MSG VAR] Allocated %d bytes at %p\r\n", sizeof(*(name)), (name)); \
-    ESP_DEBUGW(ESP_CFG_DBG_VAR | ESP_DBG_TYPE_TRACE, (name) == NULL, "[MSG VAR] Error allocating %d bytes\r\n", sizeof(*(name))); \
+    ESP_MSG_VAR_ALLOC_LOCAL(name, blocking);        \
     if ((name) == NULL) {                           \
-        return espERRMEM;                           \
+        (name) = esp_mempool_alloc(ESP_MEMPOOL_MSG, sizeof(*(name)));   \
+        ESP_DEBUGW(ESP_CFG_DBG_VAR | ESP_DBG_TYPE_TRACE, (name) != NULL, "[MSG VAR] Allocated %d bytes at %p\r\n", sizeof(*(name)), (name)); \
+        ESP_DEBUGW(ESP_CFG_DBG_VAR | ESP_DBG_TYPE_TRACE, (name) == NULL, "[MSG VAR] Error allocating %d bytes\r\n", sizeof(*(name))); \
+        if ((name) == NULL) {                       \
+            return espERRMEM;                       \
+        }                                           \
+        ESP_MEMSET((name), 0x00, sizeof(*(name)));  \
+        (name)->is_blocking = ESP_U8((blocking) > 0);   \
     }                                               \
-    ESP_MEMSET((name), 0x00, sizeof(*(name)));      \
-    (name)->is_blocking = ESP_U8((blocking) > 0);   \
 } while (0)
 #define ESP_MSG_VAR_REF(name)                   (*(name))
 #define ESP_MSG_VAR_FREE(name)                  do {\
@@ -542,7 +600,9 @@ extern esp_t esp;
         esp_sys_sem_delete(&((name)->sem));         \
         esp_sys_sem_invalid(&((name)->sem));        \
     }                                               \
-    esp_mem_free_s((void **)&(name));               \
+    if (!ESP_MSG_VAR_IS_LOCAL(name)) {              \
+        esp_mempool_free_s((void **)&(name));       \
+    }                                               \
 } while (0)
 #if ESP_CFG_USE_API_FUNC_EVT
 #define ESP_MSG_VAR_SET_EVT(name, evt_fn, evt_arg)  do {\
@@ -577,11 +637,15 @@ uint8_t     espi_is_valid_conn_ptr(esp_conn_p conn);
 espr_t      espi_send_cb(esp_evt_type_t type);
 espr_t      espi_send_conn_cb(esp_conn_t* conn, esp_evt_fn cb);
 void        espi_conn_init(void);
-void        espi_conn_start_timeout(esp_conn_p conn);
+void        espi_conn_poll_start(void);
 espr_t      espi_conn_manual_tcp_read_data(esp_conn_p conn, size_t len);
 espr_t      espi_send_msg_to_producer_mbox(esp_msg_t* msg, espr_t (*process_fn)(esp_msg_t *), uint32_t max_block_time);
 uint32_t    espi_get_from_mbox_with_timeout_checks(esp_sys_mbox_t* b, void** m, uint32_t timeout);
 
+void        espi_lock(esp_lock_id_t id);
+void        espi_unlock(esp_lock_id_t id);
+uint8_t     espi_lock_is_owner(esp_lock_id_t id);
+
 void        espi_reset_everything(uint8_t forced);
 void        espi_process_events_for_timeout_or_error(esp_msg_t* msg, espr_t err);
 
@@ -325,6 +325,45 @@ esp_sta_list_ap(const char* ssid, esp_ap_t* aps, size_t apsl, size_t* apf,
     return espi_send_msg_to_producer_mbox(&ESP_MSG_VAR_REF(msg), espi_initiate_cmd, 30000);
 }
 
+/**
+ * \brief           Scan for access points and report each one to callback function
+ *
+ * Access points are not stored. Callback is called from stack thread
+ * for each `+CWLAP` entry as it is received.
+ * Scan on device always runs to the end, but when callback returns `0`,
+ * rest of entries is ignored
+ *
+ * \param[in]       ssid: Optional SSID name to search for. Set to `NULL` to disable filter
+ * \param[in]       rssi_min: Minimal RSSI in dBm, sent to device with `AT+CWLAPOPT`.
+ *                      Set to `0` to disable filter. Filter requires AT firmware with RSSI filter support
+ * \param[in]       ap_fn: Callback function called for each access point
+ * \param[in]       ap_arg: Custom argument for access point callback function
+ * \param[in]       evt_fn: Callback function called when command has finished. Set to `NULL` when not used
+ * \param[in]       evt_arg: Custom argument for event callback function
+ * \param[in]       blocking: Status whether command should be blocking or not
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_sta_scan_ap(const char* ssid, int16_t rssi_min, esp_sta_ap_fn ap_fn, void* const ap_arg,
+                    const esp_api_cmd_evt_fn evt_fn, void* const evt_arg, const uint32_t blocking) {
+    ESP_MSG_VAR_DEFINE(msg);
+
+    ESP_ASSERT("ap_fn != NULL", ap_fn != NULL);
+
+    ESP_MSG_VAR_ALLOC(msg, blocking);
+    ESP_MSG_VAR_SET_EVT(msg, evt_fn, evt_arg);
+    ESP_MSG_VAR_REF(msg).cmd_def = ESP_CMD_WIFI_CWLAP;
+    if (rssi_min != 0) {
+        ESP_MSG_VAR_REF(msg).cmd = ESP_CMD_WIFI_CWLAPOPT;   /* Set filter before scan */
+    }
+    ESP_MSG_VAR_REF(msg).msg.ap_list.ssid = ssid;
+    ESP_MSG_VAR_REF(msg).msg.ap_list.ap_fn = ap_fn;
+    ESP_MSG_VAR_REF(msg).msg.ap_list.ap_arg = ap_arg;
+    ESP_MSG_VAR_REF(msg).msg.ap_list.rssi_min = rssi_min;
+
+    return espi_send_msg_to_producer_mbox(&ESP_MSG_VAR_REF(msg), espi_initiate_cmd, 30000);
+}
+
 /**
  * \brief           Check if access point is `802.11b` compatible
  * \param[in]       ap: Access point detailes acquired by \ref esp_sta_list_ap
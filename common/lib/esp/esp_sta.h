@@ -57,6 +57,7 @@ uint8_t     esp_sta_has_ip(void);
 uint8_t     esp_sta_is_joined(void);
 espr_t      esp_sta_copy_ip(esp_ip_t* ip, esp_ip_t* gw, esp_ip_t* nm);
 espr_t      esp_sta_list_ap(const char* ssid, esp_ap_t* aps, size_t apsl, size_t* apf, const esp_api_cmd_evt_fn evt_fn, void* const evt_arg, const uint32_t blocking);
+espr_t      esp_sta_scan_ap(const char* ssid, int16_t rssi_min, esp_sta_ap_fn ap_fn, void* const ap_arg, const esp_api_cmd_evt_fn evt_fn, void* const evt_arg, const uint32_t blocking);
 espr_t      esp_sta_get_ap_info(esp_sta_info_ap_t* info, const esp_api_cmd_evt_fn evt_fn, void* const evt_arg, const uint32_t blocking);
 uint8_t     esp_sta_is_ap_802_11b(esp_ap_t* ap);
 uint8_t     esp_sta_is_ap_802_11g(esp_ap_t* ap);
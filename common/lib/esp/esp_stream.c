@@ -0,0 +1,144 @@
+/**
+ * \file            esp_stream.c
+ * \brief           Resumable stream decoder
+ */
+
+/*
+ * Copyright (c) 2018 Tilen Majerle
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE
+ * AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of ESP-AT library.
+ *
+ * Author:          Tilen MAJERLE <tilen@majerle.eu>
+ */
+#include "esp/esp_private.h"
+#include "esp/esp_stream.h"
+
+/**
+ * \brief           Segment feed state for \ref esp_stream_feed_pbuf
+ */
+typedef struct {
+    esp_stream_t* s;                            /*!< Stream decoder */
+    espr_t res;                                 /*!< Result of last feed */
+} stream_pbuf_t;
+
+/**
+ * \brief           Initialize stream decoder with first step
+ * \param[in]       s: Stream decoder
+ * \param[in]       dst: Destination for first step bytes, `NULL` to skip them
+ * \param[in]       len: Number of bytes for first step
+ * \param[in]       fn: Function called when first step is complete
+ * \param[in]       arg: Custom user argument
+ */
+void
+esp_stream_init(esp_stream_t* s, void* dst, size_t len, esp_stream_fn fn, void* arg) {
+    s->arg = arg;
+    esp_stream_expect(s, dst, len, fn);
+}
+
+/**
+ * \brief           Request next decoder step
+ * \note            Called from step function or before first feed
+ * \param[in]       s: Stream decoder
+ * \param[in]       dst: Destination memory for `len` bytes, `NULL` to skip them
+ * \param[in]       len: Number of bytes to wait for. When `0`, step function is called immediately
+ * \param[in]       fn: Function called when `len` bytes were received
+ */
+void
+esp_stream_expect(esp_stream_t* s, void* dst, size_t len, esp_stream_fn fn) {
+    s->dst = dst;
+    s->need = len;
+    s->fn = fn;
+}
+
+/**
+ * \brief           Feed received data to decoder
+ *
+ * Data are copied to step destinations, memory can be reused after function returns.
+ * Decoder state is kept between calls, steps may span any number of feeds.
+ *
+ * \param[in]       s: Stream decoder
+ * \param[in]       data: Received data
+ * \param[in]       len: Length of data in units of bytes
+ * \return          \ref espOK on success, result of step function that stopped decoding otherwise
+ */
+espr_t
+esp_stream_feed(esp_stream_t* s, const void* data, size_t len) {
+    const uint8_t* d = data;
+    esp_stream_fn fn;
+    espr_t res;
+    size_t l;
+
+    for (;;) {
+        /* Run all completed steps, including ones requesting no data */
+        while (s->need == 0) {
+            if ((fn = s->fn) == NULL) {
+                return espERR;                  /* No next step requested */
+            }
+            s->fn = NULL;
+            if ((res = fn(s)) != espOK) {
+                return res;
+            }
+        }
+        if (len == 0) {
+            break;
+        }
+        l = ESP_MIN(s->need, len);
+        if (s->dst != NULL) {
+            ESP_MEMCPY(s->dst, d, l);
+            s->dst += l;
+        }
+        s->need -= l;
+        d += l;
+        len -= l;
+    }
+    return espOK;
+}
+
+/**
+ * \brief           Segment callback for \ref esp_stream_feed_pbuf
+ */
+static uint8_t
+stream_pbuf_fn(const void* data, size_t len, size_t pos, void* arg) {
+    stream_pbuf_t* f = arg;
+
+    ESP_UNUSED(pos);
+    f->res = esp_stream_feed(f->s, data, len);
+    return f->res == espOK;
+}
+
+/**
+ * \brief           Feed all segments of pbuf chain to decoder
+ *
+ * No data are referenced after function returns, caller can free pbuf immediately.
+ *
+ * \param[in]       s: Stream decoder
+ * \param[in]       pbuf: Received pbuf chain
+ * \return          \ref espOK on success, result of step function that stopped decoding otherwise
+ */
+espr_t
+esp_stream_feed_pbuf(esp_stream_t* s, const esp_pbuf_p pbuf) {
+    stream_pbuf_t f = { .s = s, .res = espOK };
+
+    esp_pbuf_for_each_segment(pbuf, 0, ESP_SIZET_MAX, stream_pbuf_fn, &f);
+    return f.res;
+}
@@ -0,0 +1,91 @@
+/**
+ * \file            esp_stream.h
+ * \brief           Resumable stream decoder
+ */
+
+/*
+ * Copyright (c) 2018 Tilen Majerle
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE
+ * AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of ESP-AT library.
+ *
+ * Author:          Tilen MAJERLE <tilen@majerle.eu>
+ */
+#ifndef ESP_HDR_STREAM_H
+#define ESP_HDR_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "esp/esp.h"
+
+/**
+ * \ingroup         ESP
+ * \defgroup        ESP_STREAM Stream decoder
+ * \brief           Resumable decoder for protocols over connection data
+ *
+ * Decoder is driven by steps. Each step requests exact number of bytes
+ * and function to call when they are received. Bytes are copied to step
+ * destination as they arrive, so received buffers can be released
+ * immediately after they were fed and a frame split over any number
+ * of received buffers does not need to be collected in contiguous memory.
+ *
+ * \{
+ */
+
+struct esp_stream;
+
+/**
+ * \brief           Step function, called when all requested bytes were received
+ *
+ * Function must request next step with \ref esp_stream_expect
+ *
+ * \param[in]       s: Stream decoder
+ * \return          \ref espOK to continue decoding, member of \ref espr_t enumeration to stop it
+ */
+typedef espr_t (*esp_stream_fn)(struct esp_stream* s);
+
+/**
+ * \brief           Stream decoder state
+ */
+typedef struct esp_stream {
+    uint8_t* dst;                               /*!< Destination for requested bytes, `NULL` to skip them */
+    size_t need;                                /*!< Number of bytes still missing for current step */
+    esp_stream_fn fn;                           /*!< Function called when current step is complete */
+    void* arg;                                  /*!< Custom user argument */
+} esp_stream_t;
+
+void        esp_stream_init(esp_stream_t* s, void* dst, size_t len, esp_stream_fn fn, void* arg);
+void        esp_stream_expect(esp_stream_t* s, void* dst, size_t len, esp_stream_fn fn);
+espr_t      esp_stream_feed(esp_stream_t* s, const void* data, size_t len);
+espr_t      esp_stream_feed_pbuf(esp_stream_t* s, const esp_pbuf_p pbuf);
+
+/**
+ * \}
+ */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* ESP_HDR_STREAM_H */
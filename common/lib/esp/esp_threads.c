@@ -39,6 +39,76 @@
 #include "esp/esp_mem.h"
 #include "system/esp_sys.h"
 
+/**
+ * \brief           Check if message can start and execute reset delay
+ * \note            Core must be locked when calling this function
+ * \param[in]       msg: Message to start
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+static espr_t
+msg_prepare(esp_msg_t* msg) {
+    /*
+     * This check is performed when adding command to queue
+     * Do it again here to prevent long timeouts,
+     * if device present flag changes
+     */
+    if (!esp.status.f.dev_present) {
+        ESP_DEBUGF(ESP_CFG_DBG_THREAD | ESP_DBG_TYPE_TRACE | ESP_DBG_LVL_WARNING,
+                   "[ESP THREAD] Device is not present\r\n");
+        return espERRNODEVICE;
+    }
+
+    /* For reset message, we can have delay! */
+    if (msg->cmd_def == ESP_CMD_RESET) {
+        if (msg->msg.reset.delay > 0) {
+            esp_delay(msg->msg.reset.delay);
+        }
+        espi_reset_everything(1);               /* Reset stack before trying to reset */
+    }
+    return espOK;
+}
+
+/**
+ * \brief           Notify application about finished message and release it
+ * \note            Core must be locked when calling this function
+ * \param[in]       msg: Finished message
+ * \param[in]       res: Execution result
+ */
+static void
+msg_finish(esp_msg_t* msg, espr_t res) {
+    /* Notify application on command timeout */
+    if (res == espTIMEOUT) {
+        espi_send_cb(ESP_EVT_CMD_TIMEOUT);
+    }
+    if (res != espOK) {
+        /* Process global callbacks */
+        espi_process_events_for_timeout_or_error(msg, res);
+
+        msg->res = res;                         /* Save response */
+    }
+
+#if ESP_CFG_USE_API_FUNC_EVT
+    /* Send event function to user */
+    if (msg->evt_fn != NULL) {
+        msg->evt_fn(msg->res, msg->evt_arg);    /* Send event with user argument */
+    }
+#endif /* ESP_CFG_USE_API_FUNC_EVT */
+
+    /*
+     * In case message is blocking,
+     * release semaphore and notify finished with processing
+     * otherwise directly free memory of message structure
+     */
+    if (msg->is_blocking) {
+        esp_sys_sem_release(&msg->sem);
+    } else {
+        ESP_MSG_VAR_FREE(msg);
+    }
+    esp.msg = NULL;
+}
+
+#if !ESP_CFG_SINGLE_THREAD || __DOXYGEN__
+
 /**
  * \brief           User thread to process input packets from API functions
  * \param[in]       arg: User argument. Semaphore to release when thread starts
@@ -67,27 +137,8 @@ esp_thread_produce(void* const arg) {
         ESP_THREAD_PRODUCER_HOOK();             /* Execute producer thread hook */
         esp_core_lock();
 
-        res = espOK;                            /* Start with OK */
         e->msg = msg;                           /* Set message handle */
-
-        /*
-         * This check is performed when adding command to queue
-         * Do it again here to prevent long timeouts,
-         * if device present flag changes
-         */
-        if (!e->status.f.dev_present) {
-            ESP_DEBUGF(ESP_CFG_DBG_THREAD | ESP_DBG_TYPE_TRACE | ESP_DBG_LVL_WARNING,
-                       "[ESP THREAD] Device is not present\r\n");
-            res = espERRNODEVICE;
-        }
-
-        /* For reset message, we can have delay! */
-        if (res == espOK && msg->cmd_def == ESP_CMD_RESET) {
-            if (msg->msg.reset.delay > 0) {
-                esp_delay(msg->msg.reset.delay);
-            }
-            espi_reset_everything(1);           /* Reset stack before trying to reset */
-        }
+        res = msg_prepare(msg);
 
         /*
          * Try to call function to process this message
@@ -114,11 +165,6 @@ esp_thread_produce(void* const arg) {
                 }
             }
 
-            /* Notify application on command timeout */
-            if (res == espTIMEOUT) {
-                espi_send_cb(ESP_EVT_CMD_TIMEOUT);
-            }
-
             ESP_DEBUGW(ESP_CFG_DBG_THREAD | ESP_DBG_TYPE_TRACE | ESP_DBG_LVL_SEVERE,
                 res == espTIMEOUT,
                 "[THREAD] Timeout in produce thread waiting for command to finish in process thread\r\n");
@@ -148,31 +194,7 @@ esp_thread_produce(void* const arg) {
                 res = espERR;                   /* Simply set error message */
             }
         }
-        if (res != espOK) {
-            /* Process global callbacks */
-            espi_process_events_for_timeout_or_error(msg, res);
-
-            msg->res = res;                     /* Save response */
-        }
-
-#if ESP_CFG_USE_API_FUNC_EVT
-        /* Send event function to user */
-        if (msg->evt_fn != NULL) {
-            msg->evt_fn(msg->res, msg->evt_arg);/* Send event with user argument */
-        }
-#endif /* ESP_CFG_USE_API_FUNC_EVT */
-
-        /*
-         * In case message is blocking,
-         * release semaphore and notify finished with processing
-         * otherwise directly free memory of message structure
-         */
-        if (msg->is_blocking) {
-            esp_sys_sem_release(&msg->sem);
-        } else {
-            ESP_MSG_VAR_FREE(msg);
-        }
-        e->msg = NULL;
+        msg_finish(msg, res);
     }
 }
 
@@ -223,3 +245,87 @@ esp_thread_process(void* const arg) {
 #endif /* !ESP_CFG_INPUT_USE_PROCESS */
     }
 }
+
+#endif /* !ESP_CFG_SINGLE_THREAD || __DOXYGEN__ */
+
+#if ESP_CFG_SINGLE_THREAD || __DOXYGEN__
+
+/**
+ * \brief           Timeout callback for maximal execution time of current message
+ * \param[in]       arg: Message started together with timeout
+ */
+static void
+msg_timeout_cb(void* arg) {
+    if (esp.msg == arg && !esp.msg_done) {
+        ESP_DEBUGF(ESP_CFG_DBG_THREAD | ESP_DBG_TYPE_TRACE | ESP_DBG_LVL_SEVERE,
+            "[THREAD] Timeout in stack thread waiting for command to finish\r\n");
+        msg_finish(esp.msg, espTIMEOUT);
+    }
+}
+
+/**
+ * \brief           Single stack thread for commands, received data and timeouts
+ *
+ *                  Thread replaces producer, process and low-level receive threads.
+ *                  It wakes up on API message, \ref esp_input_notify or timeout
+ *                  and runs all pending work to completion.
+ *                  Command is started only when previous one has finished,
+ *                  pending messages wait in producer queue
+ *
+ * \param[in]       arg: User argument. Semaphore to release when thread starts
+ * \sa              ESP_CFG_SINGLE_THREAD
+ */
+void
+esp_thread_single(void* const arg) {
+    esp_sys_sem_t* sem = arg;
+    esp_t* e = &esp;
+    esp_msg_t* msg;
+    espr_t res;
+    uint32_t time;
+
+    ESP_DEBUGF(ESP_CFG_DBG_THREAD | ESP_DBG_TYPE_TRACE, "[ESP THREAD] Single thread started\r\n");
+
+    /* Thread is running, unlock semaphore */
+    if (esp_sys_sem_isvalid(sem)) {
+        esp_sys_sem_release(sem);               /* Release semaphore */
+    }
+
+    while (1) {
+        /* Timeouts are processed here, new timeout or message wakes up thread */
+        time = espi_get_from_mbox_with_timeout_checks(&e->mbox_process, (void **)&msg, 0);
+        ESP_THREAD_PROCESS_HOOK();              /* Execute process thread hook */
+        ESP_UNUSED(time);
+        esp_core_lock();
+
+        if (e->ll.recv_fn != NULL) {
+            e->ll.recv_fn();                    /* Process received data */
+        }
+        if (e->msg != NULL && e->msg_done) {    /* Parser finished current message */
+            esp_timeout_stop(&e->msg_timeout);
+            msg_finish(e->msg, espOK);
+        }
+
+        /* Start next message, messages failing to start are finished immediately */
+        while (e->msg == NULL && esp_sys_mbox_getnow(&e->mbox_producer, (void **)&msg)) {
+            ESP_THREAD_PRODUCER_HOOK();         /* Execute producer thread hook */
+            e->msg = msg;                       /* Set message handle */
+            e->msg_done = 0;
+            res = msg_prepare(msg);
+            if (res == espOK) {
+                res = msg->fn != NULL ? msg->fn(msg) : espERR;
+            }
+            if (res == espOK) {
+                if (msg->block_time > 0) {
+                    esp_timeout_start(&e->msg_timeout, msg->block_time, msg_timeout_cb, msg);
+                }
+            } else {
+                ESP_DEBUGF(ESP_CFG_DBG_THREAD | ESP_DBG_TYPE_TRACE | ESP_DBG_LVL_SEVERE,
+                    "[THREAD] Could not start execution for command %d\r\n", (int)msg->cmd);
+                msg_finish(msg, res);
+            }
+        }
+        esp_core_unlock();
+    }
+}
+
+#endif /* ESP_CFG_SINGLE_THREAD || __DOXYGEN__ */
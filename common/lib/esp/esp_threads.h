@@ -41,6 +41,7 @@ extern "C" {
 
 void    esp_thread_produce(void* const arg);
 void    esp_thread_process(void* const arg);
+void    esp_thread_single(void* const arg);
 
 #ifdef __cplusplus
 }
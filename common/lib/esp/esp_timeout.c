@@ -34,8 +34,100 @@
 #include "esp/esp_timeout.h"
 #include "esp/esp_mem.h"
 
-static esp_timeout_t* first_timeout;
-static uint32_t last_timeout_time;
+#define WHEEL_SIZE          ESP_CFG_TIMEOUT_WHEEL_SIZE
+#define WHEEL_MASK          (WHEEL_SIZE - 1)
+#define WHEEL_TICK          ESP_CFG_TIMEOUT_WHEEL_TICK
+
+static esp_timeout_t* wheel_slots[WHEEL_SIZE];  /*!< Intrusive lists of timeouts, hashed by expiry tick */
+static uint32_t wheel_bitmap[WHEEL_SIZE / 32];  /*!< Bit per non-empty slot */
+static uint32_t wheel_tick;                     /*!< Last processed wheel tick */
+static uint32_t wheel_time;                     /*!< Time in milliseconds of last processed wheel tick */
+static size_t wheel_cnt;                        /*!< Number of active timeouts */
+
+/**
+ * \brief           Link timeout entry to wheel
+ * \note            Timeout lock must be held when calling this function
+ * \param[in]       to: Timeout entry to link
+ * \param[in]       time: Time in units of milliseconds from now
+ */
+static void
+wheel_insert(esp_timeout_t* to, uint32_t time) {
+    uint32_t now, ticks, slot;
+
+    now = esp_sys_now();
+    if (wheel_cnt == 0) {
+        wheel_time = now;                       /* No pending entries, align wheel to current time */
+    }
+
+    /*
+     * Timeout starts from NOW, but wheel may lag behind
+     * when process thread did not wake up yet.
+     * Round up to next tick to never expire too early
+     */
+    ticks = (now - wheel_time + time + WHEEL_TICK - 1) / WHEEL_TICK;
+    if (ticks == 0) {
+        ticks = 1;                              /* Current tick was already processed */
+    }
+    to->tick = wheel_tick + ticks;
+
+    slot = to->tick & WHEEL_MASK;
+    to->prev = NULL;
+    to->next = wheel_slots[slot];
+    if (to->next != NULL) {
+        to->next->prev = to;
+    }
+    wheel_slots[slot] = to;
+    wheel_bitmap[slot >> 5] |= 1UL << (slot & 0x1F);
+    to->active = 1;
+    ++wheel_cnt;
+}
+
+/**
+ * \brief           Unlink timeout entry from wheel
+ * \note            Timeout lock must be held when calling this function
+ * \param[in]       to: Active timeout entry to unlink
+ */
+static void
+wheel_remove(esp_timeout_t* to) {
+    uint32_t slot = to->tick & WHEEL_MASK;
+
+    if (to->prev != NULL) {
+        to->prev->next = to->next;
+    } else {
+        wheel_slots[slot] = to->next;
+    }
+    if (to->next != NULL) {
+        to->next->prev = to->prev;
+    }
+    if (wheel_slots[slot] == NULL) {
+        wheel_bitmap[slot >> 5] &= ~(1UL << (slot & 0x1F));
+    }
+    to->next = to->prev = NULL;
+    to->active = 0;
+    --wheel_cnt;
+}
+
+/**
+ * \brief           Get number of ticks to next non-empty wheel slot
+ * \note            Timeout lock must be held and at least one timeout must be active
+ * \return          Number of ticks, between `1` and `WHEEL_SIZE`
+ */
+static uint32_t
+wheel_next_slot_diff(void) {
+    uint32_t idx, bits;
+
+    for (uint32_t d = 1; d <= WHEEL_SIZE;) {
+        idx = (wheel_tick + d) & WHEEL_MASK;
+        bits = wheel_bitmap[idx >> 5] >> (idx & 0x1F);
+        if (bits == 0) {
+            d += 32 - (idx & 0x1F);             /* Skip rest of bitmap word */
+            continue;
+        }
+        for (; !(bits & 0x01); bits >>= 1, ++d) {}
+        return d;
+    }
+    return WHEEL_SIZE;
+}
 
 /**
  * \brief           Get time we have to wait before we can process next timeout
@@ -43,45 +135,86 @@ static uint32_t last_timeout_time;
  */
 static uint32_t
 get_next_timeout_diff(void) {
-    uint32_t diff;
-    if (first_timeout == NULL) {
+    uint32_t diff, wait;
+
+    espi_lock(ESP_LOCK_TIMEOUT);
+    if (wheel_cnt == 0) {
+        espi_unlock(ESP_LOCK_TIMEOUT);
         return 0xFFFFFFFF;
     }
-    diff = esp_sys_now() - last_timeout_time;   /* Get difference between current time and last process time */
-    if (diff >= first_timeout->time) {          /* Are we over already? */
-        return 0;                               /* We have to immediatelly process this timeout */
+
+    /*
+     * Wake up on next non-empty slot only.
+     * Entries for further rounds cost at most one wakeup per wheel round
+     */
+    wait = wheel_next_slot_diff() * WHEEL_TICK;
+    diff = esp_sys_now() - wheel_time;          /* Get difference between current time and last processed tick */
+    espi_unlock(ESP_LOCK_TIMEOUT);
+    if (diff >= wait) {                         /* Are we over already? */
+        return 0;                               /* We have to immediatelly process timeouts */
     }
-    return first_timeout->time - diff;          /* Return remaining time for sleep */
+    return wait - diff;                         /* Return remaining time for sleep */
 }
 
 /**
- * \brief           Process next timeout in a linked list
+ * \brief           Process all expired timeouts
+ *
+ * Timeout lock is released while callback is called,
+ * so other threads can start or stop timeouts in the meantime
+ *
+ * \note            Core must be locked when calling this function
  */
 static void
-process_next_timeout(void) {
-    uint32_t time;
+process_timeouts(void) {
+    esp_timeout_t* to;
+    esp_timeout_fn fn;
+    void* arg;
+    uint32_t ticks, steps, start, slot;
 
-    time = esp_sys_now();
+    espi_lock(ESP_LOCK_TIMEOUT);
+    ticks = (esp_sys_now() - wheel_time) / WHEEL_TICK;
+    if (ticks == 0) {
+        espi_unlock(ESP_LOCK_TIMEOUT);
+        return;
+    }
 
     /*
-     * Before calling timeout callback, update variable
+     * Advance wheel before calling callbacks
      * to make sure we have correct timing in case
      * callback creates timeout value again
      */
-    last_timeout_time = time;                   /* Reset variable when we were last processed */
-
-    if (first_timeout != NULL) {
-        esp_timeout_t* to = first_timeout;
-
-        /*
-         * Before calling callback remove current timeout from list
-         * to make sure we are safe in case callback function
-         * adds a new timeout entry to list
-         */
-        first_timeout = first_timeout->next;    /* Set next timeout on a list as first timeout */
-        to->fn(to->arg);                        /* Call user callback function */
-        esp_mem_free_s((void **)&to);
+    start = wheel_tick;
+    wheel_tick += ticks;
+    wheel_time += ticks * WHEEL_TICK;
+
+    /* After full wheel round, every slot was passed */
+    steps = ticks > WHEEL_SIZE ? WHEEL_SIZE : ticks;
+    for (uint32_t i = 1; i <= steps; ++i) {
+        slot = (start + i) & WHEEL_MASK;
+        while (1) {
+            /* Find expired entry, others in slot are for next rounds */
+            for (to = wheel_slots[slot]; to != NULL && (int32_t)(to->tick - wheel_tick) > 0; to = to->next) {}
+            if (to == NULL) {
+                break;
+            }
+
+            /*
+             * Before calling callback remove current timeout from wheel
+             * to make sure we are safe in case callback function
+             * adds, restarts or stops any timeout entry
+             */
+            wheel_remove(to);
+            fn = to->fn;
+            arg = to->arg;
+            if (to->pooled) {
+                esp_mempool_free_s((void **)&to);
+            }
+            espi_unlock(ESP_LOCK_TIMEOUT);
+            fn(arg);                            /* Call user callback function */
+            espi_lock(ESP_LOCK_TIMEOUT);
+        }
     }
+    espi_unlock(ESP_LOCK_TIMEOUT);
 }
 
 /**
@@ -95,14 +228,14 @@ uint32_t
 espi_get_from_mbox_with_timeout_checks(esp_sys_mbox_t* b, void** m, uint32_t timeout) {
     uint32_t wait_time;
     do {
-        if (first_timeout == NULL) {            /* We have no timeouts ready? */
+        wait_time = get_next_timeout_diff();    /* Get time to wait for next timeout execution */
+        if (wait_time == 0xFFFFFFFF) {          /* We have no timeouts ready? */
             return esp_sys_mbox_get(b, m, timeout); /* Get entry from message queue */
         }
-        wait_time = get_next_timeout_diff();    /* Get time to wait for next timeout execution */
         if (!wait_time || esp_sys_mbox_get(b, m, wait_time) == ESP_SYS_TIMEOUT) {
             ESP_THREAD_PROCESS_HOOK();          /* Process thread hook */
             esp_core_lock();
-            process_next_timeout();             /* Process with next timeout */
+            process_timeouts();                 /* Process all expired timeouts */
             esp_core_unlock();
         }
         break;
@@ -110,8 +243,75 @@ espi_get_from_mbox_with_timeout_checks(esp_sys_mbox_t* b, void** m, uint32_t tim
     return wait_time;
 }
 
+/**
+ * \brief           Start or restart timeout entry provided by user
+ *
+ * Entry memory is owned by caller and must stay valid until it expires or is stopped.
+ * No memory is allocated by this function.
+ *
+ * \note            Entry must be zero-initialized before first use
+ * \param[in]       to: Pointer to timeout entry
+ * \param[in]       time: Time in units of milliseconds for timeout execution
+ * \param[in]       fn: Callback function to call when timeout expires
+ * \param[in]       arg: Pointer to user specific argument to call when timeout callback function is executed
+ * \return          \ref espOK on success, member of \ref espr_t enumeration otherwise
+ */
+espr_t
+esp_timeout_start(esp_timeout_t* to, uint32_t time, esp_timeout_fn fn, void* arg) {
+    ESP_ASSERT("to != NULL", to != NULL);
+    ESP_ASSERT("fn != NULL", fn != NULL);
+
+    espi_lock(ESP_LOCK_TIMEOUT);
+    if (to->active) {
+        wheel_remove(to);                       /* Restart already active entry */
+    }
+    to->fn = fn;
+    to->arg = arg;
+    wheel_insert(to, time);
+    espi_unlock(ESP_LOCK_TIMEOUT);
+    esp_sys_mbox_putnow(&esp.mbox_process, NULL);   /* Write message to process queue to wakeup process thread and to start */
+    return espOK;
+}
+
+/**
+ * \brief           Stop timeout entry started with \ref esp_timeout_start
+ * \param[in]       to: Pointer to timeout entry
+ * \return          \ref espOK on success, \ref espERR if entry was not active
+ */
+espr_t
+esp_timeout_stop(esp_timeout_t* to) {
+    espr_t res = espERR;
+
+    ESP_ASSERT("to != NULL", to != NULL);
+
+    espi_lock(ESP_LOCK_TIMEOUT);
+    if (to->active) {
+        wheel_remove(to);
+        if (to->pooled) {
+            esp_mempool_free_s((void **)&to);
+        }
+        res = espOK;
+    }
+    espi_unlock(ESP_LOCK_TIMEOUT);
+    return res;
+}
+
+/**
+ * \brief           Check if timeout entry is waiting to expire
+ * \param[in]       to: Pointer to timeout entry
+ * \return          `1` if active, `0` otherwise
+ */
+uint8_t
+esp_timeout_is_active(const esp_timeout_t* to) {
+    return to != NULL && to->active;
+}
+
 /**
  * \brief           Add new timeout to processing list
+ *
+ * Entry is allocated from timeout pool and released after it expires.
+ * Use \ref esp_timeout_start with own entry for periodic timeouts
+ *
  * \param[in]       time: Time in units of milliseconds for timeout execution
  * \param[in]       fn: Callback function to call when timeout expires
  * \param[in]       arg: Pointer to user specific argument to call when timeout callback function is executed
@@ -120,71 +320,16 @@ espi_get_from_mbox_with_timeout_checks(esp_sys_mbox_t* b, void** m, uint32_t tim
 espr_t
 esp_timeout_add(uint32_t time, esp_timeout_fn fn, void* arg) {
     esp_timeout_t* to;
-    uint32_t now, diff = 0;
 
     ESP_ASSERT("fn != NULL", fn != NULL);
 
-    to = esp_mem_calloc(1, sizeof(*to));        /* Allocate memory for timeout structure */
+    to = esp_mempool_alloc(ESP_MEMPOOL_TIMEOUT, sizeof(*to));   /* Allocate memory for timeout structure */
     if (to == NULL) {
         return espERR;
     }
-
-    esp_core_lock();
-    now = esp_sys_now();                        /* Get current time */
-    if (first_timeout != NULL) {
-        diff = now - last_timeout_time;         /* Get difference between current and last processed time */
-    }
-
-    /*
-     * Since we want timeout value to start from NOW,
-     * we have to add time when we last processed our timeouts
-     */
-    to->time = time + diff;
-    to->arg = arg;
-    to->fn = fn;
-
-    /*
-     * Add new timeout to proper place on linked list
-     * and align times to have correct values between timeouts
-     */
-    if (first_timeout == NULL) {
-        first_timeout = to;                     /* Set as first element */
-        last_timeout_time = now;                /* Reset last timeout time to current time */
-    } else {                                    /* Find where to place a new timeout */
-        /*
-         * First check if we have to put new timeout
-         * to beginning of linked list.
-         * In this case just align new value for current first element
-         */
-        if (first_timeout->time > to->time) {
-            first_timeout->time -= time;        /* Decrease first timeout value to match difference */
-            to->next = first_timeout;           /* Set first timeout as next of new one */
-            first_timeout = to;                 /* Set new timeout as first */
-        } else {                                /* Go somewhere in between current list */
-            for (esp_timeout_t* t = first_timeout; t != NULL; t = t->next) {
-                to->time -= t->time;            /* Decrease new timeout time by time in a linked list */
-                /*
-                 * Enter between 2 entries on a list in case:
-                 *
-                 * - We reached end of linked list
-                 * - Our time is less than diff between 2 entries in list
-                 */
-                if (t->next == NULL || t->next->time > to->time) {
-                    if (t->next != NULL) {      /* Check if there is next element */
-                        t->next->time -= to->time;  /* Decrease difference time to next one */
-                    } else if (to->time > time) {   /* Overflow of time check */
-                        to->time = time + first_timeout->time;
-                    }
-                    to->next = t->next;         /* Change order of elements */
-                    t->next = to;               /* Add new element to linked list */
-                    break;
-                }
-            }
-        }
-    }
-    esp_core_unlock();
-    esp_sys_mbox_putnow(&esp.mbox_process, NULL);   /* Write message to process queue to wakeup process thread and to start */
-    return espOK;
+    ESP_MEMSET(to, 0x00, sizeof(*to));
+    to->pooled = 1;
+    return esp_timeout_start(to, time, fn, arg);
 }
 
 /**
@@ -194,38 +339,17 @@ esp_timeout_add(uint32_t time, esp_timeout_fn fn, void* arg) {
  */
 espr_t
 esp_timeout_remove(esp_timeout_fn fn) {
-    uint8_t success = 0;
-
-    esp_core_lock();
-    for (esp_timeout_t* t = first_timeout, *t_prev = NULL; t != NULL;
-            t_prev = t, t = t->next) {          /* Check all entries */
-        if (t->fn == fn) {                      /* Do we have a match from callback point of view? */
+    espr_t res = espERR;
 
-            /*
-             * We have to first increase
-             * difference time between current and next one
-             * to be aligned for correct wait time
-             */
-            if (t->next != NULL) {              /* Do we have next element? */
-                t->next->time += t->time;       /* Increase timeout time for next element */
-            }
-
-            /*
-             * In case we have previous element on a list,
-             * set next element of previous to next of current one
-             * otherwise we were first element so simply set
-             * next of current as first one
-             */
-            if (t_prev != NULL) {
-                t_prev->next = t->next;
-            } else {
-                first_timeout = t->next;
+    espi_lock(ESP_LOCK_TIMEOUT);
+    for (size_t i = 0; i < WHEEL_SIZE && res != espOK; ++i) {
+        for (esp_timeout_t* t = wheel_slots[i]; t != NULL; t = t->next) {
+            if (t->fn == fn) {                  /* Do we have a match from callback point of view? */
+                res = esp_timeout_stop(t);
+                break;
             }
-            esp_mem_free_s((void **)&t);
-            success = 1;
-            break;
         }
     }
-    esp_core_unlock();
-    return success ? espOK : espERR;
+    espi_unlock(ESP_LOCK_TIMEOUT);
+    return res;
 }
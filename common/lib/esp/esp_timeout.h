@@ -49,6 +49,10 @@ extern "C" {
 espr_t          esp_timeout_add(uint32_t time, esp_timeout_fn fn, void* arg);
 espr_t          esp_timeout_remove(esp_timeout_fn fn);
 
+espr_t          esp_timeout_start(esp_timeout_t* to, uint32_t time, esp_timeout_fn fn, void* arg);
+espr_t          esp_timeout_stop(esp_timeout_t* to);
+uint8_t         esp_timeout_is_active(const esp_timeout_t* to);
+
 /**
  * \}
  */
@@ -163,6 +163,15 @@ typedef struct {
     uint8_t wps;                                /*!< Status if WPS function is supported */
 } esp_ap_t;
 
+/**
+ * \ingroup         ESP_STA
+ * \brief           Callback function for each access point found by \ref esp_sta_scan_ap
+ * \param[in]       ap: Access point data, valid only during callback
+ * \param[in]       arg: Custom user argument
+ * \return          `1` to continue with next access point, `0` to ignore rest of scan result
+ */
+typedef uint8_t (*esp_sta_ap_fn)(const esp_ap_t* ap, void* arg);
+
 /**
  * \ingroup         ESP_AP
  * \brief           Access point information on which station is connected to
@@ -256,6 +265,17 @@ typedef struct esp_conn* esp_conn_p;
  */
 typedef struct esp_pbuf* esp_pbuf_p;
 
+/**
+ * \ingroup         ESP_PBUF
+ * \brief           Pbuf segment callback function prototype
+ * \param[in]       data: Pointer to linear segment memory
+ * \param[in]       len: Length of segment memory in units of bytes
+ * \param[in]       pos: Position of segment memory from start of iteration
+ * \param[in]       arg: Custom user argument
+ * \return          `1` to continue with next segment, `0` to stop iteration
+ */
+typedef uint8_t (*esp_pbuf_seg_fn)(const void* data, size_t len, size_t pos, void* arg);
+
 /**
  * \ingroup         ESP_EVT
  * \brief           Event function prototype
@@ -428,6 +448,17 @@ typedef size_t (*esp_ll_send_fn)(const void* data, size_t len);
  */
 typedef uint8_t (*esp_ll_reset_fn)(uint8_t state);
 
+/**
+ * \ingroup         ESP_LL
+ * \brief           Function prototype for reading received data in single-thread mode
+ *
+ * Function is called from stack thread after \ref esp_input_notify.
+ * It must pass all newly received data to \ref esp_input_process
+ *
+ * \sa              ESP_CFG_SINGLE_THREAD
+ */
+typedef void (*esp_ll_recv_fn)(void);
+
 /**
  * \ingroup         ESP_LL
  * \brief           Low level user specific functions
@@ -435,11 +466,38 @@ typedef uint8_t (*esp_ll_reset_fn)(uint8_t state);
 typedef struct {
     esp_ll_send_fn send_fn;                     /*!< Callback function to transmit data */
     esp_ll_reset_fn reset_fn;                   /*!< Reset callback function */
+#if ESP_CFG_SINGLE_THREAD || __DOXYGEN__
+    esp_ll_recv_fn recv_fn;                     /*!< Callback function to read received data */
+#endif /* ESP_CFG_SINGLE_THREAD || __DOXYGEN__ */
     struct {
         uint32_t baudrate;                      /*!< UART baudrate value */
     } uart;                                     /*!< UART communication parameters */
 } esp_ll_t;
 
+/**
+ * \ingroup         ESP
+ * \brief           Lock domains of the stack
+ *
+ * Locks must be taken in enumeration order, never in reverse
+ */
+typedef enum {
+    ESP_LOCK_CORE = 0x00,                       /*!< Core lock: receive parser, connections, command pipeline, events */
+    ESP_LOCK_TIMEOUT,                           /*!< Timeout wheel */
+    ESP_LOCK_MEM,                               /*!< Heap and memory pools */
+    ESP_LOCK_END,                               /*!< Last entry, not a valid lock */
+} esp_lock_id_t;
+
+/**
+ * \ingroup         ESP
+ * \brief           Lock contention statistics
+ */
+typedef struct {
+    uint32_t acquired;                          /*!< Number of lock acquisitions */
+    uint32_t contended;                         /*!< Number of acquisitions when lock was held by other thread */
+    uint32_t wait_total;                        /*!< Total time waited on contended lock in units of milliseconds */
+    uint32_t wait_max;                          /*!< Maximal time waited on lock in units of milliseconds */
+} esp_lock_stat_t;
+
 /**
  * \ingroup         ESP_TIMEOUT
  * \brief           Timeout callback function prototype
@@ -450,12 +508,18 @@ typedef void (*esp_timeout_fn)(void* arg);
 /**
  * \ingroup         ESP_TIMEOUT
  * \brief           Timeout structure
+ *
+ * Entry is intrusive and may be embedded in user structure,
+ * see \ref esp_timeout_start and \ref esp_timeout_stop
  */
 typedef struct esp_timeout {
-    struct esp_timeout* next;                   /*!< Pointer to next timeout entry */
-    uint32_t time;                              /*!< Time difference from previous entry */
+    struct esp_timeout* next;                   /*!< Pointer to next timeout entry in wheel slot */
+    struct esp_timeout* prev;                   /*!< Pointer to previous timeout entry in wheel slot */
+    uint32_t tick;                              /*!< Absolute wheel tick when entry expires */
     void* arg;                                  /*!< Argument to pass to callback function */
     esp_timeout_fn fn;                          /*!< Callback function for timeout */
+    uint8_t active;                             /*!< Set to `1` when entry is linked to wheel */
+    uint8_t pooled;                             /*!< Set to `1` when entry is allocated by \ref esp_timeout_add */
 } esp_timeout_t;
 
 /**
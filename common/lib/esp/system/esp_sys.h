@@ -63,6 +63,7 @@ typedef void (*esp_sys_thread_fn)(void *);
 #define ESP_SYS_PORT_CMSIS_OS               1   /*!< CMSIS-OS based port for OS systems capable of ARM CMSIS standard */
 #define ESP_SYS_PORT_WIN32                  2   /*!< WIN32 based port to use ESP library with Windows applications */
 #define ESP_SYS_PORT_CMSIS_OS2              3   /*!< CMSIS-OS v2 based port for OS systems capable of ARM CMSIS standard */
+#define ESP_SYS_PORT_FREERTOS               4   /*!< Native FreeRTOS port with static objects and task notification semaphores */
 #define ESP_SYS_PORT_USER                   99  /*!< User custom implementation.
                                                     When port is selected to user mode, user must provide "esp_sys_user.h" file,
                                                     which is not provided with library. Refer to `system/esp_sys_template.h` file for more information
@@ -77,6 +78,8 @@ typedef void (*esp_sys_thread_fn)(void *);
 #include "system/esp_sys_cmsis_os.h"
 #elif ESP_CFG_SYS_PORT == ESP_SYS_PORT_CMSIS_OS2
 #include "system/esp_sys_cmsis_os2.h"
+#elif ESP_CFG_SYS_PORT == ESP_SYS_PORT_FREERTOS
+#include "system/esp_sys_freertos.h"
 #elif ESP_CFG_SYS_PORT == ESP_SYS_PORT_WIN32
 #include "system/esp_sys_win32.h"
 #elif ESP_CFG_SYS_PORT == ESP_SYS_PORT_USER
@@ -115,6 +118,7 @@ uint8_t     esp_sys_mbox_invalid(esp_sys_mbox_t* b);
 uint8_t     esp_sys_thread_create(esp_sys_thread_t* t, const char* name, esp_sys_thread_fn thread_func, void* const arg, size_t stack_size, esp_sys_thread_prio_t prio);
 uint8_t     esp_sys_thread_terminate(esp_sys_thread_t* t);
 uint8_t     esp_sys_thread_yield(void);
+esp_sys_thread_t    esp_sys_thread_get_id(void);
 
 /**
  * \}
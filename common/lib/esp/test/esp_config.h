@@ -0,0 +1,21 @@
+/**
+ * \file            esp_config.h
+ * \brief           Host configuration for memory manager benchmark
+ */
+
+#ifndef ESP_HDR_CONFIG_H
+#define ESP_HDR_CONFIG_H
+
+/*
+ * Only memory manager is built on host,
+ * ESP_CFG_MEM_TLSF is set by build system for each backend
+ */
+#define ESP_CFG_OS                          1
+#define ESP_CFG_SYS_PORT                    ESP_SYS_PORT_USER
+
+#define ESP_CFG_DBG                         ESP_DBG_OFF
+
+/* After user configuration, call default config to merge config together */
+#include "esp/esp_config_default.h"
+
+#endif /* ESP_HDR_CONFIG_H */
@@ -0,0 +1,24 @@
+/**
+ * \file            esp_sys_user.h
+ * \brief           Host system types for memory manager benchmark
+ */
+
+#ifndef ESP_HDR_SYSTEM_USER_H
+#define ESP_HDR_SYSTEM_USER_H
+
+#include <stdint.h>
+
+/* Benchmark is single threaded, system objects are never created */
+typedef void*                       esp_sys_mutex_t;
+typedef void*                       esp_sys_sem_t;
+typedef void*                       esp_sys_mbox_t;
+typedef void*                       esp_sys_thread_t;
+typedef int                         esp_sys_thread_prio_t;
+#define ESP_SYS_MBOX_NULL           ((esp_sys_mbox_t)0)
+#define ESP_SYS_SEM_NULL            ((esp_sys_sem_t)0)
+#define ESP_SYS_MUTEX_NULL          ((esp_sys_mutex_t)0)
+#define ESP_SYS_TIMEOUT             ((uint32_t)0xFFFFFFFF)
+#define ESP_SYS_THREAD_PRIO         (0)
+#define ESP_SYS_THREAD_SS           (0)
+
+#endif /* ESP_HDR_SYSTEM_USER_H */
@@ -0,0 +1,9 @@
+/**
+ * \file            log.h
+ * \brief           Empty replacement of firmware logging header for host build
+ */
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#endif /* LOG_H_ */
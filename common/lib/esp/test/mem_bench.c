@@ -0,0 +1,549 @@
+/**
+ * \file            mem_bench.c
+ * \brief           Replay allocation traces against memory manager backends
+ *
+ * Same trace is replayed with first-fit list and TLSF backend of `esp_mem.c`.
+ * Traces are memory manager debug logs, recorded on target with
+ * `ESP_CFG_DBG = ESP_DBG_ON` and `ESP_CFG_DBG_TYPES_ON = ESP_DBG_TYPE_TRACE`.
+ * Without trace file, synthetic trace modelled after stack objects is used.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "esp/esp_mem.h"
+
+#define BENCH_HEAP_MAX              0x40000     /*!< Largest heap used by benchmark */
+#define BENCH_PROBE_PERIOD          64          /*!< Number of operations between largest block probes */
+#define BENCH_HEAP_STEP             256         /*!< Heap size resolution when searching minimal heap */
+
+/**
+ * \brief           Single trace operation
+ */
+typedef struct {
+    uint8_t alloc;                              /*!< `1` for allocation, `0` for free */
+    uint32_t id;                                /*!< Allocation identifier */
+    uint32_t size;                              /*!< Requested size, valid for allocation only */
+} trace_op_t;
+
+/**
+ * \brief           Trace loaded to memory
+ */
+typedef struct {
+    trace_op_t* ops;                            /*!< List of operations */
+    size_t len;                                 /*!< Number of operations */
+    size_t size;                                /*!< Size of operations list */
+    uint32_t ids;                               /*!< Number of allocation identifiers */
+    size_t peak;                                /*!< Peak of live requested bytes */
+} trace_t;
+
+/**
+ * \brief           Memory manager backend
+ */
+typedef struct {
+    const char* name;                           /*!< Backend name */
+    uint8_t (*assign)(const esp_mem_region_t* regions, size_t len);
+    void* (*alloc)(size_t size);
+    void (*free)(void* ptr);
+} backend_t;
+
+/**
+ * \brief           Result of one trace replay
+ */
+typedef struct {
+    uint32_t allocs;                            /*!< Number of successful allocations */
+    uint32_t fails;                             /*!< Number of failed allocations */
+    uint32_t frees;                             /*!< Number of free operations */
+    uint64_t alloc_ns;                          /*!< Total allocation time */
+    uint64_t free_ns;                           /*!< Total free time */
+    uint32_t alloc_ns_p99;                      /*!< 99th percentile of allocation time */
+    uint32_t free_ns_p99;                       /*!< 99th percentile of free time */
+    size_t largest_min;                         /*!< Smallest largest allocatable block seen by probes */
+    double frag_max;                            /*!< Highest fragmentation seen by probes */
+    uint32_t corrupt;                           /*!< Number of blocks with overwritten content */
+} result_t;
+
+/* Both backends are built from esp_mem.c with renamed public functions */
+uint8_t esp_mem_list_assignmemory(const esp_mem_region_t* regions, size_t len);
+void*   esp_mem_list_malloc(size_t size);
+void    esp_mem_list_free(void* ptr);
+uint8_t esp_mem_tlsf_assignmemory(const esp_mem_region_t* regions, size_t len);
+void*   esp_mem_tlsf_malloc(size_t size);
+void    esp_mem_tlsf_free(void* ptr);
+
+static const backend_t backends[] = {
+    { "list", esp_mem_list_assignmemory, esp_mem_list_malloc, esp_mem_list_free },
+    { "tlsf", esp_mem_tlsf_assignmemory, esp_mem_tlsf_malloc, esp_mem_tlsf_free },
+};
+
+static uint64_t heap[BENCH_HEAP_MAX / sizeof(uint64_t)];
+
+/* Locking is not needed in single threaded benchmark */
+espr_t esp_core_lock(void) { return espOK; }
+espr_t esp_core_unlock(void) { return espOK; }
+void espi_lock(int id) { (void)id; }
+void espi_unlock(int id) { (void)id; }
+
+/**
+ * \brief           Add operation to trace
+ * \param[in,out]   t: Trace
+ * \param[in]       alloc: `1` for allocation, `0` for free
+ * \param[in]       id: Allocation identifier
+ * \param[in]       size: Requested size
+ */
+static void
+trace_add(trace_t* t, uint8_t alloc, uint32_t id, uint32_t size) {
+    if (t->len == t->size) {
+        t->size = t->size ? 2 * t->size : 1024;
+        t->ops = realloc(t->ops, t->size * sizeof(*t->ops));
+        if (t->ops == NULL) {
+            fprintf(stderr, "Out of memory\r\n");
+            exit(1);
+        }
+    }
+    t->ops[t->len].alloc = alloc;
+    t->ops[t->len].id = id;
+    t->ops[t->len].size = size;
+    t->len++;
+}
+
+/**
+ * \brief           Calculate peak of live requested bytes
+ * \param[in,out]   t: Trace
+ */
+static void
+trace_peak(trace_t* t) {
+    uint32_t* sizes = calloc(t->ids + 1, sizeof(*sizes));
+    size_t live = 0;
+
+    t->peak = 0;
+    for (size_t i = 0; i < t->len; i++) {
+        if (t->ops[i].alloc) {
+            sizes[t->ops[i].id] = t->ops[i].size;
+            live += t->ops[i].size;
+            if (live > t->peak) {
+                t->peak = live;
+            }
+        } else {
+            live -= sizes[t->ops[i].id];
+        }
+    }
+    free(sizes);
+}
+
+/**
+ * \brief           Load trace from memory manager debug log
+ *
+ * Allocations are matched with frees by address.
+ * Frees of blocks allocated before log was started are ignored.
+ *
+ * \param[out]      t: Trace to fill
+ * \param[in]       path: Log file path
+ * \return          `1` on success, `0` otherwise
+ */
+static uint8_t
+trace_load(trace_t* t, const char* path) {
+    struct {
+        unsigned long addr;
+        uint32_t id;
+    } *live = NULL;
+    size_t live_len = 0, live_size = 0;
+    char line[256];
+    FILE* f;
+
+    if ((f = fopen(path, "r")) == NULL) {
+        return 0;
+    }
+    memset(t, 0x00, sizeof(*t));
+    while (fgets(line, sizeof(line), f) != NULL) {
+        const char* s;
+        unsigned long addr;
+        int size;
+
+        if ((s = strstr(line, "[MEM] Allocation OK: ")) != NULL
+            || (s = strstr(line, "[MEM] Callocation OK: ")) != NULL) {
+            if (sscanf(strchr(s, ':') + 1, "%d bytes, addr: %lx", &size, &addr) != 2) {
+                continue;
+            }
+            for (size_t i = 0; i < live_len; i++) {
+                if (live[i].addr == addr) {     /* Free was not logged, forget old block */
+                    live[i] = live[--live_len];
+                    break;
+                }
+            }
+            if (live_len == live_size) {
+                live_size = live_size ? 2 * live_size : 64;
+                live = realloc(live, live_size * sizeof(*live));
+            }
+            live[live_len].addr = addr;
+            live[live_len].id = ++t->ids;
+            live_len++;
+            trace_add(t, 1, t->ids, (uint32_t)size);
+        } else if ((s = strstr(line, "[MEM] Free size: ")) != NULL) {
+            if (sscanf(s, "[MEM] Free size: %d, address: %lx", &size, &addr) != 2) {
+                continue;
+            }
+            for (size_t i = 0; i < live_len; i++) {
+                if (live[i].addr == addr) {
+                    trace_add(t, 0, live[i].id, 0);
+                    live[i] = live[--live_len];
+                    break;
+                }
+            }
+        }
+    }
+    fclose(f);
+    free(live);
+    trace_peak(t);
+    return 1;
+}
+
+/**
+ * \brief           Generate synthetic trace
+ *
+ * Object mix follows firmware configuration: IPD and response packet buffers,
+ * API messages, timeouts and long living connection buffers.
+ *
+ * \param[out]      t: Trace to fill
+ * \param[in]       len: Number of allocations
+ * \param[in]       seed: Random generator seed
+ */
+static void
+trace_generate(trace_t* t, size_t len, uint32_t seed) {
+    struct {
+        uint32_t id;
+        uint32_t size;
+        size_t due;
+    } live[256];
+    size_t live_len = 0, live_bytes = 0, conns = 0;
+
+    memset(t, 0x00, sizeof(*t));
+    for (size_t now = 0; now < len; now++) {
+        uint32_t r, size, life;
+
+        /* Free objects with expired lifetime */
+        for (size_t i = 0; i < live_len;) {
+            if (live[i].due <= now) {
+                trace_add(t, 0, live[i].id, 0);
+                live_bytes -= live[i].size;
+                if (live[i].size == 2048) {
+                    conns--;
+                }
+                live[i] = live[--live_len];
+            } else {
+                i++;
+            }
+        }
+
+        seed = seed * 1103515245 + 12345;
+        r = (seed >> 8) % 100;
+        seed = seed * 1103515245 + 12345;
+        if (r < 45) {                           /* IPD packet buffer */
+            size = 40 + 1 + (seed >> 8) % 1460;
+            life = 1 + (seed >> 20) % 8;
+        } else if (r < 60) {                    /* Response packet buffer */
+            size = 40 + 16 + (seed >> 8) % 112;
+            life = 1 + (seed >> 20) % 4;
+        } else if (r < 80) {                    /* API message */
+            size = 96 + (seed >> 8) % 64;
+            life = 1 + (seed >> 20) % 4;
+        } else if (r < 97) {                    /* Timeout */
+            size = 24;
+            life = 1 + (seed >> 20) % 64;
+        } else {                                /* Connection buffer */
+            if (conns >= 4) {
+                continue;
+            }
+            size = 2048;
+            life = 100 + (seed >> 12) % 2000;
+            conns++;
+        }
+        if (live_len == sizeof(live) / sizeof(live[0]) || live_bytes + size > 0x4000) {
+            if (size == 2048) {
+                conns--;
+            }
+            continue;                           /* Keep trace within firmware heap */
+        }
+        live[live_len].id = ++t->ids;
+        live[live_len].size = size;
+        live[live_len].due = now + life;
+        live_len++;
+        live_bytes += size;
+        trace_add(t, 1, t->ids, size);
+    }
+    for (size_t i = 0; i < live_len; i++) {
+        trace_add(t, 0, live[i].id, 0);
+    }
+    trace_peak(t);
+}
+
+/**
+ * \brief           Get monotonic time in nanoseconds
+ */
+static uint64_t
+time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * \brief           Compare function for operation times
+ */
+static int
+time_cmp(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * \brief           Get 99th percentile of operation times
+ * \param[in,out]   times: Operation times, sorted on return
+ * \param[in]       len: Number of entries
+ * \return          99th percentile
+ */
+static uint32_t
+time_p99(uint32_t* times, size_t len) {
+    if (len == 0) {
+        return 0;
+    }
+    qsort(times, len, sizeof(*times), time_cmp);
+    return times[(len * 99) / 100];
+}
+
+/**
+ * \brief           Find largest block which can be allocated
+ * \param[in]       b: Backend
+ * \param[in]       heap_size: Heap size
+ * \return          Largest allocatable size
+ */
+static size_t
+probe_largest(const backend_t* b, size_t heap_size) {
+    size_t lo = 0, hi = heap_size;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi + 1) / 2;
+        void* p = b->alloc(mid);
+        if (p != NULL) {
+            b->free(p);
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+/**
+ * \brief           Replay trace on fresh heap
+ * \param[in]       b: Backend
+ * \param[in]       t: Trace
+ * \param[in]       heap_size: Heap size
+ * \param[in]       probe: Set to `1` to sample fragmentation
+ * \param[out]      res: Replay result
+ */
+static void
+replay(const backend_t* b, const trace_t* t, size_t heap_size, uint8_t probe, result_t* res) {
+    esp_mem_region_t region = { heap, heap_size };
+    void** ptrs = calloc(t->ids + 1, sizeof(*ptrs));
+    uint32_t* sizes = calloc(t->ids + 1, sizeof(*sizes));
+    uint32_t* alloc_times = calloc(t->len + 1, sizeof(*alloc_times));
+    uint32_t* free_times = calloc(t->len + 1, sizeof(*free_times));
+    size_t live = 0, empty = 0;
+
+    memset(res, 0x00, sizeof(*res));
+    b->assign(&region, 1);
+    if (probe) {
+        empty = probe_largest(b, heap_size);
+        res->largest_min = empty;
+    }
+    for (size_t i = 0; i < t->len; i++) {
+        const trace_op_t* op = &t->ops[i];
+        uint64_t start;
+        uint32_t dur;
+
+        if (op->alloc) {
+            start = time_ns();
+            ptrs[op->id] = b->alloc(op->size);
+            dur = (uint32_t)(time_ns() - start);
+            if (ptrs[op->id] == NULL) {
+                res->fails++;
+                continue;
+            }
+            alloc_times[res->allocs++] = dur;
+            res->alloc_ns += dur;
+            sizes[op->id] = op->size;
+            live += op->size;
+            memset(ptrs[op->id], (int)(op->id & 0xFF), op->size);
+        } else if (ptrs[op->id] != NULL) {
+            const uint8_t* p = ptrs[op->id];
+            for (uint32_t k = 0; k < sizes[op->id]; k++) {
+                if (p[k] != (op->id & 0xFF)) {
+                    res->corrupt++;
+                    break;
+                }
+            }
+            start = time_ns();
+            b->free(ptrs[op->id]);
+            dur = (uint32_t)(time_ns() - start);
+            ptrs[op->id] = NULL;
+            free_times[res->frees++] = dur;
+            res->free_ns += dur;
+            live -= sizes[op->id];
+        }
+        if (probe && (i % BENCH_PROBE_PERIOD) == 0 && empty > live) {
+            size_t largest = probe_largest(b, heap_size);
+            double frag = 1.0 - (double)largest / (double)(empty - live);
+            if (largest < res->largest_min) {
+                res->largest_min = largest;
+            }
+            if (frag > res->frag_max) {
+                res->frag_max = frag;
+            }
+        }
+    }
+    res->alloc_ns_p99 = time_p99(alloc_times, res->allocs);
+    res->free_ns_p99 = time_p99(free_times, res->frees);
+    free(ptrs);
+    free(sizes);
+    free(alloc_times);
+    free(free_times);
+}
+
+/**
+ * \brief           Replay trace in child process
+ *
+ * Memory manager cannot be reassigned, every replay needs fresh process.
+ *
+ * \param[in]       b: Backend
+ * \param[in]       t: Trace
+ * \param[in]       heap_size: Heap size
+ * \param[in]       probe: Set to `1` to sample fragmentation
+ * \param[out]      res: Replay result
+ * \return          `1` on success, `0` when child failed
+ */
+static uint8_t
+replay_fork(const backend_t* b, const trace_t* t, size_t heap_size, uint8_t probe, result_t* res) {
+    int fd[2], status;
+    pid_t pid;
+    ssize_t len;
+
+    if (pipe(fd) != 0 || (pid = fork()) < 0) {
+        return 0;
+    }
+    if (pid == 0) {
+        close(fd[0]);
+        replay(b, t, heap_size, probe, res);
+        len = write(fd[1], res, sizeof(*res));
+        _exit(len == (ssize_t)sizeof(*res) ? 0 : 1);
+    }
+    close(fd[1]);
+    len = read(fd[0], res, sizeof(*res));
+    close(fd[0]);
+    waitpid(pid, &status, 0);
+    return len == (ssize_t)sizeof(*res) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/**
+ * \brief           Find smallest heap which replays trace without failed allocation
+ * \param[in]       b: Backend
+ * \param[in]       t: Trace
+ * \return          Heap size, `0` when trace does not fit to largest heap
+ */
+static size_t
+min_heap(const backend_t* b, const trace_t* t) {
+    size_t lo = 1, hi = BENCH_HEAP_MAX / BENCH_HEAP_STEP;
+    result_t res;
+
+    if (!replay_fork(b, t, hi * BENCH_HEAP_STEP, 0, &res) || res.fails > 0) {
+        return 0;
+    }
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (replay_fork(b, t, mid * BENCH_HEAP_STEP, 0, &res) && res.fails == 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return hi * BENCH_HEAP_STEP;
+}
+
+/**
+ * \brief           Replay trace with all backends and print results
+ * \param[in]       name: Trace name
+ * \param[in]       t: Trace
+ * \param[in]       heap_size: Heap size
+ * \return          `1` on success, `0` on replay error or corrupted memory
+ */
+static uint8_t
+bench(const char* name, const trace_t* t, size_t heap_size) {
+    uint8_t ok = 1;
+
+    printf("Trace %s: %zu operations, %" PRIu32 " allocations, peak %zu bytes, heap %zu bytes\r\n",
+        name, t->len, t->ids, t->peak, heap_size);
+    printf("%-6s %8s %6s %14s %14s %8s %9s %8s\r\n",
+        "", "allocs", "fails", "alloc avg/p99", "free avg/p99", "frag", "largest", "min heap");
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        const backend_t* b = &backends[i];
+        result_t res, probe;
+
+        if (!replay_fork(b, t, heap_size, 0, &res) || !replay_fork(b, t, heap_size, 1, &probe)) {
+            printf("%-6s replay failed\r\n", b->name);
+            ok = 0;
+            continue;
+        }
+        printf("%-6s %8" PRIu32 " %6" PRIu32 " %6" PRIu64 "/%-7" PRIu32 " %6" PRIu64 "/%-7" PRIu32 " %7.1f%% %9zu %8zu\r\n",
+            b->name, res.allocs, res.fails,
+            res.allocs ? res.alloc_ns / res.allocs : 0, res.alloc_ns_p99,
+            res.frees ? res.free_ns / res.frees : 0, res.free_ns_p99,
+            100.0 * probe.frag_max, probe.largest_min, min_heap(b, t));
+        if (res.corrupt > 0 || probe.corrupt > 0) {
+            printf("%-6s %" PRIu32 " corrupted blocks\r\n", b->name, res.corrupt + probe.corrupt);
+            ok = 0;
+        }
+    }
+    printf("\r\n");
+    return ok;
+}
+
+int
+main(int argc, char** argv) {
+    size_t heap_size = 0x6000, ops = 20000;
+    uint8_t ok = 1;
+    trace_t t;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:n:")) != -1) {
+        switch (opt) {
+            case 's': heap_size = strtoul(optarg, NULL, 0); break;
+            case 'n': ops = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "Usage: %s [-s heap_size] [-n synthetic_ops] [trace_log ...]\r\n", argv[0]);
+                return 2;
+        }
+    }
+    if (heap_size > BENCH_HEAP_MAX) {
+        heap_size = BENCH_HEAP_MAX;
+    }
+    printf("Times in ns, frag is 1 - largest / free bytes, min heap is smallest heap without failed allocation\r\n\r\n");
+
+    if (optind == argc) {
+        trace_generate(&t, ops, 1);
+        ok = bench("synthetic", &t, heap_size);
+        free(t.ops);
+    }
+    for (int i = optind; i < argc; i++) {
+        if (!trace_load(&t, argv[i])) {
+            fprintf(stderr, "Cannot open %s\r\n", argv[i]);
+            ok = 0;
+            continue;
+        }
+        ok &= bench(argv[i], &t, heap_size);
+        free(t.ops);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+/**
+ ******************************************************************************
+ * @file           : backoff.h
+ * @author         : Aleksandr Shabalin    <alexnv97@gmail.com>
+ * @brief          : Header file of retry backoff
+ ******************************************************************************
+ * ----------------- Copyright (c) 2023 Aleksandr Shabalin ------------------ *
+ ******************************************************************************
+ * This module is a confidential and proprietary property of Aleksandr Shabalin
+ * and possession or use of this module requires written permission
+ * of Aleksandr Shabalin.
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef APP_BACKOFF_H_
+#define APP_BACKOFF_H_
+
+
+/******************************************************************************/
+/* Includes ----------------------------------------------------------------- */
+/******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cmsis_os2.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+/******************************************************************************/
+/* Public defines ----------------------------------------------------------- */
+/******************************************************************************/
+/* Thread flag used to wake waiting thread, must not be used by the thread otherwise */
+#define BACKOFF_FLAG_KICK            (0x00000001u)
+
+
+/******************************************************************************/
+/* Public variables --------------------------------------------------------- */
+/******************************************************************************/
+typedef struct
+{
+  uint32_t min_ms;
+  uint32_t max_ms;
+  uint32_t delay_ms;
+  uint32_t attempts;
+  osThreadId_t waiter;
+  volatile bool kicked;
+} BACKOFF_t;
+
+
+/******************************************************************************/
+/* Public functions --------------------------------------------------------- */
+/******************************************************************************/
+void Backoff_Init(BACKOFF_t *backoff, uint32_t min_ms, uint32_t max_ms);
+void Backoff_Reset(BACKOFF_t *backoff);
+uint32_t Backoff_Next(BACKOFF_t *backoff);
+bool Backoff_Wait(BACKOFF_t *backoff);
+void Backoff_Kick(BACKOFF_t *backoff);
+
+
+/******************************************************************************/
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
+#endif /* APP_BACKOFF_H_ */
@@ -33,7 +33,7 @@ extern "C" {
 /* Public defines ----------------------------------------------------------- */
 /******************************************************************************/
 // INIT CONFIG_ID
-#define CONFIG_ID    (1u)
+#define CONFIG_ID    (4u)
 #define CONFIG_DEVICE_ESS_CONTROl_BOARD    (0x05u)
 
 #define CONFIG_DEVICE_TYPE     (CONFIG_DEVICE_ESS_CONTROl_BOARD)
@@ -177,6 +177,15 @@ typedef struct __attribute__((__packed__))
   bool enabled;
   char ssid[32];
   char passw[32];
+  bool fast_join;
+  bool fast_static_ip;
+  uint16_t net_check_s;
+  // Last good access point and IP lease, channel 0 if nothing cached
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t ip[4];
+  uint8_t gw[4];
+  uint8_t nm[4];
 } CONFIG_WIFI;
 
 typedef struct __attribute__((__packed__))
@@ -188,6 +197,10 @@ typedef struct __attribute__((__packed__))
   char passw[16];
   uint16_t port;
   uint8_t data_publish_timeout_s;
+  // TLS link, certificates are stored in ESP AT firmware (PKI and CA index 0)
+  bool tls;
+  uint8_t tls_auth;
+  uint16_t tls_buf_size;
 } CONFIG_MQTT;
 
 typedef struct __attribute__((__packed__))
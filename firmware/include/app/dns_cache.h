@@ -0,0 +1,67 @@
+/**
+ ******************************************************************************
+ * @file           : dns_cache.h
+ * @author         : Aleksandr Shabalin    <alexnv97@gmail.com>
+ * @brief          : Header file of DNS result cache
+ ******************************************************************************
+ * ----------------- Copyright (c) 2023 Aleksandr Shabalin ------------------ *
+ ******************************************************************************
+ * This module is a confidential and proprietary property of Aleksandr Shabalin
+ * and possession or use of this module requires written permission
+ * of Aleksandr Shabalin.
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef APP_DNS_CACHE_H_
+#define APP_DNS_CACHE_H_
+
+
+/******************************************************************************/
+/* Includes ----------------------------------------------------------------- */
+/******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+/******************************************************************************/
+/* Public defines ----------------------------------------------------------- */
+/******************************************************************************/
+/* Buffer size for dotted IPv4 address with terminator */
+#define DNS_CACHE_IP_STR_SIZE        (16u)
+
+
+/******************************************************************************/
+/* Public variables --------------------------------------------------------- */
+/******************************************************************************/
+typedef struct
+{
+  uint32_t hits;
+  uint32_t lookups;
+  uint32_t fallbacks;
+  uint32_t failures;
+} DNS_CACHE_STAT_t;
+
+
+/******************************************************************************/
+/* Public functions --------------------------------------------------------- */
+/******************************************************************************/
+bool DNSCache_Resolve(const char *host, char *ip, size_t size);
+void DNSCache_Invalidate(const char *host);
+void DNSCache_GetStat(DNS_CACHE_STAT_t *stat);
+
+
+/******************************************************************************/
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
+#endif /* APP_DNS_CACHE_H_ */
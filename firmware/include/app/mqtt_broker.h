@@ -0,0 +1,57 @@
+/**
+ ******************************************************************************
+ * @file           : mqtt_broker.h
+ * @author         : Aleksandr Shabalin    <alexnv97@gmail.com>
+ * @brief          : Header file of local MQTT broker
+ ******************************************************************************
+ * ----------------- Copyright (c) 2023 Aleksandr Shabalin ------------------ *
+ ******************************************************************************
+ * This module is a confidential and proprietary property of Aleksandr Shabalin
+ * and possession or use of this module requires written permission
+ * of Aleksandr Shabalin.
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef APP_MQTT_BROKER_H_
+#define APP_MQTT_BROKER_H_
+
+
+/******************************************************************************/
+/* Includes ----------------------------------------------------------------- */
+/******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp/esp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+/******************************************************************************/
+/* Public defines ----------------------------------------------------------- */
+/******************************************************************************/
+/* Local clients served at the same time, one bit per client in subscription masks */
+#define MQTT_BROKER_MAX_CLIENTS      (4u)
+
+
+/******************************************************************************/
+/* Public functions --------------------------------------------------------- */
+/******************************************************************************/
+espr_t MQTTBroker_Start(esp_port_t port);
+void MQTTBroker_Stop(void);
+void MQTTBroker_Process(uint32_t timeout);
+bool MQTTBroker_Publish(const char *topic, const void *data, uint16_t len);
+
+
+/******************************************************************************/
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
+#endif /* APP_MQTT_BROKER_H_ */
@@ -0,0 +1,62 @@
+/**
+ ******************************************************************************
+ * @file           : mqtt_client.h
+ * @author         : Aleksandr Shabalin    <alexnv97@gmail.com>
+ * @brief          : Header file of MQTT client
+ ******************************************************************************
+ * ----------------- Copyright (c) 2023 Aleksandr Shabalin ------------------ *
+ ******************************************************************************
+ * This module is a confidential and proprietary property of Aleksandr Shabalin
+ * and possession or use of this module requires written permission
+ * of Aleksandr Shabalin.
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef APP_MQTT_CLIENT_H_
+#define APP_MQTT_CLIENT_H_
+
+
+/******************************************************************************/
+/* Includes ----------------------------------------------------------------- */
+/******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp/esp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+/******************************************************************************/
+/* Public defines ----------------------------------------------------------- */
+/******************************************************************************/
+#define MQTT_QOS0                    (false)
+#define MQTT_QOS1                    (true)
+
+
+/******************************************************************************/
+/* Public functions --------------------------------------------------------- */
+/******************************************************************************/
+bool MQTTClient_Start(void);
+void MQTTClient_Stop(void);
+bool MQTTClient_IsConnected(void);
+bool MQTTClient_Publish(const char *topic, const void *data, uint16_t len, bool ack);
+bool MQTTClient_Send(const char *topic, const void *data, uint16_t len, bool ack, void *arg);
+void MQTTClient_Flush(void);
+void MQTTClient_EspReset(void);
+uint16_t MQTTClient_GetSslBufferSize(void);
+void MQTTClient_GetStat(esp_mqtt_client_stat_t *stat);
+
+
+/******************************************************************************/
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
+#endif /* APP_MQTT_CLIENT_H_ */
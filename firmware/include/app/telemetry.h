@@ -0,0 +1,70 @@
+/**
+ ******************************************************************************
+ * @file           : telemetry.h
+ * @author         : Aleksandr Shabalin    <alexnv97@gmail.com>
+ * @brief          : Header file of telemetry store-and-forward queue
+ ******************************************************************************
+ * ----------------- Copyright (c) 2023 Aleksandr Shabalin ------------------ *
+ ******************************************************************************
+ * This module is a confidential and proprietary property of Aleksandr Shabalin
+ * and possession or use of this module requires written permission
+ * of Aleksandr Shabalin.
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef APP_TELEMETRY_H_
+#define APP_TELEMETRY_H_
+
+
+/******************************************************************************/
+/* Includes ----------------------------------------------------------------- */
+/******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+/******************************************************************************/
+/* Public defines ----------------------------------------------------------- */
+/******************************************************************************/
+#define TELEMETRY_TOPIC_SIZE         (32u)
+#define TELEMETRY_DATA_SIZE          (512u)
+
+
+/******************************************************************************/
+/* Public variables --------------------------------------------------------- */
+/******************************************************************************/
+typedef struct
+{
+  uint32_t ram_count;
+  uint32_t flash_count;
+  uint32_t stored;
+  uint32_t sent;
+  uint32_t expired;
+  uint32_t dropped;
+  uint32_t seq;
+} TELEMETRY_STAT_t;
+
+
+/******************************************************************************/
+/* Public functions --------------------------------------------------------- */
+/******************************************************************************/
+void Telemetry_Init(void);
+bool Telemetry_Store(const char *topic, const void *data, uint16_t len, bool ack);
+void Telemetry_GetStat(TELEMETRY_STAT_t *stat);
+void Telemetry_Published(void *arg, bool ok);
+
+
+/******************************************************************************/
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
+#endif /* APP_TELEMETRY_H_ */
@@ -0,0 +1,62 @@
+/**
+ ******************************************************************************
+ * @file           : time_sync.h
+ * @author         : Aleksandr Shabalin    <alexnv97@gmail.com>
+ * @brief          : Header file of RTC synchronization with SNTP
+ ******************************************************************************
+ * ----------------- Copyright (c) 2023 Aleksandr Shabalin ------------------ *
+ ******************************************************************************
+ * This module is a confidential and proprietary property of Aleksandr Shabalin
+ * and possession or use of this module requires written permission
+ * of Aleksandr Shabalin.
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef APP_TIME_SYNC_H_
+#define APP_TIME_SYNC_H_
+
+
+/******************************************************************************/
+/* Includes ----------------------------------------------------------------- */
+/******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+/******************************************************************************/
+/* Public variables --------------------------------------------------------- */
+/******************************************************************************/
+typedef struct
+{
+  uint32_t syncs;
+  uint32_t interval_s;
+  int32_t offset_ms;
+  int32_t drift_ppb;
+  int8_t aging;
+} TIME_SYNC_STAT_t;
+
+
+/******************************************************************************/
+/* Public functions --------------------------------------------------------- */
+/******************************************************************************/
+void TimeSync_Init(void);
+void TimeSync_Request(void);
+void TimeSync_LoadRtc(void);
+uint32_t TimeSync_GetTime(void);
+void TimeSync_GetStat(TIME_SYNC_STAT_t *stat);
+
+
+/******************************************************************************/
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
+#endif /* APP_TIME_SYNC_H_ */
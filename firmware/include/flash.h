@@ -0,0 +1,56 @@
+/**
+ ******************************************************************************
+ * @file           : flash.h
+ * @author         : Aleksandr Shabalin    <alexnv97@gmail.com>
+ * @brief          : Header file of internal flash driver
+ ******************************************************************************
+ * ----------------- Copyright (c) 2023 Aleksandr Shabalin ------------------ *
+ ******************************************************************************
+ * This module is a confidential and proprietary property of Aleksandr Shabalin
+ * and possession or use of this module requires written permission
+ * of Aleksandr Shabalin.
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef FLASH_H_
+#define FLASH_H_
+
+
+/******************************************************************************/
+/* Includes ----------------------------------------------------------------- */
+/******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+/******************************************************************************/
+/* Public defines ----------------------------------------------------------- */
+/******************************************************************************/
+/* Telemetry log, last two 128 KB sectors, excluded from FLASH region in linker script */
+#define FLASH_LOG_ADDR               (0x080C0000u)
+#define FLASH_LOG_SECTOR             (10u)
+#define FLASH_LOG_SECTORS            (2u)
+#define FLASH_LOG_SECTOR_SIZE        (0x20000u)
+
+
+/******************************************************************************/
+/* Public functions --------------------------------------------------------- */
+/******************************************************************************/
+bool Flash_EraseSector(uint8_t sector);
+bool Flash_Program(uint32_t addr, const uint32_t *data, uint32_t words);
+
+
+/******************************************************************************/
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
+#endif /* FLASH_H_ */
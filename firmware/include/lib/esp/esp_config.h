@@ -38,7 +38,21 @@
  * copy & replace here settings you want to change values
  */
 #define ESP_CFG_OS                          1
-#define ESP_CFG_SYS_PORT                    ESP_SYS_PORT_CMSIS_OS2
+#define ESP_CFG_SYS_PORT                    ESP_SYS_PORT_FREERTOS
+
+#define ESP_CFG_MEM_TLSF                    1
+#define ESP_CFG_MEM_STAT                    1
+#define ESP_CFG_MEM_STAT_TAG                1
+#define ESP_CFG_LOCK_STAT                   1
+
+/* Core state, parser buffer and pools are CPU only, place them to CCMRAM */
+#define ESP_CFG_MEM_CPU_ATTR                __attribute__((section(".ccmram")))
+
+#define ESP_CFG_MEMPOOL_PBUF_NUM            4
+#define ESP_CFG_MEMPOOL_PBUF_SMALL_NUM      8
+#define ESP_CFG_MEMPOOL_MSG_NUM             8
+#define ESP_CFG_MEMPOOL_TIMEOUT_NUM         8
+#define ESP_CFG_MSG_ON_STACK                1
 
 #define ESP_CFG_CONN_MAX_DATA_LEN           2048
 #define ESP_CFG_CONN_MAX_RECV_BUFF_SIZE     1460
@@ -51,6 +65,7 @@
 #define ESP_CFG_DBG                         ESP_DBG_OFF
 
 #define ESP_CFG_INPUT_USE_PROCESS           1
+#define ESP_CFG_SINGLE_THREAD               1
 
 #define ESP_CFG_MAX_SSID_LENGTH             32
 #define ESP_CFG_MAX_PWD_LENGTH              32
@@ -58,7 +73,13 @@
 #define ESP_USE_TX_RX_INTERRUPT             1
 
 #define ESP_CFG_NETCONN                     1
+#define ESP_CFG_NETCONN_PERSIST_TX_BUFF     1
+#define ESP_CFG_ASYNC                       1
+#define ESP_CFG_ASYNC_QUEUE_LEN             32
 #define ESP_CFG_PING                        1
+#define ESP_CFG_SNTP                        1
+#define ESP_CFG_DNS                         1
+#define ESP_CFG_MQTT                        1
 
 /* After user configuration, call default config to merge config together */
 #include "esp/esp_config_default.h"
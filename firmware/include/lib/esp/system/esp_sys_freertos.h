@@ -0,0 +1,104 @@
+/**
+ * \file            esp_sys_freertos.h
+ * \brief           Native FreeRTOS based system file
+ */
+
+/*
+ * Copyright (c) 2023 Tilen MAJERLE
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE
+ * AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of ESP-AT library.
+ *
+ * Author:          Tilen MAJERLE <tilen@majerle.eu>
+ * Version:         $_version_$
+ */
+#ifndef ESP_HDR_SYSTEM_FREERTOS_H
+#define ESP_HDR_SYSTEM_FREERTOS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "esp_config.h"
+
+#if ESP_CFG_OS && !__DOXYGEN__
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+/**
+ * \brief           Binary semaphore based on direct task notification
+ *
+ * Only one task may wait for semaphore at a time.
+ * Semaphore does not need any RTOS object and can be part of message structure
+ */
+typedef struct {
+    TaskHandle_t waiter;                        /*!< Task waiting for semaphore, `NULL` if none */
+    uint8_t cnt;                                /*!< Semaphore count, `0` or `1` */
+    uint8_t valid;                              /*!< Set to `1` when created */
+} esp_sys_sem_t;
+
+typedef SemaphoreHandle_t           esp_sys_mutex_t;
+typedef QueueHandle_t               esp_sys_mbox_t;
+typedef TaskHandle_t                esp_sys_thread_t;
+typedef UBaseType_t                 esp_sys_thread_prio_t;
+#define ESP_SYS_MBOX_NULL           ((esp_sys_mbox_t)0)
+#define ESP_SYS_SEM_NULL            ((esp_sys_sem_t){0})
+#define ESP_SYS_MUTEX_NULL          ((esp_sys_mutex_t)0)
+#define ESP_SYS_TIMEOUT             ((uint32_t)portMAX_DELAY)
+#define ESP_SYS_THREAD_PRIO         (24)    /* Same as osPriorityNormal of CMSIS-OS V2 */
+#define ESP_SYS_THREAD_SS           (512)
+
+/* Task notification index for semaphores, index 0 is used by CMSIS-OS V2 thread flags */
+#ifndef ESP_SYS_NOTIFY_INDEX
+#define ESP_SYS_NOTIFY_INDEX        1
+#endif
+
+/* Number of statically allocated mutexes, others are allocated from RTOS heap */
+#ifndef ESP_SYS_MUTEX_STATIC_NUM
+#define ESP_SYS_MUTEX_STATIC_NUM    4
+#endif
+
+/* Number and length of statically allocated message queues, others are allocated from RTOS heap */
+#ifndef ESP_SYS_MBOX_STATIC_NUM
+#define ESP_SYS_MBOX_STATIC_NUM     2
+#endif
+#ifndef ESP_SYS_MBOX_STATIC_LEN
+#define ESP_SYS_MBOX_STATIC_LEN     16
+#endif
+
+#if ESP_SYS_NOTIFY_INDEX >= configTASK_NOTIFICATION_ARRAY_ENTRIES
+#error "ESP_SYS_NOTIFY_INDEX must be less than configTASK_NOTIFICATION_ARRAY_ENTRIES!"
+#endif
+
+#endif /* ESP_CFG_OS && !__DOXYGEN__ */
+
+#ifdef __cplusplus
+};
+#endif /* __cplusplus */
+
+#endif /* ESP_HDR_SYSTEM_FREERTOS_H */
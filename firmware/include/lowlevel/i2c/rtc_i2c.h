@@ -61,8 +61,12 @@ uint8_t RtcI2cSetMode(RTC_I2C_MODE_t mode);
 
 uint8_t RtcI2cGetDate(RTC_DATE_t *date);
 uint8_t RtcI2cGetTime(RTC_TIME_t *time);
+uint8_t RtcI2cGetDateTime(RTC_DATE_t *date, RTC_TIME_t *time);
 uint8_t RtcI2cSetDate(RTC_DATE_t *date);
 uint8_t RtcI2cSetTime(RTC_TIME_t *time);
+uint8_t RtcI2cSetDateTime(RTC_DATE_t *date, RTC_TIME_t *time);
+uint8_t RtcI2cGetAging(int8_t *aging);
+uint8_t RtcI2cSetAging(int8_t aging);
 
 
 /******************************************************************************/
@@ -0,0 +1,73 @@
+/**
+ ******************************************************************************
+ * @file           : mem_layout.h
+ * @author         : Aleksandr Shabalin    <alexnv97@gmail.com>
+ * @brief          : Memory placement helpers (RAM / CCMRAM)
+ ******************************************************************************
+ * ----------------- Copyright (c) 2023 Aleksandr Shabalin ------------------ *
+ ******************************************************************************
+ * This module is a confidential and proprietary property of Aleksandr Shabalin
+ * and possession or use of this module requires written permission
+ * of Aleksandr Shabalin.
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef MEM_LAYOUT_H_
+#define MEM_LAYOUT_H_
+
+
+/******************************************************************************/
+/* Includes ----------------------------------------------------------------- */
+/******************************************************************************/
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+/******************************************************************************/
+/* Public defines ----------------------------------------------------------- */
+/******************************************************************************/
+/**
+ * \brief           Place variable to 64 KB core-coupled memory (CCMRAM)
+ *
+ * CCMRAM is connected to D-bus only: DMA can not access it,
+ * so DMA buffers must stay in RAM. CPU access to CCMRAM does not
+ * contend with DMA transfers on bus matrix.
+ *
+ * \note            CCMRAM is cleared at start of main, initial values are not
+ *                  copied. Use only for zero-initialized variables
+ */
+#define MEM_CCMRAM                  __attribute__((section(".ccmram")))
+
+/**
+ * \brief           Define stack and control block in CCMRAM for CMSIS-RTOS2 thread
+ * \param[in]       name: Thread name prefix for generated variables
+ * \param[in]       size: Stack size in bytes
+ */
+#define MEM_CCMRAM_THREAD(name, size)                                         \
+  static uint64_t name##_stack[(size) / sizeof(uint64_t)] MEM_CCMRAM;         \
+  static StaticTask_t name##_cb MEM_CCMRAM
+
+/**
+ * \brief           Thread attributes for memory defined with @ref MEM_CCMRAM_THREAD
+ * \param[in]       name: Thread name prefix used with @ref MEM_CCMRAM_THREAD
+ */
+#define MEM_CCMRAM_THREAD_ATTR(name)                                          \
+  .cb_mem = &name##_cb,                                                       \
+  .cb_size = sizeof(name##_cb),                                               \
+  .stack_mem = name##_stack,                                                  \
+  .stack_size = sizeof(name##_stack)
+
+
+/******************************************************************************/
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
+#endif /* MEM_LAYOUT_H_ */
@@ -69,6 +69,8 @@ extern "C" {
 #define RTC_REGS_SRAM_LENGTH       (0xFF - 0x14)
 #define RTC_REGS_SRAM_END          (0xFF)
 
+#define RTC_CONTROL_CONV           (0x20)
+
 #define ADDR_WORD                  (true)
 #define ADDR_BYTE                  (false)
 
@@ -63,7 +63,7 @@
 #define configUSE_PREEMPTION                     1
 #define configUSE_TIME_SLICING                   1
 
-#define configSUPPORT_STATIC_ALLOCATION          0
+#define configSUPPORT_STATIC_ALLOCATION          1
 #define configSUPPORT_DYNAMIC_ALLOCATION         1
 #define configUSE_IDLE_HOOK                      0
 #define configUSE_TICK_HOOK                      0
@@ -78,6 +78,7 @@
 #define configUSE_MUTEXES                        1
 #define configQUEUE_REGISTRY_SIZE                40
 #define configUSE_RECURSIVE_MUTEXES              1
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES    2
 #define configUSE_COUNTING_SEMAPHORES            1
 #define configUSE_PORT_OPTIMISED_TASK_SELECTION  0
 /* USER CODE BEGIN MESSAGE_BUFFER_LENGTH_TYPE */
@@ -54,6 +54,7 @@
 #include "console.h"
 #include "dma.h"
 #include "indication.h"
+#include "mem_layout.h"
 
 
 /******************************************************************************/
@@ -79,8 +80,10 @@
 /******************************************************************************/
 /* Private variables -------------------------------------------------------- */
 /******************************************************************************/
+#if !ESP_CFG_SINGLE_THREAD
 static osThreadId_t usart_ll_thread_id;
 static osMessageQueueId_t usart_ll_mbox_id;
+#endif /* !ESP_CFG_SINGLE_THREAD */
 
 const osSemaphoreAttr_t esptxSemaphore_attr =
 {
@@ -100,19 +103,48 @@ const osMutexAttr_t esptxMutex_attr =
 
 
 static uint8_t initialized, is_running;
-static uint8_t usart_mem[ESP_USART_DMA_RX_BUFF_SIZE];
+static uint8_t usart_mem[ESP_USART_DMA_RX_BUFF_SIZE];  /* DMA target, must stay in RAM */
 static size_t old_pos;
 
 /******************************************************************************/
 
 
 /**
- * \brief           USART data processing
+ * \brief           Pass new data from DMA ring buffer to ESP stack
  */
-static void usart_ll_thread(void* arg)
+static void usart_ll_read(void)
 {
   size_t pos;
 
+  if (esp8266_update)
+    return;
+
+  /* Read data */
+  pos = sizeof(usart_mem) - LL_DMA_GetDataLength(DMA1, LL_DMA_STREAM_0);
+
+  if (pos != old_pos && is_running) {
+    if (pos > old_pos)
+    {
+      esp_input_process(&usart_mem[old_pos], pos - old_pos);
+    }
+    else
+    {
+      esp_input_process(&usart_mem[old_pos], sizeof(usart_mem) - old_pos);
+      if (pos > 0)
+      {
+        esp_input_process(&usart_mem[0], pos);
+      }
+    }
+    old_pos = pos;
+  }
+}
+
+#if !ESP_CFG_SINGLE_THREAD
+/**
+ * \brief           USART data processing
+ */
+static void usart_ll_thread(void* arg)
+{
   ESP_UNUSED(arg);
 
   for (;;)
@@ -125,25 +157,26 @@ static void usart_ll_thread(void* arg)
     /* Wait for the event message from DMA or USART */
     osMessageQueueGet(usart_ll_mbox_id, &d, NULL, osWaitForever);
 
-    /* Read data */
-    pos = sizeof(usart_mem) - LL_DMA_GetDataLength(DMA1, LL_DMA_STREAM_0);
+    usart_ll_read();
+  }
+}
+#endif /* !ESP_CFG_SINGLE_THREAD */
 
-    if (pos != old_pos && is_running) {
-      if (pos > old_pos)
-      {
-        esp_input_process(&usart_mem[old_pos], pos - old_pos);
-      }
-      else
-      {
-        esp_input_process(&usart_mem[old_pos], sizeof(usart_mem) - old_pos);
-        if (pos > 0)
-        {
-          esp_input_process(&usart_mem[0], pos);
-        }
-      }
-      old_pos = pos;
-    }
+/**
+ * \brief           Notify reader about DMA or USART receive event
+ * \note            Called from interrupt context
+ */
+static void usart_ll_notify(void)
+{
+#if ESP_CFG_SINGLE_THREAD
+  esp_input_notify();
+#else
+  if (usart_ll_mbox_id != NULL)
+  {
+    void* d = (void*)1;
+    osMessageQueuePut(usart_ll_mbox_id, &d, 0, 0);
   }
+#endif /* ESP_CFG_SINGLE_THREAD */
 }
 
 
@@ -261,6 +294,7 @@ void configure_uart(uint32_t baudrate)
     LL_USART_Enable(UART5);
   }
 
+#if !ESP_CFG_SINGLE_THREAD
   if (usart_ll_mbox_id == NULL)
   {
     usart_ll_mbox_id = osMessageQueueNew(10, sizeof(void*), NULL);
@@ -270,6 +304,7 @@ void configure_uart(uint32_t baudrate)
     const osThreadAttr_t attr = {.stack_size = 1024};
     usart_ll_thread_id = osThreadNew(usart_ll_thread, usart_ll_mbox_id, &attr);
   }
+#endif /* !ESP_CFG_SINGLE_THREAD */
 
 /*
  * Force ESP hardware reset
@@ -317,8 +352,10 @@ static size_t send_data(const void* data, size_t len)
 espr_t
 esp_ll_init(esp_ll_t* ll)
 {
-    static uint8_t memory[0x6000];
+    static uint8_t memory_ccm[0x5000] MEM_CCMRAM;
+    static uint8_t memory[0x2000];
     esp_mem_region_t mem_regions[] = {
+        {memory_ccm, sizeof(memory_ccm)},       /* CCMRAM is below RAM, regions must be in ascending order */
         {memory, sizeof(memory)}
     };
 
@@ -328,6 +365,9 @@ esp_ll_init(esp_ll_t* ll)
 
     if (!initialized) {
         ll->send_fn = send_data;                /* Set callback function to send data */
+#if ESP_CFG_SINGLE_THREAD
+        ll->recv_fn = usart_ll_read;            /* Received data are read from stack thread */
+#endif /* ESP_CFG_SINGLE_THREAD */
     }
 
     configure_uart(ll->uart.baudrate);          /* Initialize UART for communication */
@@ -343,6 +383,7 @@ esp_ll_init(esp_ll_t* ll)
 espr_t
 esp_ll_deinit(esp_ll_t* ll)
 {
+#if !ESP_CFG_SINGLE_THREAD
   if (usart_ll_mbox_id != NULL) {
       osMessageQueueId_t tmp = usart_ll_mbox_id;
       usart_ll_mbox_id = NULL;
@@ -353,6 +394,7 @@ esp_ll_deinit(esp_ll_t* ll)
       usart_ll_thread_id = NULL;
       osThreadTerminate(tmp);
   }
+#endif /* !ESP_CFG_SINGLE_THREAD */
   initialized = 0;                    /* Clear initialized flag */
   PROJ_UNUSED(ll);
   return espOK;
@@ -376,11 +418,7 @@ void UART5_IRQHandler(void)
   }
   else
   {
-    if (usart_ll_mbox_id != NULL)
-    {
-      void* d = (void*)1;
-      osMessageQueuePut(usart_ll_mbox_id, &d, 0, 0);
-    }
+    usart_ll_notify();
   }
 }
 
@@ -399,11 +437,7 @@ void DMA1_Stream0_IRQHandler(void)
   }
   else
   {
-    if (usart_ll_mbox_id != NULL)
-    {
-      void* d = (void*)1;
-      osMessageQueuePut(usart_ll_mbox_id, &d, 0, 0);
-    }
+    usart_ll_notify();
   }
 }
 
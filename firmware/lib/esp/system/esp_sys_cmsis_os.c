@@ -48,7 +48,7 @@ esp_sys_now(void) {
     return osKernelSysTick();
 }
 
-#if ESP_CFG_OS
+#if ESP_CFG_OS && ESP_CFG_SYS_PORT == ESP_SYS_PORT_CMSIS_OS
 
 uint8_t
 esp_sys_protect(void) {
@@ -218,5 +218,10 @@ esp_sys_thread_yield(void) {
     return 1;
 }
 
-#endif /* ESP_CFG_OS */
+esp_sys_thread_t
+esp_sys_thread_get_id(void) {
+    return osThreadGetId();
+}
+
+#endif /* ESP_CFG_OS && ESP_CFG_SYS_PORT == ESP_SYS_PORT_CMSIS_OS */
 #endif /* !__DOXYGEN__ */
@@ -33,7 +33,7 @@
 #include "esp/system/esp_sys.h"
 #include "cmsis_os.h"
 
-#if !__DOXYGEN__
+#if ESP_CFG_SYS_PORT == ESP_SYS_PORT_CMSIS_OS2 && !__DOXYGEN__
 
 static osMutexId_t sys_mutex;
 
@@ -212,4 +212,9 @@ esp_sys_thread_yield(void) {
     return 1;
 }
 
-#endif /* !__DOXYGEN__ */
+esp_sys_thread_t
+esp_sys_thread_get_id(void) {
+    return osThreadGetId();
+}
+
+#endif /* ESP_CFG_SYS_PORT == ESP_SYS_PORT_CMSIS_OS2 && !__DOXYGEN__ */
@@ -30,24 +30,62 @@
  * Author:          Adrian Carpenter (FreeRTOS port)
  * Version:         v1.1.2-dev
  */
-#include "FreeRTOS.h"
-#include "semphr.h"
 #include "esp/system/esp_sys.h"
-#include "task.h"
+#include "esp/esp_utils.h"
 
-#if !__DOXYGEN__
+#if ESP_CFG_SYS_PORT == ESP_SYS_PORT_FREERTOS && !__DOXYGEN__
 
-/* Mutex ID for main protection */
-static SemaphoreHandle_t sys_mutex;
+/* Mutex for main protection */
+static esp_sys_mutex_t sys_mutex;
 
-typedef struct {
-    void* d;
-} freertos_mbox_t;
+/* Statically allocated objects, used before falling back to RTOS heap */
+static StaticSemaphore_t mutex_static[ESP_SYS_MUTEX_STATIC_NUM + 1];    /* One more for main protection */
+static uint8_t mutex_static_used[ESP_SYS_MUTEX_STATIC_NUM + 1];
+static StaticQueue_t mbox_static[ESP_SYS_MBOX_STATIC_NUM];
+static uint8_t mbox_static_used[ESP_SYS_MBOX_STATIC_NUM];
+static void* mbox_static_data[ESP_SYS_MBOX_STATIC_NUM][ESP_SYS_MBOX_STATIC_LEN];
+
+/**
+ * \brief           Convert timeout in milliseconds to ticks, `0` means wait forever
+ */
+#define TIMEOUT_TO_TICKS(ms)        ((ms) == 0 ? portMAX_DELAY : pdMS_TO_TICKS(ms))
+
+/**
+ * \brief           Reserve free static storage entry
+ * \param[in]       used: Array of used flags
+ * \param[in]       num: Number of entries
+ * \return          Entry index or `num` when all are used
+ */
+static size_t
+static_alloc(uint8_t* used, size_t num) {
+    size_t i;
+
+    taskENTER_CRITICAL();
+    for (i = 0; i < num && used[i]; ++i) {}
+    if (i < num) {
+        used[i] = 1;
+    }
+    taskEXIT_CRITICAL();
+    return i;
+}
+
+/**
+ * \brief           Release static storage entry if handle points to it
+ * \param[in]       h: Object handle, equal to address of static storage
+ * \param[in]       arr: Static storage array
+ * \param[in]       used: Array of used flags
+ */
+#define STATIC_FREE(h, arr, used)   do {                        \
+    const uint8_t* ptr = (const uint8_t *)(h);                  \
+    const uint8_t* start = (const uint8_t *)&(arr)[0];          \
+    if (ptr >= start && ptr < (const uint8_t *)&(arr)[ESP_ARRAYSIZE(arr)]) {    \
+        (used)[(size_t)(ptr - start) / sizeof((arr)[0])] = 0;   \
+    }                                                           \
+} while (0)
 
 uint8_t
 esp_sys_init(void) {
-    sys_mutex = xSemaphoreCreateMutex();
-    return sys_mutex == NULL ? 0 : 1;
+    return esp_sys_mutex_create(&sys_mutex);
 }
 
 uint32_t
@@ -69,13 +107,22 @@ esp_sys_unprotect(void) {
 
 uint8_t
 esp_sys_mutex_create(esp_sys_mutex_t* p) {
-    *p = xSemaphoreCreateRecursiveMutex();
+    size_t i = static_alloc(mutex_static_used, ESP_ARRAYSIZE(mutex_static));
+
+    *p = NULL;
+    if (i < ESP_ARRAYSIZE(mutex_static)) {
+        *p = xSemaphoreCreateRecursiveMutexStatic(&mutex_static[i]);
+    }
+    if (*p == NULL) {
+        *p = xSemaphoreCreateRecursiveMutex();
+    }
     return *p != NULL;
 }
 
 uint8_t
 esp_sys_mutex_delete(esp_sys_mutex_t* p) {
     vSemaphoreDelete(*p);
+    STATIC_FREE(*p, mutex_static, mutex_static_used);
     return 1;
 }
 
@@ -102,36 +149,64 @@ esp_sys_mutex_invalid(esp_sys_mutex_t* p) {
 
 uint8_t
 esp_sys_sem_create(esp_sys_sem_t* p, uint8_t cnt) {
-    *p = xSemaphoreCreateBinary();
-
-    if (*p != NULL && cnt) {
-        xSemaphoreGive(*p);
-    }
-    return *p != NULL;
+    p->waiter = NULL;
+    p->cnt = cnt > 0;
+    p->valid = 1;
+    return 1;
 }
 
 uint8_t
 esp_sys_sem_delete(esp_sys_sem_t* p) {
-    vSemaphoreDelete(*p);
+    p->valid = 0;
     return 1;
 }
 
 uint32_t
 esp_sys_sem_wait(esp_sys_sem_t* p, uint32_t timeout) {
-    uint32_t t = xTaskGetTickCount();
-    return xSemaphoreTake(*p, !timeout ? portMAX_DELAY : pdMS_TO_TICKS(timeout)) == pdPASS
-               ? ((xTaskGetTickCount() - t) * portTICK_PERIOD_MS)
-               : ESP_SYS_TIMEOUT;
+    TickType_t t = xTaskGetTickCount();
+    uint32_t res;
+
+    taskENTER_CRITICAL();
+    if (p->cnt) {
+        p->cnt = 0;
+        taskEXIT_CRITICAL();
+        return 0;
+    }
+    p->waiter = xTaskGetCurrentTaskHandle();
+    taskEXIT_CRITICAL();
+
+    res = ulTaskNotifyTakeIndexed(ESP_SYS_NOTIFY_INDEX, pdTRUE, TIMEOUT_TO_TICKS(timeout));
+
+    /*
+     * Release clears waiter and notifies in the same critical section.
+     * When waiter is already cleared after timeout, notification is pending
+     * and must be consumed to not wake up next wait of this task
+     */
+    taskENTER_CRITICAL();
+    if (!res && p->waiter == NULL) {
+        res = ulTaskNotifyTakeIndexed(ESP_SYS_NOTIFY_INDEX, pdTRUE, 0);
+    }
+    p->waiter = NULL;
+    taskEXIT_CRITICAL();
+    return res ? ((xTaskGetTickCount() - t) * portTICK_PERIOD_MS) : ESP_SYS_TIMEOUT;
 }
 
 uint8_t
 esp_sys_sem_release(esp_sys_sem_t* p) {
-    return xSemaphoreGive(*p) == pdPASS;
+    taskENTER_CRITICAL();
+    if (p->waiter != NULL) {
+        xTaskNotifyGiveIndexed(p->waiter, ESP_SYS_NOTIFY_INDEX);    /* Context switch is pended until critical section ends */
+        p->waiter = NULL;
+    } else {
+        p->cnt = 1;
+    }
+    taskEXIT_CRITICAL();
+    return 1;
 }
 
 uint8_t
 esp_sys_sem_isvalid(esp_sys_sem_t* p) {
-    return p != NULL && *p != NULL;
+    return p != NULL && p->valid;
 }
 
 uint8_t
@@ -142,7 +217,18 @@ esp_sys_sem_invalid(esp_sys_sem_t* p) {
 
 uint8_t
 esp_sys_mbox_create(esp_sys_mbox_t* b, size_t size) {
-    *b = xQueueCreate(size, sizeof(freertos_mbox_t));
+    size_t i = ESP_ARRAYSIZE(mbox_static);
+
+    *b = NULL;
+    if (size <= ESP_SYS_MBOX_STATIC_LEN) {
+        i = static_alloc(mbox_static_used, ESP_ARRAYSIZE(mbox_static));
+    }
+    if (i < ESP_ARRAYSIZE(mbox_static)) {
+        *b = xQueueCreateStatic(size, sizeof(void*), (uint8_t *)mbox_static_data[i], &mbox_static[i]);
+    }
+    if (*b == NULL) {
+        *b = xQueueCreate(size, sizeof(void*));
+    }
     return *b != NULL;
 }
 
@@ -152,26 +238,23 @@ esp_sys_mbox_delete(esp_sys_mbox_t* b) {
         return 0;
     }
     vQueueDelete(*b);
+    STATIC_FREE(*b, mbox_static, mbox_static_used);
     return 1;
 }
 
 uint32_t
 esp_sys_mbox_put(esp_sys_mbox_t* b, void* m) {
-    freertos_mbox_t mb;
-    uint32_t t = xTaskGetTickCount();
+    TickType_t t = xTaskGetTickCount();
 
-    mb.d = m;
-    xQueueSend(*b, &mb, portMAX_DELAY);
-    return xTaskGetTickCount() - t;
+    xQueueSend(*b, &m, portMAX_DELAY);
+    return (xTaskGetTickCount() - t) * portTICK_PERIOD_MS;
 }
 
 uint32_t
 esp_sys_mbox_get(esp_sys_mbox_t* b, void** m, uint32_t timeout) {
-    freertos_mbox_t mb;
-    uint32_t t = xTaskGetTickCount();
+    TickType_t t = xTaskGetTickCount();
 
-    if (xQueueReceive(*b, &mb, !timeout ? portMAX_DELAY : pdMS_TO_TICKS(timeout))) {
-        *m = mb.d;
+    if (xQueueReceive(*b, m, TIMEOUT_TO_TICKS(timeout)) == pdPASS) {
         return (xTaskGetTickCount() - t) * portTICK_PERIOD_MS;
     }
     return ESP_SYS_TIMEOUT;
@@ -179,21 +262,21 @@ esp_sys_mbox_get(esp_sys_mbox_t* b, void** m, uint32_t timeout) {
 
 uint8_t
 esp_sys_mbox_putnow(esp_sys_mbox_t* b, void* m) {
-    freertos_mbox_t mb;
+    BaseType_t woken = pdFALSE;
 
-    mb.d = m;
-    return xQueueSendFromISR(*b, &mb, 0) == pdPASS;
+    if (xPortIsInsideInterrupt()) {             /* Receive notification from interrupt */
+        if (xQueueSendFromISR(*b, &m, &woken) != pdPASS) {
+            return 0;
+        }
+        portYIELD_FROM_ISR(woken);
+        return 1;
+    }
+    return xQueueSend(*b, &m, 0) == pdPASS;
 }
 
 uint8_t
 esp_sys_mbox_getnow(esp_sys_mbox_t* b, void** m) {
-    freertos_mbox_t mb;
-
-    if (xQueueReceive(*b, &mb, 0)) {
-        *m = mb.d;
-        return 1;
-    }
-    return 0;
+    return xQueueReceive(*b, m, 0) == pdPASS;
 }
 
 uint8_t
@@ -210,12 +293,21 @@ esp_sys_mbox_invalid(esp_sys_mbox_t* b) {
 uint8_t
 esp_sys_thread_create(esp_sys_thread_t* t, const char* name, esp_sys_thread_fn thread_func, void* const arg,
                         size_t stack_size, esp_sys_thread_prio_t prio) {
-    return xTaskCreate(thread_func, name, stack_size / sizeof(portSTACK_TYPE), arg, prio, t) == pdPASS ? 1 : 0;
+    TaskHandle_t id;
+
+    if (xTaskCreate(thread_func, name, (stack_size > 0 ? stack_size : ESP_SYS_THREAD_SS) / sizeof(StackType_t),
+                    arg, prio, &id) != pdPASS) {
+        return 0;
+    }
+    if (t != NULL) {
+        *t = id;
+    }
+    return 1;
 }
 
 uint8_t
 esp_sys_thread_terminate(esp_sys_thread_t* t) {
-    vTaskDelete(*t);
+    vTaskDelete(t != NULL ? *t : NULL);
     return 1;
 }
 
@@ -225,4 +317,9 @@ esp_sys_thread_yield(void) {
     return 1;
 }
 
-#endif /* !__DOXYGEN__ */
+esp_sys_thread_t
+esp_sys_thread_get_id(void) {
+    return xTaskGetCurrentTaskHandle();
+}
+
+#endif /* ESP_CFG_SYS_PORT == ESP_SYS_PORT_FREERTOS && !__DOXYGEN__ */
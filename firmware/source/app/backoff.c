@@ -0,0 +1,146 @@
+/**
+ ******************************************************************************
+ * @file           : backoff.c
+ * @author         : Aleksandr Shabalin       <alexnv97@gmail.com>
+ * @brief          : Retry backoff with exponential delay and jitter
+ ******************************************************************************
+ * ----------------- Copyright (c) 2023 Aleksandr Shabalin------------------- *
+ ******************************************************************************
+ ******************************************************************************
+ */
+
+
+/******************************************************************************/
+/* Includes ----------------------------------------------------------------- */
+/******************************************************************************/
+#include "backoff.h"
+
+
+/******************************************************************************/
+/* Private variables -------------------------------------------------------- */
+/******************************************************************************/
+static uint32_t backoff_seed;
+
+
+/******************************************************************************/
+
+
+/**
+ * @brief          Pseudo-random number for jitter, retries of different devices
+ *                 after common outage are spread in time
+ * @retval         uint32_t: Random value
+ */
+static uint32_t prvBackoffRandom(void)
+{
+  uint32_t x = backoff_seed;
+
+  if (x == 0)
+    x = osKernelGetTickCount() | 1u;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  backoff_seed = x;
+
+  return x;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Initialize backoff
+ * @param[in]      backoff: Backoff state
+ * @param[in]      min_ms: Delay before first retry
+ * @param[in]      max_ms: Maximal delay between retries
+ */
+void Backoff_Init(BACKOFF_t *backoff, uint32_t min_ms, uint32_t max_ms)
+{
+  backoff->min_ms = min_ms;
+  backoff->max_ms = max_ms;
+  backoff->waiter = NULL;
+  Backoff_Reset(backoff);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Start again from minimal delay, call after successful step
+ * @param[in]      backoff: Backoff state
+ */
+void Backoff_Reset(BACKOFF_t *backoff)
+{
+  backoff->delay_ms = backoff->min_ms;
+  backoff->attempts = 0;
+  backoff->kicked = false;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Get delay before next retry and double it up to maximum
+ * @param[in]      backoff: Backoff state
+ * @retval         uint32_t: Delay in milliseconds, randomized to 50..100% of current step
+ */
+uint32_t Backoff_Next(BACKOFF_t *backoff)
+{
+  uint32_t delay = backoff->delay_ms;
+
+  backoff->attempts++;
+  backoff->delay_ms = delay > backoff->max_ms / 2 ? backoff->max_ms : delay * 2;
+
+  return delay / 2 + prvBackoffRandom() % (delay / 2 + 1);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Wait before next retry
+ * @param[in]      backoff: Backoff state
+ * @retval         bool: 'true' if wait was cut short by @ref Backoff_Kick
+ */
+bool Backoff_Wait(BACKOFF_t *backoff)
+{
+  uint32_t delay = Backoff_Next(backoff);
+  bool kicked;
+
+  backoff->waiter = osThreadGetId();
+
+  /* Kick before this point leaves flag set, so wait returns immediately */
+  if (!backoff->kicked)
+    osThreadFlagsWait(BACKOFF_FLAG_KICK, osFlagsWaitAny, delay);
+
+  backoff->waiter = NULL;
+  osThreadFlagsClear(BACKOFF_FLAG_KICK);
+
+  kicked = backoff->kicked;
+  backoff->kicked = false;
+
+  return kicked;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Retry immediately, e.g. when event shows that link may be back
+ * @param[in]      backoff: Backoff state
+ * @note           Can be called from any thread
+ */
+void Backoff_Kick(BACKOFF_t *backoff)
+{
+  osThreadId_t waiter = backoff->waiter;
+
+  backoff->kicked = true;
+  if (waiter != NULL)
+    osThreadFlagsSet(waiter, BACKOFF_FLAG_KICK);
+}
+/******************************************************************************/
@@ -49,7 +49,11 @@ ESS_CONFIG init_config = {
     .wifi = {
         .enabled = true,
         .ssid = {"ssid"},
-        .passw = {"passw"}
+        .passw = {"passw"},
+        .fast_join = true,
+        .fast_static_ip = false,
+        .net_check_s = 60,
+        .channel = 0
     },
     .mqtt = {
       .pin   = 10001,
@@ -58,7 +62,10 @@ ESS_CONFIG init_config = {
       .login = {""},
       .passw = {""},
       .port  = 61000,
-      .data_publish_timeout_s = 5
+      .data_publish_timeout_s = 5,
+      .tls = false,
+      .tls_auth = 2,
+      .tls_buf_size = 4096
     }
 };
 
@@ -72,6 +79,9 @@ CONFIG_DESCRIPTIONS config_description[] =
     {&config.wifi.enabled,                    CONFIG_RECORD_TYPE_BOOL,     CONFIG_RECORD_GROUP_WIFI,         0x00, "wifi.enabled"       ,  {.bool_t      = {}}},
     {&config.wifi.ssid,                       CONFIG_RECORD_TYPE_STRING,   CONFIG_RECORD_GROUP_WIFI,         0x00, "wifi.ssid"          ,  {.string_t    = {31}}},
     {&config.wifi.passw,                      CONFIG_RECORD_TYPE_STRING,   CONFIG_RECORD_GROUP_WIFI,         0x00, "wifi.passw"         ,  {.string_t    = {31}}},
+    {&config.wifi.fast_join,                  CONFIG_RECORD_TYPE_BOOL,     CONFIG_RECORD_GROUP_WIFI,         0x00, "wifi.fast_join"     ,  {.bool_t      = {}}},
+    {&config.wifi.fast_static_ip,             CONFIG_RECORD_TYPE_BOOL,     CONFIG_RECORD_GROUP_WIFI,         0x00, "wifi.fast_ip"       ,  {.bool_t      = {}}},
+    {&config.wifi.net_check_s,                CONFIG_RECORD_TYPE_U16,      CONFIG_RECORD_GROUP_WIFI,         0x00, "wifi.net_check_s"   ,  {.uint16_t    = {10, 3600}}},
     {&config.mqtt.pin,                        CONFIG_RECORD_TYPE_U32,      CONFIG_RECORD_GROUP_MQTT,         0x00, "mqtt.pin"           ,  {.uint32_t    = {10001, 99999}}},
     {&config.mqtt.local,                      CONFIG_RECORD_TYPE_STRING,   CONFIG_RECORD_GROUP_MQTT,         0x00, "mqtt.local"         ,  {.string_t    = {31}}},
     {&config.mqtt.host,                       CONFIG_RECORD_TYPE_STRING,   CONFIG_RECORD_GROUP_MQTT,         0x00, "mqtt.host"          ,  {.string_t    = {31}}},
@@ -79,6 +89,9 @@ CONFIG_DESCRIPTIONS config_description[] =
     {&config.mqtt.login,                      CONFIG_RECORD_TYPE_STRING,   CONFIG_RECORD_GROUP_MQTT,         0x00, "mqtt.login"         ,  {.string_t    = {15}}},
     {&config.mqtt.passw,                      CONFIG_RECORD_TYPE_STRING,   CONFIG_RECORD_GROUP_MQTT,         0x00, "mqtt.passw"         ,  {.string_t    = {15}}},
     {&config.mqtt.data_publish_timeout_s,     CONFIG_RECORD_TYPE_U8,       CONFIG_RECORD_GROUP_MQTT,         0x00, "mqtt.publish_s"     ,  {.uint8_t     = {5, 250}}},
+    {&config.mqtt.tls,                        CONFIG_RECORD_TYPE_BOOL,     CONFIG_RECORD_GROUP_MQTT,         0x00, "mqtt.tls"           ,  {.bool_t      = {}}},
+    {&config.mqtt.tls_auth,                   CONFIG_RECORD_TYPE_U8,       CONFIG_RECORD_GROUP_MQTT,         0x00, "mqtt.tls_auth"      ,  {.uint8_t     = {0, 3}}},
+    {&config.mqtt.tls_buf_size,               CONFIG_RECORD_TYPE_U16,      CONFIG_RECORD_GROUP_MQTT,         0x00, "mqtt.tls_buf"       ,  {.uint16_t    = {2048, 4096}}},
 };
 
 CONFIG_INIT_RESULT init_result;
@@ -0,0 +1,268 @@
+/**
+ ******************************************************************************
+ * @file           : dns_cache.c
+ * @author         : Aleksandr Shabalin       <alexnv97@gmail.com>
+ * @brief          : Cache of host name resolution results
+ ******************************************************************************
+ * ----------------- Copyright (c) 2023 Aleksandr Shabalin------------------- *
+ ******************************************************************************
+ ******************************************************************************
+ *
+ * ESP AT firmware does not report record TTL, cached address is used for
+ * fixed time and resolved again after it. When DNS server does not answer,
+ * the last address resolved is used, so reconnect does not depend on DNS.
+ */
+
+
+/******************************************************************************/
+/* Includes ----------------------------------------------------------------- */
+/******************************************************************************/
+#include "dns_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cmsis_os2.h"
+
+#include "esp/esp.h"
+#include "esp/esp_dns.h"
+
+#include "log.h"
+
+
+/******************************************************************************/
+/* Private defines ---------------------------------------------------------- */
+/******************************************************************************/
+#define DNS_CACHE_ENTRIES            (4u)
+#define DNS_CACHE_HOST_SIZE          (32u)
+#define DNS_CACHE_TTL_MS             (3600u * 1000u)
+
+
+/******************************************************************************/
+/* Private variables -------------------------------------------------------- */
+/******************************************************************************/
+typedef struct
+{
+  char host[DNS_CACHE_HOST_SIZE];
+  esp_ip_t ip;
+  uint32_t resolved_tick;
+  uint32_t used_tick;
+  bool fresh;
+} DNS_CACHE_ENTRY_t;
+
+const osMutexAttr_t DNSCacheMutex_attr =
+{
+  .name = "DNSCacheMutex",
+  .attr_bits = osMutexRecursive,
+  .cb_mem = NULL,
+  .cb_size = 0U
+};
+
+static osMutexId_t dns_cache_mutex;
+static DNS_CACHE_ENTRY_t dns_cache[DNS_CACHE_ENTRIES];
+static DNS_CACHE_STAT_t dns_cache_stat;
+
+
+/******************************************************************************/
+/* Private function prototypes ---------------------------------------------- */
+/******************************************************************************/
+static DNS_CACHE_ENTRY_t *prvDNSCacheFind(const char *host);
+static DNS_CACHE_ENTRY_t *prvDNSCacheAlloc(const char *host);
+static bool prvDNSCacheIsIp(const char *host);
+
+
+/******************************************************************************/
+
+
+/**
+ * @brief          Resolve host name to IP address
+ * @param[in]      host: Host name or dotted IPv4 address
+ * @param[out]     ip: Output buffer for dotted IPv4 address
+ * @param[in]      size: Output buffer size, at least @ref DNS_CACHE_IP_STR_SIZE
+ * @retval         bool: 'true' if address is known
+ *
+ * Blocks calling thread while ESP resolves host name.
+ */
+bool DNSCache_Resolve(const char *host, char *ip, size_t size)
+{
+  DNS_CACHE_ENTRY_t *entry;
+  esp_ip_t resolved;
+  espr_t res;
+
+  if (prvDNSCacheIsIp(host))
+  {
+    snprintf(ip, size, "%s", host);
+    return true;
+  }
+
+  if (strlen(host) >= DNS_CACHE_HOST_SIZE)
+    return false;
+
+  if (dns_cache_mutex == NULL)
+  {
+    dns_cache_mutex = osMutexNew(&DNSCacheMutex_attr);
+    if (dns_cache_mutex == NULL)
+      return false;
+  }
+
+  osMutexAcquire(dns_cache_mutex, osWaitForever);
+
+  entry = prvDNSCacheFind(host);
+
+  if (entry != NULL && entry->fresh && osKernelGetTickCount() - entry->resolved_tick < DNS_CACHE_TTL_MS)
+  {
+    dns_cache_stat.hits++;
+  }
+  else
+  {
+    dns_cache_stat.lookups++;
+    res = esp_dns_gethostbyname(host, &resolved, NULL, NULL, 1);
+
+    if (res == espOK)
+    {
+      if (entry == NULL)
+        entry = prvDNSCacheAlloc(host);
+
+      entry->ip = resolved;
+      entry->resolved_tick = osKernelGetTickCount();
+      entry->fresh = true;
+    }
+    else if (entry != NULL)
+    {
+      dns_cache_stat.fallbacks++;
+      PrintfLogsCRLF(CLR_YL"DNS lookup of %s FAIL! (%d), using last known address"CLR_DEF, host, (int)res);
+    }
+    else
+    {
+      dns_cache_stat.failures++;
+      PrintfLogsCRLF(CLR_RD"DNS lookup of %s FAIL! (%d)"CLR_DEF, host, (int)res);
+    }
+  }
+
+  if (entry != NULL)
+  {
+    entry->used_tick = osKernelGetTickCount();
+    snprintf(ip, size, "%u.%u.%u.%u", (unsigned)entry->ip.ip[0], (unsigned)entry->ip.ip[1],
+             (unsigned)entry->ip.ip[2], (unsigned)entry->ip.ip[3]);
+  }
+
+  osMutexRelease(dns_cache_mutex);
+
+  return entry != NULL;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Resolve host again on next use, e.g. after connection to it failed
+ * @param[in]      host: Host name
+ *
+ * Address is kept as fallback in case DNS server does not answer.
+ */
+void DNSCache_Invalidate(const char *host)
+{
+  DNS_CACHE_ENTRY_t *entry;
+
+  if (dns_cache_mutex == NULL)
+    return;
+
+  osMutexAcquire(dns_cache_mutex, osWaitForever);
+
+  entry = prvDNSCacheFind(host);
+  if (entry != NULL)
+    entry->fresh = false;
+
+  osMutexRelease(dns_cache_mutex);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Get DNS cache statistics
+ * @param[out]     stat: Output statistics
+ */
+void DNSCache_GetStat(DNS_CACHE_STAT_t *stat)
+{
+  *stat = dns_cache_stat;
+}
+/******************************************************************************/
+
+
+
+
+static DNS_CACHE_ENTRY_t *prvDNSCacheFind(const char *host)
+{
+  for (uint32_t i = 0; i < DNS_CACHE_ENTRIES; i++)
+  {
+    if (dns_cache[i].host[0] != '\0' && strcmp(dns_cache[i].host, host) == 0)
+      return &dns_cache[i];
+  }
+
+  return NULL;
+}
+/******************************************************************************/
+
+
+
+
+static DNS_CACHE_ENTRY_t *prvDNSCacheAlloc(const char *host)
+{
+  DNS_CACHE_ENTRY_t *entry = &dns_cache[0];
+
+  //Free entry or least recently used one
+  for (uint32_t i = 0; i < DNS_CACHE_ENTRIES; i++)
+  {
+    if (dns_cache[i].host[0] == '\0')
+    {
+      entry = &dns_cache[i];
+      break;
+    }
+
+    if ((int32_t)(dns_cache[i].used_tick - entry->used_tick) < 0)
+      entry = &dns_cache[i];
+  }
+
+  memset(entry, 0, sizeof(*entry));
+  strcpy(entry->host, host);
+
+  return entry;
+}
+/******************************************************************************/
+
+
+
+
+static bool prvDNSCacheIsIp(const char *host)
+{
+  uint32_t dots = 0;
+  uint32_t digits = 0;
+  uint32_t value = 0;
+
+  for (; *host != '\0'; host++)
+  {
+    if (*host == '.')
+    {
+      if (digits == 0 || ++dots > 3)
+        return false;
+      digits = 0;
+      value = 0;
+    }
+    else if (*host >= '0' && *host <= '9')
+    {
+      value = value * 10u + (uint32_t)(*host - '0');
+      if (++digits > 3 || value > 255u)
+        return false;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  return dots == 3 && digits > 0;
+}
+/******************************************************************************/
@@ -0,0 +1,1155 @@
+/**
+ ******************************************************************************
+ * @file           : mqtt_broker.c
+ * @author         : Aleksandr Shabalin       <alexnv97@gmail.com>
+ * @brief          : Local MQTT broker for AP mode
+ ******************************************************************************
+ * ----------------- Copyright (c) 2023 Aleksandr Shabalin------------------- *
+ ******************************************************************************
+ ******************************************************************************
+ */
+
+
+/******************************************************************************/
+/* Includes ----------------------------------------------------------------- */
+/******************************************************************************/
+#include "mqtt_broker.h"
+
+#include <string.h>
+
+#include "esp/esp_async.h"
+#include "esp/esp_mem.h"
+#include "esp/esp_stream.h"
+
+#include "cmsis_os2.h"
+
+#include "log.h"
+
+/******************************************************************************/
+/* Private defines ---------------------------------------------------------- */
+/******************************************************************************/
+#define BROKER_TRIE_NODES            (32u)
+#define BROKER_TRIE_NONE             (0xFFu)
+#define BROKER_LEVEL_LEN             (15u)
+#define BROKER_TOPIC_LEN             (64u)
+#define BROKER_MAX_FILTERS           (8u)
+#define BROKER_MAX_PAYLOAD           (1024u)
+#define BROKER_TX_QUEUE_LEN          (4u)
+#define BROKER_STOP_TIMEOUT          (2000u)
+
+#define BROKER_CONNECT               (0x01u)
+#define BROKER_PUBLISH               (0x03u)
+#define BROKER_SUBSCRIBE             (0x08u)
+#define BROKER_UNSUBSCRIBE           (0x0Au)
+#define BROKER_PINGREQ               (0x0Cu)
+#define BROKER_DISCONNECT            (0x0Eu)
+
+#if MQTT_BROKER_MAX_CLIENTS > 8
+#error "MQTT_BROKER_MAX_CLIENTS must fit subscription mask of 8 bits"
+#endif
+
+
+/******************************************************************************/
+/* Private variables -------------------------------------------------------- */
+/******************************************************************************/
+typedef uint8_t BROKER_MASK_t;
+
+/* Outgoing frame shared by all receivers, freed when last send completes */
+typedef struct
+{
+  uint8_t ref;
+  uint16_t len;
+  uint8_t data[];
+} BROKER_FRAME_t;
+
+typedef struct
+{
+  esp_conn_p conn;
+  esp_stream_t rx;
+  uint8_t hdr;
+  uint8_t len_cnt;
+  size_t rem_len;
+  uint16_t field_len;
+  uint8_t buf[BROKER_TOPIC_LEN + 2];
+  BROKER_FRAME_t *frame;
+  BROKER_MASK_t mask;
+  uint8_t ack[4 + BROKER_MAX_FILTERS];
+  uint8_t ack_cnt;
+  uint32_t rx_time;
+  uint16_t keep_alive;
+  bool connected;
+  bool closing;
+  bool closed;
+  BROKER_FRAME_t *tx[BROKER_TX_QUEUE_LEN];
+  uint8_t tx_head;
+  uint8_t tx_cnt;
+} BROKER_SESSION_t;
+
+/* Topic level of subscription trie, children are linked as siblings */
+typedef struct
+{
+  char level[BROKER_LEVEL_LEN];
+  uint8_t len;
+  uint8_t child;
+  uint8_t next;
+  BROKER_MASK_t subs;
+  bool used;
+} BROKER_NODE_t;
+
+static struct
+{
+  BROKER_SESSION_t sessions[MQTT_BROKER_MAX_CLIENTS];
+  BROKER_NODE_t nodes[BROKER_TRIE_NODES];
+  osMutexId_t lock;
+} broker;
+
+static const osMutexAttr_t BrokerMutex_attr =
+{
+  .name = "BrokerMutex",
+  .attr_bits = osMutexRecursive,
+  .cb_mem = NULL,
+  .cb_size = 0U
+};
+
+
+/******************************************************************************/
+/* Private function prototypes ---------------------------------------------- */
+/******************************************************************************/
+static void prvBrokerConnect(esp_conn_p conn, espr_t res, void *arg);
+static void prvBrokerRecv(esp_conn_p conn, esp_pbuf_p pbuf, void *arg);
+static void prvBrokerSent(esp_conn_p conn, size_t len, espr_t res, void *arg);
+static void prvBrokerClose(esp_conn_p conn, uint8_t forced, espr_t res, void *arg);
+static espr_t prvBrokerStepSkip(esp_stream_t *rx);
+static espr_t prvBrokerStepHdr(esp_stream_t *rx);
+static espr_t prvBrokerStepLen(esp_stream_t *rx);
+static espr_t prvBrokerStepConnect(esp_stream_t *rx);
+static espr_t prvBrokerStepTopicLen(esp_stream_t *rx);
+static espr_t prvBrokerStepTopic(esp_stream_t *rx);
+static espr_t prvBrokerStepPubId(esp_stream_t *rx);
+static espr_t prvBrokerStepPayload(esp_stream_t *rx);
+static espr_t prvBrokerStepSubId(esp_stream_t *rx);
+static espr_t prvBrokerStepFilterLen(esp_stream_t *rx);
+static espr_t prvBrokerStepFilter(esp_stream_t *rx);
+
+static const esp_async_handler_t broker_handler =
+{
+  .connect_fn = prvBrokerConnect,
+  .recv_fn = prvBrokerRecv,
+  .sent_fn = prvBrokerSent,
+  .close_fn = prvBrokerClose,
+  .arg = NULL
+};
+
+
+/******************************************************************************/
+
+
+/**
+ * @brief          Get length of topic level
+ * @param[in]      str: Start of level
+ * @param[in]      len: Remaining topic length
+ * @retval         size_t: Number of characters until '/' or end of topic
+ */
+static size_t prvBrokerLevelLen(const char *str, size_t len)
+{
+  const char *end = memchr(str, '/', len);
+
+  return end != NULL ? (size_t)(end - str) : len;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Check if trie node is single character wildcard level
+ */
+static bool prvBrokerNodeIs(const BROKER_NODE_t *node, char wildcard)
+{
+  return node->len == 1 && node->level[0] == wildcard;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Find child node with level or create it
+ * @param[in]      parent: Parent node index
+ * @param[in]      level: Level name
+ * @param[in]      len: Level length
+ * @param[in]      create: 'true' to create missing child
+ * @retval         uint8_t: Child node index or BROKER_TRIE_NONE
+ */
+static uint8_t prvBrokerTrieChild(uint8_t parent, const char *level, size_t len, bool create)
+{
+  uint8_t c;
+
+  for (c = broker.nodes[parent].child; c != BROKER_TRIE_NONE; c = broker.nodes[c].next)
+  {
+    if (broker.nodes[c].len == len && memcmp(broker.nodes[c].level, level, len) == 0)
+      return c;
+  }
+
+  if (!create || len > BROKER_LEVEL_LEN)
+    return BROKER_TRIE_NONE;
+
+  for (c = 1; c < BROKER_TRIE_NODES; c++)
+  {
+    if (!broker.nodes[c].used)
+    {
+      memset(&broker.nodes[c], 0, sizeof(broker.nodes[c]));
+      memcpy(broker.nodes[c].level, level, len);
+      broker.nodes[c].len = (uint8_t)len;
+      broker.nodes[c].used = true;
+      broker.nodes[c].child = BROKER_TRIE_NONE;
+      broker.nodes[c].next = broker.nodes[parent].child;
+      broker.nodes[parent].child = c;
+      return c;
+    }
+  }
+  return BROKER_TRIE_NONE;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Remove child nodes without subscribers and children
+ * @param[in]      node: Node index to prune from
+ */
+static void prvBrokerTriePrune(uint8_t node)
+{
+  uint8_t *link = &broker.nodes[node].child;
+
+  while (*link != BROKER_TRIE_NONE)
+  {
+    BROKER_NODE_t *c = &broker.nodes[*link];
+
+    prvBrokerTriePrune(*link);
+    if (c->subs == 0 && c->child == BROKER_TRIE_NONE)
+    {
+      c->used = false;
+      *link = c->next;
+    }
+    else
+      link = &c->next;
+  }
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Add or remove client subscription for topic filter
+ * @param[in]      filter: Topic filter, may contain '+' and '#' wildcards
+ * @param[in]      len: Filter length
+ * @param[in]      bit: Client bit in subscription mask
+ * @param[in]      add: 'true' to subscribe, 'false' to unsubscribe
+ * @retval         bool: 'true' on success
+ */
+static bool prvBrokerTrieSet(const char *filter, size_t len, BROKER_MASK_t bit, bool add)
+{
+  uint8_t node = 0;
+  size_t lvl;
+
+  if (len == 0)
+    return false;
+
+  for (;;)
+  {
+    lvl = prvBrokerLevelLen(filter, len);
+
+    /* Wildcards must take whole level, multi-level one must be the last */
+    if ((memchr(filter, '+', lvl) != NULL || memchr(filter, '#', lvl) != NULL) &&
+        (lvl != 1 || (filter[0] == '#' && lvl != len)))
+      return false;
+
+    node = prvBrokerTrieChild(node, filter, lvl, add);
+    if (node == BROKER_TRIE_NONE)
+    {
+      prvBrokerTriePrune(0);
+      return false;
+    }
+
+    if (lvl == len)
+      break;
+    filter += lvl + 1;
+    len -= lvl + 1;
+  }
+
+  if (add)
+    broker.nodes[node].subs |= bit;
+  else
+  {
+    broker.nodes[node].subs &= (BROKER_MASK_t)~bit;
+    prvBrokerTriePrune(0);
+  }
+  return true;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Collect clients subscribed to topic
+ * @param[in]      node: Trie node to match children of
+ * @param[in]      topic: Remaining topic levels
+ * @param[in]      len: Remaining topic length
+ * @param[in]      first: 'true' for first topic level
+ * @retval         BROKER_MASK_t: Mask of subscribed clients
+ */
+static BROKER_MASK_t prvBrokerTrieMatch(uint8_t node, const char *topic, size_t len, bool first)
+{
+  BROKER_MASK_t mask = 0;
+  size_t lvl = prvBrokerLevelLen(topic, len);
+  /* Wildcards do not match topics starting with '$' */
+  bool wild = !(first && len > 0 && topic[0] == '$');
+
+  for (uint8_t c = broker.nodes[node].child; c != BROKER_TRIE_NONE; c = broker.nodes[c].next)
+  {
+    const BROKER_NODE_t *n = &broker.nodes[c];
+
+    if (prvBrokerNodeIs(n, '#'))
+    {
+      if (wild)
+        mask |= n->subs;
+      continue;
+    }
+    if (!(wild && prvBrokerNodeIs(n, '+')) && !(n->len == lvl && memcmp(n->level, topic, lvl) == 0))
+      continue;
+
+    if (lvl == len)
+    {
+      mask |= n->subs;
+      /* "a/#" matches "a" as well */
+      for (uint8_t g = n->child; g != BROKER_TRIE_NONE; g = broker.nodes[g].next)
+      {
+        if (prvBrokerNodeIs(&broker.nodes[g], '#'))
+          mask |= broker.nodes[g].subs;
+      }
+    }
+    else
+      mask |= prvBrokerTrieMatch(c, topic + lvl + 1, len - lvl - 1, false);
+  }
+  return mask;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Allocate outgoing frame
+ * @param[in]      len: Frame length
+ * @retval         BROKER_FRAME_t*: Frame or NULL
+ */
+static BROKER_FRAME_t *prvBrokerFrameNew(size_t len)
+{
+  BROKER_FRAME_t *frame = esp_mem_malloc(sizeof(*frame) + len);
+
+  if (frame != NULL)
+  {
+    frame->ref = 0;
+    frame->len = (uint16_t)len;
+  }
+  return frame;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Drop frame reference, free frame when it was the last one
+ * @param[in]      frame: Frame to release
+ */
+static void prvBrokerFrameRelease(BROKER_FRAME_t *frame)
+{
+  if (frame->ref > 0)
+    frame->ref--;
+  if (frame->ref == 0)
+    esp_mem_free(frame);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Queue frame for sending to client, frame memory is shared
+ * @param[in]      s: Client session
+ * @param[in]      frame: Frame to send
+ * @retval         bool: 'true' if frame was queued, 'false' if client is too slow
+ */
+static bool prvBrokerSend(BROKER_SESSION_t *s, BROKER_FRAME_t *frame)
+{
+  if (s->closing || s->tx_cnt >= BROKER_TX_QUEUE_LEN)
+    return false;
+
+  if (esp_async_send(s->conn, frame->data, frame->len) != espOK)
+    return false;
+
+  s->tx[(s->tx_head + s->tx_cnt) % BROKER_TX_QUEUE_LEN] = frame;
+  s->tx_cnt++;
+  frame->ref++;
+  return true;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Send short control packet to client
+ * @param[in]      s: Client session
+ * @param[in]      data: Packet data
+ * @param[in]      len: Packet length
+ */
+static void prvBrokerSendCtrl(BROKER_SESSION_t *s, const uint8_t *data, size_t len)
+{
+  BROKER_FRAME_t *frame = prvBrokerFrameNew(len);
+
+  if (frame == NULL)
+    return;
+
+  memcpy(frame->data, data, len);
+  if (!prvBrokerSend(s, frame))
+    esp_mem_free(frame);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Build PUBLISH frame with QoS 0 for subscribers
+ * @param[in]      topic: Topic name
+ * @param[in]      topic_len: Topic length
+ * @param[in]      len: Payload length
+ * @param[out]      payload: Pointer to payload area in frame to fill by caller
+ * @retval         BROKER_FRAME_t*: Frame or NULL
+ */
+static BROKER_FRAME_t *prvBrokerPublishFrame(const char *topic, size_t topic_len, size_t len, uint8_t **payload)
+{
+  BROKER_FRAME_t *frame;
+  size_t rem_len = 2 + topic_len + len, hdr_len = 2;
+  uint8_t *d;
+
+  for (size_t r = rem_len >> 7; r > 0; r >>= 7)
+    hdr_len++;
+
+  frame = prvBrokerFrameNew(hdr_len + rem_len);
+  if (frame == NULL)
+    return NULL;
+
+  d = frame->data;
+  *d++ = BROKER_PUBLISH << 4;
+  do
+  {
+    *d = rem_len & 0x7F;
+    rem_len >>= 7;
+    if (rem_len > 0)
+      *d |= 0x80;
+    d++;
+  } while (rem_len > 0);
+  *d++ = (uint8_t)(topic_len >> 8);
+  *d++ = (uint8_t)topic_len;
+  memcpy(d, topic, topic_len);
+  *payload = d + topic_len;
+  return frame;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Send frame to every subscribed client
+ * @param[in]      frame: Frame to send, released when no client took it
+ * @param[in]      mask: Subscribed clients
+ */
+static void prvBrokerFanOut(BROKER_FRAME_t *frame, BROKER_MASK_t mask)
+{
+  for (uint8_t i = 0; i < MQTT_BROKER_MAX_CLIENTS; i++)
+  {
+    if ((mask & (1u << i)) && broker.sessions[i].connected)
+      prvBrokerSend(&broker.sessions[i], frame);
+  }
+
+  if (frame->ref == 0)
+    esp_mem_free(frame);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Get 16-bit value in network byte order
+ */
+static uint16_t prvBrokerU16(const uint8_t *d)
+{
+  return (uint16_t)((d[0] << 8) | d[1]);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Request next field of current packet
+ * @param[in]      s: Client session
+ * @param[in]      dst: Field destination, NULL to skip field
+ * @param[in]      len: Field length
+ * @param[in]      fn: Step called when field is received
+ * @retval         espr_t: espERR if field exceeds packet
+ */
+static espr_t prvBrokerExpect(BROKER_SESSION_t *s, void *dst, size_t len, esp_stream_fn fn)
+{
+  if (len > s->rem_len)
+    return espERR;
+
+  s->rem_len -= len;
+  esp_stream_expect(&s->rx, dst, len, fn);
+  return espOK;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Skip rest of current packet and wait for next one
+ */
+static espr_t prvBrokerNext(BROKER_SESSION_t *s)
+{
+  if (s->rem_len > 0)
+    return prvBrokerExpect(s, NULL, s->rem_len, prvBrokerStepSkip);
+
+  esp_stream_expect(&s->rx, s->buf, 1, prvBrokerStepHdr);
+  return espOK;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Unused rest of packet skipped
+ */
+static espr_t prvBrokerStepSkip(esp_stream_t *rx)
+{
+  return prvBrokerNext(rx->arg);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Fixed header byte received
+ */
+static espr_t prvBrokerStepHdr(esp_stream_t *rx)
+{
+  BROKER_SESSION_t *s = rx->arg;
+
+  s->hdr = s->buf[0];
+  s->rem_len = 0;
+  s->len_cnt = 0;
+  esp_stream_expect(rx, s->buf, 1, prvBrokerStepLen);
+  return espOK;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Remaining length byte received, start packet when length is complete
+ */
+static espr_t prvBrokerStepLen(esp_stream_t *rx)
+{
+  static const uint8_t pingresp[] = {0xD0, 0x00};
+  BROKER_SESSION_t *s = rx->arg;
+  uint8_t type = s->hdr >> 4;
+
+  s->rem_len |= (size_t)(s->buf[0] & 0x7F) << (7 * s->len_cnt++);
+  if (s->buf[0] & 0x80)
+  {
+    if (s->len_cnt >= 4)
+      return espERR;
+    esp_stream_expect(rx, s->buf, 1, prvBrokerStepLen);
+    return espOK;
+  }
+
+  if (!s->connected && type != BROKER_CONNECT)
+    return espERR;
+
+  switch (type)
+  {
+    case BROKER_CONNECT:
+      /* Protocol name "MQTT", level and flags precede keep-alive */
+      if (s->connected)
+        return espERR;
+      return prvBrokerExpect(s, s->buf, 10, prvBrokerStepConnect);
+    case BROKER_PUBLISH:
+      if (((s->hdr >> 1) & 0x03) > 1)
+        return espERR;
+      return prvBrokerExpect(s, s->buf, 2, prvBrokerStepTopicLen);
+    case BROKER_SUBSCRIBE:
+    case BROKER_UNSUBSCRIBE:
+      return prvBrokerExpect(s, &s->ack[2], 2, prvBrokerStepSubId);
+    case BROKER_PINGREQ:
+      prvBrokerSendCtrl(s, pingresp, sizeof(pingresp));
+      return prvBrokerNext(s);
+    case BROKER_DISCONNECT:
+      return espERR;
+    default:
+      return prvBrokerNext(s);
+  }
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          CONNECT variable header received, client id and credentials are skipped
+ */
+static espr_t prvBrokerStepConnect(esp_stream_t *rx)
+{
+  static const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+  BROKER_SESSION_t *s = rx->arg;
+
+  s->keep_alive = prvBrokerU16(&s->buf[8]);
+  s->connected = true;
+  prvBrokerSendCtrl(s, connack, sizeof(connack));
+  return prvBrokerNext(s);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          PUBLISH topic length received
+ */
+static espr_t prvBrokerStepTopicLen(esp_stream_t *rx)
+{
+  BROKER_SESSION_t *s = rx->arg;
+
+  s->field_len = prvBrokerU16(s->buf);
+  if (s->field_len == 0 || s->field_len > BROKER_TOPIC_LEN)
+    return espERR;
+  return prvBrokerExpect(s, s->buf, s->field_len, prvBrokerStepTopic);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Start receiving PUBLISH payload
+ *
+ * Payload is stored directly to frame shared by all subscribers,
+ * without subscribers it is skipped as it arrives.
+ */
+static espr_t prvBrokerPayload(BROKER_SESSION_t *s)
+{
+  uint8_t *payload;
+
+  s->mask = prvBrokerTrieMatch(0, (const char *)s->buf, s->field_len, true);
+  if (s->mask != 0 && s->rem_len <= BROKER_MAX_PAYLOAD)
+  {
+    s->frame = prvBrokerPublishFrame((const char *)s->buf, s->field_len, s->rem_len, &payload);
+    if (s->frame != NULL)
+      return prvBrokerExpect(s, payload, s->rem_len, prvBrokerStepPayload);
+  }
+  return prvBrokerNext(s);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          PUBLISH topic received
+ */
+static espr_t prvBrokerStepTopic(esp_stream_t *rx)
+{
+  BROKER_SESSION_t *s = rx->arg;
+
+  if (memchr(s->buf, '+', s->field_len) != NULL || memchr(s->buf, '#', s->field_len) != NULL)
+    return espERR;
+
+  if (s->hdr & 0x06)
+    return prvBrokerExpect(s, &s->buf[s->field_len], 2, prvBrokerStepPubId);
+  return prvBrokerPayload(s);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          PUBLISH packet identifier received, acknowledge QoS 1 message
+ */
+static espr_t prvBrokerStepPubId(esp_stream_t *rx)
+{
+  BROKER_SESSION_t *s = rx->arg;
+  uint8_t puback[] = {0x40, 0x02, s->buf[s->field_len], s->buf[s->field_len + 1]};
+
+  prvBrokerSendCtrl(s, puback, sizeof(puback));
+  return prvBrokerPayload(s);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          PUBLISH payload received, send it to subscribers
+ */
+static espr_t prvBrokerStepPayload(esp_stream_t *rx)
+{
+  BROKER_SESSION_t *s = rx->arg;
+
+  prvBrokerFanOut(s->frame, s->mask);
+  s->frame = NULL;
+  return prvBrokerNext(s);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Request next topic filter or acknowledge SUBSCRIBE/UNSUBSCRIBE
+ */
+static espr_t prvBrokerFilterNext(BROKER_SESSION_t *s)
+{
+  bool sub = (s->hdr >> 4) == BROKER_SUBSCRIBE;
+
+  if (s->rem_len > 0)
+    return prvBrokerExpect(s, s->buf, 2, prvBrokerStepFilterLen);
+  if (s->ack_cnt == 0)
+    return espERR;
+
+  s->ack[0] = sub ? 0x90 : 0xB0;
+  s->ack[1] = (uint8_t)(2 + (sub ? s->ack_cnt : 0));
+  prvBrokerSendCtrl(s, s->ack, 2 + s->ack[1]);
+  return prvBrokerNext(s);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          SUBSCRIBE/UNSUBSCRIBE packet identifier received
+ */
+static espr_t prvBrokerStepSubId(esp_stream_t *rx)
+{
+  BROKER_SESSION_t *s = rx->arg;
+
+  s->ack_cnt = 0;
+  return prvBrokerFilterNext(s);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Topic filter length received
+ */
+static espr_t prvBrokerStepFilterLen(esp_stream_t *rx)
+{
+  BROKER_SESSION_t *s = rx->arg;
+  /* Requested QoS follows filter in SUBSCRIBE, it is ignored */
+  size_t qos_len = (s->hdr >> 4) == BROKER_SUBSCRIBE ? 1 : 0;
+
+  s->field_len = prvBrokerU16(s->buf);
+  if (s->field_len > BROKER_TOPIC_LEN)
+    return prvBrokerExpect(s, NULL, s->field_len + qos_len, prvBrokerStepFilter);
+  return prvBrokerExpect(s, s->buf, s->field_len + qos_len, prvBrokerStepFilter);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Topic filter received, update subscriptions
+ */
+static espr_t prvBrokerStepFilter(esp_stream_t *rx)
+{
+  BROKER_SESSION_t *s = rx->arg;
+  BROKER_MASK_t bit = (BROKER_MASK_t)(1u << (s - broker.sessions));
+  bool sub = (s->hdr >> 4) == BROKER_SUBSCRIBE;
+  bool ok = false;
+
+  /* SUBACK must carry return code per filter, refuse SUBSCRIBE longer than it can hold */
+  if (sub && s->ack_cnt >= BROKER_MAX_FILTERS)
+    return espERR;
+
+  /* Subscriptions are granted with QoS 0, so one frame serves every subscriber */
+  if (s->field_len <= BROKER_TOPIC_LEN)
+    ok = prvBrokerTrieSet((const char *)s->buf, s->field_len, bit, sub);
+
+  if (s->ack_cnt < BROKER_MAX_FILTERS)
+    s->ack[4 + s->ack_cnt++] = ok ? 0x00 : 0x80;
+  return prvBrokerFilterNext(s);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Reset receive decoder to wait for new packet
+ */
+static void prvBrokerDecoderReset(BROKER_SESSION_t *s)
+{
+  s->rem_len = 0;
+  esp_stream_init(&s->rx, s->buf, 1, prvBrokerStepHdr, s);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Find session of connection
+ */
+static BROKER_SESSION_t *prvBrokerSession(esp_conn_p conn)
+{
+  for (uint8_t i = 0; i < MQTT_BROKER_MAX_CLIENTS; i++)
+  {
+    if (broker.sessions[i].conn == conn && !broker.sessions[i].closed)
+      return &broker.sessions[i];
+  }
+  return NULL;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Find session sends on connection belong to, closed session first
+ *
+ * Queued sends report after close event, before sends of new connection on same handle.
+ */
+static BROKER_SESSION_t *prvBrokerSessionSent(esp_conn_p conn)
+{
+  for (uint8_t i = 0; i < MQTT_BROKER_MAX_CLIENTS; i++)
+  {
+    if (broker.sessions[i].conn == conn && broker.sessions[i].closed)
+      return &broker.sessions[i];
+  }
+  return prvBrokerSession(conn);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Release all session resources and subscriptions
+ *
+ * Frames of queued sends are still read by ESP stack, session keeps them
+ * until sends report and is reused after that.
+ */
+static void prvBrokerSessionFree(BROKER_SESSION_t *s)
+{
+  for (uint8_t i = 0; i < BROKER_TRIE_NODES; i++)
+    broker.nodes[i].subs &= (BROKER_MASK_t)~(1u << (s - broker.sessions));
+  prvBrokerTriePrune(0);
+
+  if (s->frame != NULL)
+    esp_mem_free(s->frame);
+  s->frame = NULL;
+
+  if (s->tx_cnt > 0)
+  {
+    s->connected = false;
+    s->closing = true;
+    s->closed = true;
+    return;
+  }
+  memset(s, 0, sizeof(*s));
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Client connected to broker port
+ */
+static void prvBrokerConnect(esp_conn_p conn, espr_t res, void *arg)
+{
+  BROKER_SESSION_t *s;
+
+  (void)arg;
+
+  if (res != espOK || conn == NULL)
+    return;
+
+  osMutexAcquire(broker.lock, osWaitForever);
+  s = prvBrokerSession(NULL);
+  if (s != NULL)
+  {
+    s->conn = conn;
+    s->rx_time = osKernelGetTickCount();
+    prvBrokerDecoderReset(s);
+    PrintfLogsCRLF(CLR_GR"MQTT broker: client %u connected"CLR_DEF, (unsigned)(s - broker.sessions));
+  }
+  else
+    esp_async_close(conn);
+  osMutexRelease(broker.lock);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Data received from client
+ */
+static void prvBrokerRecv(esp_conn_p conn, esp_pbuf_p pbuf, void *arg)
+{
+  BROKER_SESSION_t *s;
+
+  (void)arg;
+
+  osMutexAcquire(broker.lock, osWaitForever);
+  s = prvBrokerSession(conn);
+  if (s != NULL && !s->closing)
+  {
+    /* Buffer is decoded in place and released when callback returns */
+    s->rx_time = osKernelGetTickCount();
+    if (esp_stream_feed_pbuf(&s->rx, pbuf) != espOK)
+    {
+      s->closing = true;
+      esp_async_close(s->conn);
+    }
+  }
+  osMutexRelease(broker.lock);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Send to client finished, sends complete in queue order
+ */
+static void prvBrokerSent(esp_conn_p conn, size_t len, espr_t res, void *arg)
+{
+  BROKER_SESSION_t *s;
+
+  (void)len;
+  (void)res;
+  (void)arg;
+
+  osMutexAcquire(broker.lock, osWaitForever);
+  s = prvBrokerSessionSent(conn);
+  if (s != NULL && s->tx_cnt > 0)
+  {
+    prvBrokerFrameRelease(s->tx[s->tx_head]);
+    s->tx_head = (s->tx_head + 1) % BROKER_TX_QUEUE_LEN;
+    s->tx_cnt--;
+    if (s->closed && s->tx_cnt == 0)
+      memset(s, 0, sizeof(*s));
+  }
+  osMutexRelease(broker.lock);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Client connection closed
+ */
+static void prvBrokerClose(esp_conn_p conn, uint8_t forced, espr_t res, void *arg)
+{
+  BROKER_SESSION_t *s;
+
+  (void)forced;
+  (void)res;
+  (void)arg;
+
+  osMutexAcquire(broker.lock, osWaitForever);
+  s = prvBrokerSession(conn);
+  if (s != NULL)
+  {
+    PrintfLogsCRLF(CLR_YL"MQTT broker: client %u disconnected"CLR_DEF, (unsigned)(s - broker.sessions));
+    prvBrokerSessionFree(s);
+  }
+  osMutexRelease(broker.lock);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Start local broker on port
+ * @param[in]      port: Port to listen on
+ * @retval         espr_t: espOK on success
+ */
+espr_t MQTTBroker_Start(esp_port_t port)
+{
+  espr_t res;
+
+  if (broker.lock == NULL)
+  {
+    broker.lock = osMutexNew(&BrokerMutex_attr);
+    if (broker.lock == NULL)
+      return espERRMEM;
+  }
+
+  osMutexAcquire(broker.lock, osWaitForever);
+  /* Closed sessions still hold frames of queued sends */
+  for (uint8_t i = 0; i < MQTT_BROKER_MAX_CLIENTS; i++)
+  {
+    if (!broker.sessions[i].closed)
+      memset(&broker.sessions[i], 0, sizeof(broker.sessions[i]));
+  }
+  memset(broker.nodes, 0, sizeof(broker.nodes));
+  broker.nodes[0].used = true;
+  broker.nodes[0].child = BROKER_TRIE_NONE;
+  broker.nodes[0].next = BROKER_TRIE_NONE;
+  osMutexRelease(broker.lock);
+
+  res = esp_async_init();
+  if (res == espOK)
+    res = esp_async_listen(port, MQTT_BROKER_MAX_CLIENTS, 0, &broker_handler);
+
+  if (res == espOK)
+    PrintfLogsCRLF(CLR_GR"MQTT broker listening on port %u"CLR_DEF, (unsigned)port);
+  return res;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Close all clients and wait until their sends are finished
+ *
+ * Sessions with sends not reported in time keep their frames until
+ * sent events are dispatched by later @ref MQTTBroker_Process calls.
+ */
+void MQTTBroker_Stop(void)
+{
+  uint32_t start = osKernelGetTickCount();
+  bool active;
+
+  osMutexAcquire(broker.lock, osWaitForever);
+  for (uint8_t i = 0; i < MQTT_BROKER_MAX_CLIENTS; i++)
+  {
+    if (broker.sessions[i].conn != NULL && !broker.sessions[i].closing)
+    {
+      broker.sessions[i].closing = true;
+      esp_async_close(broker.sessions[i].conn);
+    }
+  }
+  osMutexRelease(broker.lock);
+
+  /* Frames may still be used by queued sends until sent events are dispatched */
+  do
+  {
+    esp_async_poll(100);
+    active = false;
+    for (uint8_t i = 0; i < MQTT_BROKER_MAX_CLIENTS; i++)
+      active = active || broker.sessions[i].conn != NULL;
+  } while (active && osKernelGetTickCount() - start < BROKER_STOP_TIMEOUT);
+
+  osMutexAcquire(broker.lock, osWaitForever);
+  for (uint8_t i = 0; i < MQTT_BROKER_MAX_CLIENTS; i++)
+  {
+    if (broker.sessions[i].conn != NULL && !broker.sessions[i].closed)
+      prvBrokerSessionFree(&broker.sessions[i]);
+  }
+  osMutexRelease(broker.lock);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Dispatch broker events and close clients silent for 1.5 keep-alive periods
+ * @param[in]      timeout: Maximal time to wait for event in milliseconds
+ */
+void MQTTBroker_Process(uint32_t timeout)
+{
+  uint32_t now;
+
+  esp_async_poll(timeout);
+
+  osMutexAcquire(broker.lock, osWaitForever);
+  now = osKernelGetTickCount();
+  for (uint8_t i = 0; i < MQTT_BROKER_MAX_CLIENTS; i++)
+  {
+    BROKER_SESSION_t *s = &broker.sessions[i];
+
+    if (s->conn != NULL && !s->closing && s->keep_alive > 0 &&
+        now - s->rx_time > (uint32_t)s->keep_alive * 1500u)
+    {
+      PrintfLogsCRLF(CLR_YL"MQTT broker: client %u keep-alive expired"CLR_DEF, (unsigned)i);
+      s->closing = true;
+      esp_async_close(s->conn);
+    }
+  }
+  osMutexRelease(broker.lock);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Publish message from device to local subscribers
+ * @param[in]      topic: Topic name
+ * @param[in]      data: Message payload
+ * @param[in]      len: Payload length
+ * @retval         bool: 'true' if message was sent to at least one client
+ */
+bool MQTTBroker_Publish(const char *topic, const void *data, uint16_t len)
+{
+  BROKER_FRAME_t *frame;
+  BROKER_MASK_t mask;
+  uint8_t *payload;
+  bool res = false;
+  size_t topic_len = strlen(topic);
+
+  if (broker.lock == NULL)
+    return false;
+
+  osMutexAcquire(broker.lock, osWaitForever);
+  mask = prvBrokerTrieMatch(0, topic, topic_len, true);
+  if (mask != 0)
+  {
+    frame = prvBrokerPublishFrame(topic, topic_len, len, &payload);
+    if (frame != NULL)
+    {
+      memcpy(payload, data, len);
+      frame->ref++;                             /* Keep frame to check result */
+      prvBrokerFanOut(frame, mask);
+      res = frame->ref > 1;
+      prvBrokerFrameRelease(frame);
+    }
+  }
+  osMutexRelease(broker.lock);
+  return res;
+}
+/******************************************************************************/
@@ -0,0 +1,345 @@
+/**
+ ******************************************************************************
+ * @file           : mqtt_client.c
+ * @author         : Aleksandr Shabalin       <alexnv97@gmail.com>
+ * @brief          : MQTT client over ESP connection
+ ******************************************************************************
+ * ----------------- Copyright (c) 2023 Aleksandr Shabalin------------------- *
+ ******************************************************************************
+ ******************************************************************************
+ */
+
+
+/******************************************************************************/
+/* Includes ----------------------------------------------------------------- */
+/******************************************************************************/
+#include "mqtt_client.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp/esp_mqtt_client.h"
+
+#include "log.h"
+#include "config.h"
+#include "telemetry.h"
+#include "dns_cache.h"
+
+/******************************************************************************/
+/* Private defines ---------------------------------------------------------- */
+/******************************************************************************/
+#define MQTT_RX_BUFF_SIZE            (256u)
+#define MQTT_KEEP_ALIVE_S            (30u)
+/* Poll tick drives keep-alive and sending of coalesced publish packets */
+#define MQTT_POLL_INTERVAL_MS        (500u)
+
+#define MQTT_ID_SIZE                 (16u)
+#define MQTT_TOPIC_SIZE              (96u)
+
+
+/******************************************************************************/
+/* Private variables -------------------------------------------------------- */
+/******************************************************************************/
+static esp_mqtt_client_p mqtt_client;
+static esp_mqtt_client_info_t mqtt_info;
+static char mqtt_id[MQTT_ID_SIZE];
+static char mqtt_host_ip[DNS_CACHE_IP_STR_SIZE];
+static uint16_t mqtt_ssl_buf_size;
+/* SSL settings are kept by ESP until it is reset */
+static volatile bool mqtt_ssl_ready;
+/* Connect started and not finished or closed yet */
+static volatile bool mqtt_busy;
+
+
+/******************************************************************************/
+/* Private function prototypes ---------------------------------------------- */
+/******************************************************************************/
+static void prvMQTTClientEvent(esp_mqtt_client_p client, esp_mqtt_evt_t *evt);
+static bool prvMQTTClientTlsSetup(void);
+
+
+/******************************************************************************/
+
+
+/**
+ * @brief          Connect to MQTT broker from config
+ * @retval         bool: 'true' if connection was started or is already open
+ *
+ * Open connection is kept, TLS handshake takes seconds on ESP8266.
+ */
+bool MQTTClient_Start(void)
+{
+  const char *host;
+  espr_t res;
+
+  if (mqtt_busy)
+    return true;
+
+  if (mqtt_client == NULL)
+  {
+    mqtt_client = esp_mqtt_client_new(MQTT_RX_BUFF_SIZE);
+    if (mqtt_client == NULL)
+    {
+      PrintfLogsCRLF(CLR_RD"MQTT client allocation FAIL!"CLR_DEF);
+      return false;
+    }
+  }
+
+  snprintf(mqtt_id, sizeof(mqtt_id), "ESS%05lu", (unsigned long)config.mqtt.pin);
+  mqtt_info.id = mqtt_id;
+  mqtt_info.user = config.mqtt.login[0] != '\0' ? config.mqtt.login : NULL;
+  mqtt_info.pass = config.mqtt.passw[0] != '\0' ? config.mqtt.passw : NULL;
+  mqtt_info.keep_alive = MQTT_KEEP_ALIVE_S;
+  mqtt_info.use_ssl = config.mqtt.tls;
+
+  if (config.mqtt.tls)
+  {
+    //Host name is needed by ESP for SNI and certificate check
+    if (!mqtt_ssl_ready && !prvMQTTClientTlsSetup())
+      return false;
+
+    host = config.mqtt.host;
+  }
+  else
+  {
+    //Dial cached address, host name is not resolved by ESP on every reconnect
+    if (!DNSCache_Resolve(config.mqtt.host, mqtt_host_ip, sizeof(mqtt_host_ip)))
+      return false;
+
+    host = mqtt_host_ip;
+  }
+
+  esp_conn_set_poll_interval(MQTT_POLL_INTERVAL_MS);
+
+  res = esp_mqtt_client_connect(mqtt_client, host, config.mqtt.port,
+                                prvMQTTClientEvent, &mqtt_info);
+  if (res != espOK)
+  {
+    PrintfLogsCRLF(CLR_RD"MQTT connect to %s:%u FAIL! (%d)"CLR_DEF, config.mqtt.host,
+                   (unsigned)config.mqtt.port, (int)res);
+    return false;
+  }
+
+  mqtt_busy = true;
+  PrintfLogsCRLF("MQTT connecting to %s (%s):%u%s ...", config.mqtt.host, host,
+                 (unsigned)config.mqtt.port, config.mqtt.tls ? " over TLS" : "");
+  return true;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Disconnect from MQTT broker
+ */
+void MQTTClient_Stop(void)
+{
+  if (mqtt_client != NULL)
+    esp_mqtt_client_disconnect(mqtt_client);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Check MQTT broker connection
+ * @retval         bool: 'true' if client is connected and accepted by broker
+ */
+bool MQTTClient_IsConnected(void)
+{
+  return mqtt_client != NULL && esp_mqtt_client_is_connected(mqtt_client);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Publish message to device topic
+ * @param[in]      topic: Topic relative to device topic "ess/<pin>/"
+ * @param[in]      data: Message payload
+ * @param[in]      len: Payload length
+ * @param[in]      ack: MQTT_QOS1 to wait for broker acknowledge, MQTT_QOS0 otherwise
+ * @retval         bool: 'true' if message was queued for sending or stored
+ *
+ * Messages are coalesced into one TCP send, use @ref MQTTClient_Flush
+ * after batch to send them without waiting for the next poll tick.
+ * When broker is not connected or TX buffer is full message is stored
+ * by telemetry queue and sent after connection returns.
+ */
+bool MQTTClient_Publish(const char *topic, const void *data, uint16_t len, bool ack)
+{
+  if (MQTTClient_Send(topic, data, len, ack, NULL))
+    return true;
+
+  return Telemetry_Store(topic, data, len, ack);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Publish message to device topic without storing it on failure
+ * @param[in]      topic: Topic relative to device topic "ess/<pin>/"
+ * @param[in]      data: Message payload
+ * @param[in]      len: Payload length
+ * @param[in]      ack: MQTT_QOS1 to wait for broker acknowledge, MQTT_QOS0 otherwise
+ * @param[in]      arg: Passed to @ref Telemetry_Published when acknowledged message is finished
+ * @retval         bool: 'true' if message was queued for sending
+ */
+bool MQTTClient_Send(const char *topic, const void *data, uint16_t len, bool ack, void *arg)
+{
+  char full_topic[MQTT_TOPIC_SIZE];
+
+  if (!MQTTClient_IsConnected())
+    return false;
+
+  snprintf(full_topic, sizeof(full_topic), "ess/%lu/%s", (unsigned long)config.mqtt.pin, topic);
+
+  return esp_mqtt_client_publish(mqtt_client, full_topic, data, len,
+                                 ack ? ESP_MQTT_QOS_AT_LEAST_ONCE : ESP_MQTT_QOS_AT_MOST_ONCE,
+                                 0, arg) == espOK;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Send coalesced messages immediately
+ */
+void MQTTClient_Flush(void)
+{
+  if (mqtt_client != NULL)
+    esp_mqtt_client_flush(mqtt_client);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Forget SSL settings of ESP, called from ESP event callback
+ *                 when module was reset or restored
+ */
+void MQTTClient_EspReset(void)
+{
+  mqtt_ssl_ready = false;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Get SSL buffer size set on ESP
+ * @retval         uint16_t: Buffer size in bytes, 0 if ESP default is used
+ */
+uint16_t MQTTClient_GetSslBufferSize(void)
+{
+  return mqtt_ssl_buf_size;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Get MQTT client statistics
+ * @param[out]     stat: Output statistics, zeroed if client was never started
+ */
+void MQTTClient_GetStat(esp_mqtt_client_stat_t *stat)
+{
+  if (mqtt_client != NULL)
+    esp_mqtt_client_get_stat(mqtt_client, stat);
+  else
+    memset(stat, 0, sizeof(*stat));
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          MQTT client event callback, executed in ESP thread
+ * @param[in]      client: MQTT client handle
+ * @param[in]      evt: Event information
+ */
+static void prvMQTTClientEvent(esp_mqtt_client_p client, esp_mqtt_evt_t *evt)
+{
+  switch (evt->type)
+  {
+    case ESP_MQTT_EVT_CONNECT:
+    {
+      if (evt->evt.connect.status == ESP_MQTT_CONN_STATUS_ACCEPTED)
+      {
+        esp_mqtt_client_stat_t stat;
+
+        esp_mqtt_client_get_stat(client, &stat);
+        PrintfLogsCRLF(CLR_GR"MQTT connected to %s, link %lu ms, CONNACK %lu ms"CLR_DEF, config.mqtt.host,
+                       (unsigned long)stat.link_time, (unsigned long)stat.connack_time);
+      }
+      else
+      {
+        PrintfLogsCRLF(CLR_RD"MQTT connect FAIL! (status %d)"CLR_DEF, (int)evt->evt.connect.status);
+        mqtt_busy = false;
+        esp_conn_set_poll_interval(0);
+        /* Broker may have moved, resolve host again on next start */
+        if (evt->evt.connect.status == ESP_MQTT_CONN_STATUS_TCP_FAILED
+            || evt->evt.connect.status == ESP_MQTT_CONN_STATUS_TIMEOUT)
+          DNSCache_Invalidate(config.mqtt.host);
+      }
+      break;
+    }
+    case ESP_MQTT_EVT_PUBLISH:
+    {
+      /* Live messages are published without argument, only telemetry queue waits for result */
+      Telemetry_Published(evt->evt.publish.arg, evt->evt.publish.res == espOK);
+      break;
+    }
+    case ESP_MQTT_EVT_DISCONNECT:
+    {
+      PrintfLogsCRLF(CLR_YL"MQTT disconnected"CLR_DEF);
+      mqtt_busy = false;
+      /* No other user of connection poll events, stop wakeups */
+      esp_conn_set_poll_interval(0);
+      break;
+    }
+    default:
+      break;
+  }
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Configure ESP SSL before the first TLS connection after reset
+ * @retval         bool: 'true' if connection can be started
+ */
+static bool prvMQTTClientTlsSetup(void)
+{
+  espr_t res;
+
+  //Not supported by every AT firmware, ESP default is used then
+  res = esp_conn_set_ssl_buffersize(config.mqtt.tls_buf_size, 1);
+  mqtt_ssl_buf_size = res == espOK ? config.mqtt.tls_buf_size : 0;
+  if (res != espOK)
+    PrintfLogsCRLF(CLR_YL"ESP SSL buffer size not set (%d)"CLR_DEF, (int)res);
+
+  res = esp_conn_ssl_set_config(ESP_CFG_MAX_CONNS, config.mqtt.tls_auth, 0, 0, NULL, NULL, 1);
+  if (res != espOK)
+  {
+    PrintfLogsCRLF(CLR_RD"ESP SSL config FAIL! (%d)"CLR_DEF, (int)res);
+    //Without certificate check TLS still works with firmware default
+    return config.mqtt.tls_auth == 0;
+  }
+
+  mqtt_ssl_ready = true;
+  return true;
+}
+/******************************************************************************/
@@ -0,0 +1,107 @@
+/**
+ ******************************************************************************
+ * @file           : status.c
+ * @author         : Aleksandr Shabalin       <alexnv97@gmail.com>
+ * @brief          : Periodic device status message
+ ******************************************************************************
+ * ----------------- Copyright (c) 2023 Aleksandr Shabalin------------------- *
+ ******************************************************************************
+ ******************************************************************************
+ *
+ * Status is published to "ess/<pin>/status" every mqtt.publish_s seconds.
+ * While broker is not connected, messages are kept by telemetry queue
+ * and sent with their measurement time after connection returns.
+ */
+
+
+/******************************************************************************/
+/* Includes ----------------------------------------------------------------- */
+/******************************************************************************/
+#include "status.h"
+
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+#include "cmsis_os2.h"
+
+#include "config.h"
+#include "log.h"
+#include "mqtt_client.h"
+#include "telemetry.h"
+#include "time_sync.h"
+
+
+/******************************************************************************/
+/* Private defines ---------------------------------------------------------- */
+/******************************************************************************/
+#define STATUS_TOPIC                 "status"
+#define STATUS_DATA_SIZE             (128u)
+
+
+/******************************************************************************/
+/* Private variables -------------------------------------------------------- */
+/******************************************************************************/
+const osTimerAttr_t StatusTimer_attr =
+{
+  .name = "StatusTimer",
+};
+
+static osTimerId_t status_timer;
+
+
+/******************************************************************************/
+/* Private function prototypes ---------------------------------------------- */
+/******************************************************************************/
+static void prvStatusPublish(void *argument);
+
+
+/******************************************************************************/
+
+
+/**
+ * @brief          Start periodic status publishing
+ */
+void Status_Init(void)
+{
+  if (status_timer != NULL)
+    return;
+
+  status_timer = osTimerNew(prvStatusPublish, osTimerPeriodic, NULL, &StatusTimer_attr);
+  if (status_timer != NULL)
+    osTimerStart(status_timer, (uint32_t)config.mqtt.data_publish_timeout_s * 1000u);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Publish device status, executed in timer task
+ * @param[in]      argument: Not used
+ */
+static void prvStatusPublish(void *argument)
+{
+  TELEMETRY_STAT_t tlm_stat;
+  char data[STATUS_DATA_SIZE];
+  int len;
+
+  (void)argument;
+
+  //Broker is not configured, nothing would ever send stored messages
+  if (config.mqtt.host[0] == '\0')
+    return;
+
+  Telemetry_GetStat(&tlm_stat);
+
+  len = snprintf(data, sizeof(data),
+                 "{\"time\":%lu,\"uptime\":%lu,\"heap\":%u,\"backlog\":%lu,\"dropped\":%lu}",
+                 (unsigned long)TimeSync_GetTime(), (unsigned long)(osKernelGetTickCount() / 1000u),
+                 (unsigned)xPortGetFreeHeapSize(),
+                 (unsigned long)(tlm_stat.ram_count + tlm_stat.flash_count), (unsigned long)tlm_stat.dropped);
+  if (len <= 0 || len >= (int)sizeof(data))
+    return;
+
+  if (!MQTTClient_Publish(STATUS_TOPIC, data, (uint16_t)len, MQTT_QOS1))
+    PrintfLogsCRLF(CLR_YL"Status message dropped"CLR_DEF);
+}
+/******************************************************************************/
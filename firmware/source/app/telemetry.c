@@ -0,0 +1,803 @@
+/**
+ ******************************************************************************
+ * @file           : telemetry.c
+ * @author         : Aleksandr Shabalin       <alexnv97@gmail.com>
+ * @brief          : Store-and-forward queue of MQTT messages for offline periods
+ ******************************************************************************
+ * ----------------- Copyright (c) 2023 Aleksandr Shabalin------------------- *
+ ******************************************************************************
+ ******************************************************************************
+ *
+ * Messages which can not be published are kept in RAM buffer. When it is full,
+ * unsent messages are moved to flash log in one pass. Log is a ring of sectors,
+ * write position moves only to the next sector already erased. Sector erase
+ * stalls CPU on flash fetch for 1-2 s, so it is done ahead of time by low
+ * priority task once write sector is nearly full, never while message is stored.
+ * Erase drops messages still stored in that sector.
+ *
+ * Each record starts with state word, it is programmed after the rest
+ * of record, so record interrupted by reset is never sent. Sent records
+ * are marked by programming state word to zero, unsent records are
+ * recovered from flash after reset. Records published with acknowledge
+ * stay in queue until broker confirms them and are sent again on failure.
+ *
+ * Queue is drained by timer while MQTT client is connected, amount of data
+ * per tick is limited so live messages still get TX buffer space.
+ * Drained messages are published to "backlog/<seq>/<time_s>/<topic>",
+ * so receiver knows when message was measured and can detect gaps.
+ */
+
+
+/******************************************************************************/
+/* Includes ----------------------------------------------------------------- */
+/******************************************************************************/
+#include "telemetry.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cmsis_os2.h"
+
+#include "flash.h"
+#include "log.h"
+#include "mem_layout.h"
+#include "mqtt_client.h"
+#include "time_sync.h"
+
+
+/******************************************************************************/
+/* Private defines ---------------------------------------------------------- */
+/******************************************************************************/
+#define TELEMETRY_RAM_SIZE           (4096u)
+/* Messages older than this are dropped instead of sent */
+#define TELEMETRY_MAX_AGE_S          (24u * 3600u)
+#define TELEMETRY_DRAIN_PERIOD_MS    (1000u)
+#define TELEMETRY_DRAIN_BYTES        (2048u)
+/* "backlog/" and two 32-bit numbers with separators */
+#define TELEMETRY_BACKLOG_TOPIC_SIZE (TELEMETRY_TOPIC_SIZE + 32u)
+/* Messages sent and not released from queue, MQTT client has 8 request slots */
+#define TELEMETRY_TX_WINDOW          (8u)
+/* Next sector is erased once write sector has less free space */
+#define TELEMETRY_PREPARE_MARGIN     (4u * TELEMETRY_RAM_SIZE)
+
+#define TELEMETRY_FLAG_PREPARE       (0x0001u)
+
+#define TELEMETRY_TX_WAIT            (0u)
+#define TELEMETRY_TX_DONE            (1u)
+#define TELEMETRY_TX_FAIL            (2u)
+
+#define TELEMETRY_REC_FREE           (0xFFFFFFFFu)
+#define TELEMETRY_REC_VALID          (0x314D4C54u)
+#define TELEMETRY_REC_SENT           (0x00000000u)
+#define TELEMETRY_LEN_FREE           (0xFFFFu)
+
+#define TELEMETRY_FLASH_END          (FLASH_LOG_ADDR + FLASH_LOG_SECTORS * FLASH_LOG_SECTOR_SIZE)
+
+#define TELEMETRY_ALIGN(size)        (((size) + 3u) & ~3u)
+
+
+/******************************************************************************/
+/* Private variables -------------------------------------------------------- */
+/******************************************************************************/
+/* Record header, followed by topic without terminator and payload */
+typedef struct
+{
+  uint32_t state;
+  uint32_t seq;
+  uint32_t time_s;
+  uint16_t len;
+  uint8_t topic_len;
+  uint8_t ack;
+} TELEMETRY_REC_t;
+
+/* Record sent from queue head, state is set by MQTT client when acknowledged */
+typedef struct
+{
+  uint32_t seq;
+  volatile uint8_t state;
+} TELEMETRY_TX_t;
+
+/* Read position in flash log or RAM buffer */
+typedef struct
+{
+  uint32_t addr;
+  bool from_flash;
+} TELEMETRY_POS_t;
+
+typedef struct
+{
+  osMutexId_t mutex;
+  osTimerId_t timer;
+  osThreadId_t task;
+  TELEMETRY_TX_t tx[TELEMETRY_TX_WINDOW];
+  uint8_t tx_head;
+  uint8_t tx_cnt;
+  uint32_t seq;
+  uint32_t ram_rd;
+  uint32_t ram_wr;
+  uint32_t fl_rd;
+  uint32_t fl_wr;
+  /* Sector after write sector is erased */
+  bool fl_spare;
+  TELEMETRY_STAT_t stat;
+} TELEMETRY_t;
+
+const osMutexAttr_t TelemetryMutex_attr =
+{
+  .name = "TelemetryMutex",
+  .attr_bits = osMutexRecursive,
+  .cb_mem = NULL,
+  .cb_size = 0U
+};
+
+const osTimerAttr_t TelemetryTimer_attr =
+{
+  .name = "TelemetryTimer",
+};
+
+MEM_CCMRAM_THREAD(TelemetryTask, 256 * 4);
+
+const osThreadAttr_t TelemetryTask_attr =
+{
+  .name = "TelemetryTask",
+  MEM_CCMRAM_THREAD_ATTR(TelemetryTask),
+  .priority = (osPriority_t) osPriorityLow,
+};
+
+static TELEMETRY_t telemetry;
+static uint32_t telemetry_ram[TELEMETRY_RAM_SIZE / sizeof(uint32_t)] MEM_CCMRAM;
+
+
+/******************************************************************************/
+/* Private function prototypes ---------------------------------------------- */
+/******************************************************************************/
+static void prvTelemetryTask(void *argument);
+static void prvTelemetryDrain(void *argument);
+static bool prvTelemetryRelease(void);
+static const TELEMETRY_REC_t *prvTelemetryFirst(TELEMETRY_POS_t *pos);
+static const TELEMETRY_REC_t *prvTelemetryNext(TELEMETRY_POS_t *pos);
+static void prvTelemetryPop(const TELEMETRY_REC_t *rec, bool from_flash);
+static void prvTelemetrySpill(void);
+static void prvTelemetryRecover(void);
+static bool prvTelemetryFlashPrepare(void);
+static bool prvTelemetryFlashPrepared(void);
+static void prvTelemetryFlashAdvance(void);
+static uint32_t prvTelemetryFlashSkip(uint32_t addr);
+static bool prvTelemetryRecCheck(const TELEMETRY_REC_t *rec);
+static uint32_t prvTelemetryRecSize(const TELEMETRY_REC_t *rec);
+static uint32_t prvTelemetrySectorEnd(uint32_t addr);
+static uint32_t prvTelemetrySectorNext(uint32_t addr);
+
+
+/******************************************************************************/
+
+
+/**
+ * @brief          Recover unsent messages from flash and start queue draining
+ */
+void Telemetry_Init(void)
+{
+  if (telemetry.mutex != NULL)
+    return;
+
+  telemetry.mutex = osMutexNew(&TelemetryMutex_attr);
+  if (telemetry.mutex == NULL)
+    return;
+
+  prvTelemetryRecover();
+
+  telemetry.task = osThreadNew(prvTelemetryTask, NULL, &TelemetryTask_attr);
+
+  telemetry.timer = osTimerNew(prvTelemetryDrain, osTimerPeriodic, NULL, &TelemetryTimer_attr);
+  if (telemetry.timer != NULL)
+    osTimerStart(telemetry.timer, TELEMETRY_DRAIN_PERIOD_MS);
+
+  if (telemetry.stat.flash_count > 0)
+    PrintfLogsCRLF("Telemetry: %lu unsent messages in flash, next seq %lu",
+                   (unsigned long)telemetry.stat.flash_count, (unsigned long)telemetry.seq);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Keep message until it can be published
+ * @param[in]      topic: Topic relative to device topic
+ * @param[in]      data: Message payload
+ * @param[in]      len: Payload length
+ * @param[in]      ack: MQTT_QOS1 to wait for broker acknowledge, MQTT_QOS0 otherwise
+ * @retval         bool: 'true' if message was stored
+ */
+bool Telemetry_Store(const char *topic, const void *data, uint16_t len, bool ack)
+{
+  TELEMETRY_REC_t *rec;
+  size_t topic_len = strlen(topic);
+  uint32_t size = TELEMETRY_ALIGN(sizeof(*rec) + topic_len + len);
+
+  if (telemetry.mutex == NULL || topic_len == 0 || topic_len > TELEMETRY_TOPIC_SIZE
+      || len > TELEMETRY_DATA_SIZE)
+    return false;
+
+  if (osMutexAcquire(telemetry.mutex, osWaitForever) != osOK)
+    return false;
+
+  if (telemetry.ram_wr + size > sizeof(telemetry_ram))
+    prvTelemetrySpill();
+
+  //Flash log waits for erase of the next sector
+  if (telemetry.ram_wr + size > sizeof(telemetry_ram))
+  {
+    telemetry.stat.dropped++;
+    osMutexRelease(telemetry.mutex);
+    return false;
+  }
+
+  rec = (TELEMETRY_REC_t *)((uint8_t *)telemetry_ram + telemetry.ram_wr);
+  rec->state = TELEMETRY_REC_VALID;
+  rec->seq = telemetry.seq++;
+  rec->time_s = TimeSync_GetTime();
+  rec->len = len;
+  rec->topic_len = (uint8_t)topic_len;
+  rec->ack = ack;
+  memcpy(rec + 1, topic, topic_len);
+  memcpy((uint8_t *)(rec + 1) + topic_len, data, len);
+
+  telemetry.ram_wr += size;
+  telemetry.stat.ram_count++;
+  telemetry.stat.stored++;
+
+  osMutexRelease(telemetry.mutex);
+
+  return true;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Get queue statistics
+ * @param[out]     stat: Output statistics
+ */
+void Telemetry_GetStat(TELEMETRY_STAT_t *stat)
+{
+  *stat = telemetry.stat;
+  stat->seq = telemetry.seq;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Report result of message published with acknowledge, executed in ESP thread
+ * @param[in]      arg: Argument given to @ref MQTTClient_Send
+ * @param[in]      ok: 'true' if broker acknowledged message
+ *
+ * Mutex is not taken, ESP thread must not wait for timer task draining the queue.
+ * Message is released or sent again by the next drain.
+ */
+void Telemetry_Published(void *arg, bool ok)
+{
+  TELEMETRY_TX_t *tx = arg;
+
+  if (tx != NULL && tx->state == TELEMETRY_TX_WAIT)
+    tx->state = ok ? TELEMETRY_TX_DONE : TELEMETRY_TX_FAIL;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Erase the next flash log sector when requested
+ * @param[in]      argument: Not used
+ *
+ * Task has low priority, erase starts when other tasks have nothing to do.
+ */
+static void prvTelemetryTask(void *argument)
+{
+  (void)argument;
+
+  for (;;)
+  {
+    osThreadFlagsWait(TELEMETRY_FLAG_PREPARE, osFlagsWaitAny, osWaitForever);
+
+    if (osMutexAcquire(telemetry.mutex, osWaitForever) != osOK)
+      continue;
+
+    if (!prvTelemetryFlashPrepare())
+      PrintfLogsCRLF(CLR_RD"Telemetry flash erase FAIL!"CLR_DEF);
+
+    osMutexRelease(telemetry.mutex);
+  }
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Send queued messages, oldest first, executed in timer task
+ * @param[in]      argument: Not used
+ *
+ * Messages are coalesced by MQTT client and sent in one TCP send at the end.
+ */
+static void prvTelemetryDrain(void *argument)
+{
+  TELEMETRY_POS_t pos;
+  const TELEMETRY_REC_t *rec;
+  uint32_t budget = TELEMETRY_DRAIN_BYTES;
+  uint32_t sent = 0;
+  uint32_t now;
+
+  (void)argument;
+
+  if (!MQTTClient_IsConnected())
+    return;
+
+  /* Do not block timer task while message is stored */
+  if (osMutexAcquire(telemetry.mutex, 0) != osOK)
+    return;
+
+  now = TimeSync_GetTime();
+
+  if (prvTelemetryRelease())
+  {
+    /* Skip messages still waiting for acknowledge */
+    rec = prvTelemetryFirst(&pos);
+    for (uint32_t i = 0; i < telemetry.tx_cnt && rec != NULL; i++)
+      rec = prvTelemetryNext(&pos);
+
+    while (rec != NULL && budget > 0 && telemetry.tx_cnt < TELEMETRY_TX_WINDOW)
+    {
+      TELEMETRY_TX_t *tx = &telemetry.tx[(telemetry.tx_head + telemetry.tx_cnt) % TELEMETRY_TX_WINDOW];
+      uint32_t size = prvTelemetryRecSize(rec);
+
+      tx->seq = rec->seq;
+
+      /* Age is unknown for messages stored before RTC time was available,
+       * signed age keeps messages when RTC was stepped backwards */
+      if (rec->time_s != 0 && now != 0 && (int32_t)(now - rec->time_s) > (int32_t)TELEMETRY_MAX_AGE_S)
+      {
+        telemetry.stat.expired++;
+        tx->state = TELEMETRY_TX_DONE;
+      }
+      else
+      {
+        char topic[TELEMETRY_BACKLOG_TOPIC_SIZE];
+
+        snprintf(topic, sizeof(topic), "backlog/%lu/%lu/%.*s", (unsigned long)rec->seq,
+                 (unsigned long)rec->time_s, (int)rec->topic_len, (const char *)(rec + 1));
+
+        tx->state = rec->ack ? TELEMETRY_TX_WAIT : TELEMETRY_TX_DONE;
+        if (!MQTTClient_Send(topic, (const uint8_t *)(rec + 1) + rec->topic_len, rec->len, rec->ack, tx))
+          break;
+
+        telemetry.stat.sent++;
+        sent++;
+        budget = size < budget ? budget - size : 0;
+      }
+
+      if (telemetry.tx_cnt == 0 && tx->state == TELEMETRY_TX_DONE)
+      {
+        /* Nothing is pending before it, release at once */
+        prvTelemetryPop(rec, pos.from_flash);
+        rec = prvTelemetryFirst(&pos);
+      }
+      else
+      {
+        telemetry.tx_cnt++;
+        rec = prvTelemetryNext(&pos);
+      }
+    }
+
+    prvTelemetryRelease();
+  }
+
+  osMutexRelease(telemetry.mutex);
+
+  if (sent > 0)
+    MQTTClient_Flush();
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Remove finished messages from queue head, in queue order
+ * @retval         bool: 'false' while failed message waits for the rest of window
+ *
+ * After failure window restarts from queue head once no acknowledge is pending,
+ * so late result never changes entry reused for another message.
+ */
+static bool prvTelemetryRelease(void)
+{
+  TELEMETRY_POS_t pos;
+
+  while (telemetry.tx_cnt > 0)
+  {
+    const TELEMETRY_REC_t *rec = prvTelemetryFirst(&pos);
+    TELEMETRY_TX_t *tx = &telemetry.tx[telemetry.tx_head];
+    /* Head record can be dropped by log overrun while it is sent */
+    bool lost = rec == NULL || rec->seq != tx->seq;
+
+    if (tx->state == TELEMETRY_TX_WAIT)
+      return !lost;
+
+    if (tx->state == TELEMETRY_TX_FAIL || lost)
+    {
+      for (uint32_t i = 1; i < telemetry.tx_cnt; i++)
+      {
+        if (telemetry.tx[(telemetry.tx_head + i) % TELEMETRY_TX_WINDOW].state == TELEMETRY_TX_WAIT)
+          return false;
+      }
+      telemetry.tx_cnt = 0;
+      return true;
+    }
+
+    prvTelemetryPop(rec, pos.from_flash);
+    telemetry.tx_head = (telemetry.tx_head + 1) % TELEMETRY_TX_WINDOW;
+    telemetry.tx_cnt--;
+  }
+
+  return true;
+}
+/******************************************************************************/
+
+
+
+
+static const TELEMETRY_REC_t *prvTelemetryFirst(TELEMETRY_POS_t *pos)
+{
+  if (telemetry.fl_rd != telemetry.fl_wr)
+  {
+    pos->addr = telemetry.fl_rd;
+    pos->from_flash = true;
+    return (const TELEMETRY_REC_t *)pos->addr;
+  }
+
+  if (telemetry.ram_rd != telemetry.ram_wr)
+  {
+    pos->addr = telemetry.ram_rd;
+    pos->from_flash = false;
+    return (const TELEMETRY_REC_t *)((uint8_t *)telemetry_ram + pos->addr);
+  }
+
+  return NULL;
+}
+/******************************************************************************/
+
+
+
+
+static const TELEMETRY_REC_t *prvTelemetryNext(TELEMETRY_POS_t *pos)
+{
+  if (pos->from_flash)
+  {
+    pos->addr = prvTelemetryFlashSkip(pos->addr + prvTelemetryRecSize((const TELEMETRY_REC_t *)pos->addr));
+    if (pos->addr != telemetry.fl_wr)
+      return (const TELEMETRY_REC_t *)pos->addr;
+
+    /* RAM buffer holds newer messages than flash log */
+    if (telemetry.ram_rd == telemetry.ram_wr)
+      return NULL;
+    pos->addr = telemetry.ram_rd;
+    pos->from_flash = false;
+  }
+  else
+  {
+    pos->addr += prvTelemetryRecSize((const TELEMETRY_REC_t *)((uint8_t *)telemetry_ram + pos->addr));
+    if (pos->addr == telemetry.ram_wr)
+      return NULL;
+  }
+
+  return (const TELEMETRY_REC_t *)((uint8_t *)telemetry_ram + pos->addr);
+}
+/******************************************************************************/
+
+
+
+
+static void prvTelemetryPop(const TELEMETRY_REC_t *rec, bool from_flash)
+{
+  uint32_t size = prvTelemetryRecSize(rec);
+
+  if (from_flash)
+  {
+    const uint32_t sent = TELEMETRY_REC_SENT;
+
+    Flash_Program(telemetry.fl_rd, &sent, 1);
+    telemetry.stat.flash_count--;
+    telemetry.fl_rd = prvTelemetryFlashSkip(telemetry.fl_rd + size);
+  }
+  else
+  {
+    telemetry.stat.ram_count--;
+    telemetry.ram_rd += size;
+    if (telemetry.ram_rd == telemetry.ram_wr)
+    {
+      telemetry.ram_rd = 0;
+      telemetry.ram_wr = 0;
+    }
+  }
+}
+/******************************************************************************/
+
+
+
+
+static void prvTelemetrySpill(void)
+{
+  uint32_t left;
+
+  while (telemetry.ram_rd != telemetry.ram_wr)
+  {
+    TELEMETRY_REC_t *rec = (TELEMETRY_REC_t *)((uint8_t *)telemetry_ram + telemetry.ram_rd);
+    uint32_t size = prvTelemetryRecSize(rec);
+    uint32_t addr;
+
+    /* Write position always stays inside sector */
+    if (prvTelemetrySectorEnd(telemetry.fl_wr) - telemetry.fl_wr <= size)
+    {
+      if (!telemetry.fl_spare)
+        break;
+      prvTelemetryFlashAdvance();
+    }
+
+    addr = telemetry.fl_wr;
+    telemetry.fl_wr += size;
+
+    if (Flash_Program(addr + sizeof(uint32_t), &rec->seq, size / sizeof(uint32_t) - 1)
+        && Flash_Program(addr, &rec->state, 1))
+    {
+      telemetry.stat.flash_count++;
+    }
+    else
+    {
+      PrintfLogsCRLF(CLR_RD"Telemetry flash write FAIL!"CLR_DEF);
+      telemetry.stat.dropped++;
+      if (telemetry.fl_rd == addr)
+        telemetry.fl_rd = telemetry.fl_wr;
+    }
+
+    telemetry.stat.ram_count--;
+    telemetry.ram_rd += size;
+  }
+
+  /* Messages not moved to flash stay at buffer start */
+  left = telemetry.ram_wr - telemetry.ram_rd;
+  if (left > 0)
+    memmove(telemetry_ram, (uint8_t *)telemetry_ram + telemetry.ram_rd, left);
+  telemetry.ram_rd = 0;
+  telemetry.ram_wr = left;
+
+  if (!telemetry.fl_spare && telemetry.task != NULL
+      && prvTelemetrySectorEnd(telemetry.fl_wr) - telemetry.fl_wr < TELEMETRY_PREPARE_MARGIN)
+    osThreadFlagsSet(telemetry.task, TELEMETRY_FLAG_PREPARE);
+}
+/******************************************************************************/
+
+
+
+
+static void prvTelemetryRecover(void)
+{
+  uint32_t sector_end[FLASH_LOG_SECTORS];
+  bool sector_dirty[FLASH_LOG_SECTORS];
+  uint32_t last_seq = 0;
+  uint32_t wr = 0;
+  bool found = false;
+
+  for (uint32_t s = 0; s < FLASH_LOG_SECTORS; s++)
+  {
+    uint32_t addr = FLASH_LOG_ADDR + s * FLASH_LOG_SECTOR_SIZE;
+    uint32_t end = addr + FLASH_LOG_SECTOR_SIZE;
+
+    sector_dirty[s] = false;
+
+    while (end - addr >= sizeof(TELEMETRY_REC_t))
+    {
+      const TELEMETRY_REC_t *rec = (const TELEMETRY_REC_t *)addr;
+
+      if (rec->state == TELEMETRY_REC_FREE && rec->len == TELEMETRY_LEN_FREE)
+        break;
+
+      if (!prvTelemetryRecCheck(rec))
+      {
+        sector_dirty[s] = true;
+        break;
+      }
+
+      if (rec->state == TELEMETRY_REC_VALID)
+        telemetry.stat.flash_count++;
+
+      if (!found || (int32_t)(rec->seq - last_seq) > 0)
+      {
+        last_seq = rec->seq;
+        wr = s;
+        found = true;
+      }
+
+      addr += prvTelemetryRecSize(rec);
+    }
+
+    sector_end[s] = addr;
+  }
+
+  if (!found)
+  {
+    /* Nothing valid, prepare clean log */
+    for (uint32_t s = 0; s < FLASH_LOG_SECTORS; s++)
+    {
+      if (sector_dirty[s] || sector_end[s] != FLASH_LOG_ADDR + s * FLASH_LOG_SECTOR_SIZE)
+        Flash_EraseSector(FLASH_LOG_SECTOR + s);
+    }
+
+    telemetry.fl_rd = FLASH_LOG_ADDR;
+    telemetry.fl_wr = FLASH_LOG_ADDR;
+    telemetry.stat.flash_count = 0;
+  }
+  else
+  {
+    /* Oldest records are in the sector after the one written last */
+    telemetry.fl_wr = sector_end[wr];
+    telemetry.fl_rd = prvTelemetryFlashSkip(
+        prvTelemetrySectorNext(FLASH_LOG_ADDR + wr * FLASH_LOG_SECTOR_SIZE));
+    telemetry.seq = last_seq + 1;
+
+    //Scheduler is not running yet, erase does not stall other tasks
+    if (sector_dirty[wr] && prvTelemetryFlashPrepare())
+      prvTelemetryFlashAdvance();
+  }
+
+  telemetry.fl_spare = prvTelemetryFlashPrepared();
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Erase sector after write sector, dropping messages stored there
+ * @retval         bool: 'true' if sector is erased
+ */
+static bool prvTelemetryFlashPrepare(void)
+{
+  uint32_t next = prvTelemetrySectorNext(telemetry.fl_wr);
+
+  if (telemetry.fl_spare)
+    return true;
+
+  if (telemetry.fl_rd != telemetry.fl_wr && prvTelemetrySectorEnd(telemetry.fl_rd) == prvTelemetrySectorEnd(next))
+  {
+    /* Log is full, the oldest sector is lost */
+    uint32_t addr = telemetry.fl_rd;
+    uint32_t end = prvTelemetrySectorEnd(addr);
+    uint32_t lost = 0;
+
+    while (end - addr >= sizeof(TELEMETRY_REC_t))
+    {
+      const TELEMETRY_REC_t *rec = (const TELEMETRY_REC_t *)addr;
+
+      if (!prvTelemetryRecCheck(rec))
+        break;
+      if (rec->state == TELEMETRY_REC_VALID)
+        lost++;
+      addr += prvTelemetryRecSize(rec);
+    }
+
+    telemetry.stat.dropped += lost;
+    telemetry.stat.flash_count -= lost < telemetry.stat.flash_count ? lost : telemetry.stat.flash_count;
+    telemetry.fl_rd = prvTelemetryFlashSkip(prvTelemetrySectorNext(next));
+    PrintfLogsCRLF(CLR_YL"Telemetry log full, %lu messages dropped"CLR_DEF, (unsigned long)lost);
+  }
+
+  if (!prvTelemetryFlashPrepared()
+      && !Flash_EraseSector(FLASH_LOG_SECTOR + (next - FLASH_LOG_ADDR) / FLASH_LOG_SECTOR_SIZE))
+    return false;
+
+  telemetry.fl_spare = true;
+  return true;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Check if sector after write sector holds no records
+ * @retval         bool: 'true' if sector is erased
+ */
+static bool prvTelemetryFlashPrepared(void)
+{
+  const TELEMETRY_REC_t *rec = (const TELEMETRY_REC_t *)prvTelemetrySectorNext(telemetry.fl_wr);
+
+  return rec->state == TELEMETRY_REC_FREE && rec->len == TELEMETRY_LEN_FREE;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Move write position to the next sector, it must be erased
+ */
+static void prvTelemetryFlashAdvance(void)
+{
+  uint32_t next = prvTelemetrySectorNext(telemetry.fl_wr);
+
+  if (telemetry.fl_rd == telemetry.fl_wr)
+    telemetry.fl_rd = next;
+  telemetry.fl_wr = next;
+  telemetry.fl_spare = false;
+}
+/******************************************************************************/
+
+
+
+
+static uint32_t prvTelemetryFlashSkip(uint32_t addr)
+{
+  uint32_t jumps = 0;
+
+  while (addr != telemetry.fl_wr)
+  {
+    const TELEMETRY_REC_t *rec = (const TELEMETRY_REC_t *)addr;
+
+    if (prvTelemetrySectorEnd(addr) - addr < sizeof(*rec) || !prvTelemetryRecCheck(rec))
+    {
+      if (++jumps > FLASH_LOG_SECTORS)
+        return telemetry.fl_wr;
+      addr = prvTelemetrySectorNext(addr);
+    }
+    else if (rec->state != TELEMETRY_REC_VALID)
+      addr += prvTelemetryRecSize(rec);
+    else
+      return addr;
+  }
+
+  return addr;
+}
+/******************************************************************************/
+
+
+
+
+static bool prvTelemetryRecCheck(const TELEMETRY_REC_t *rec)
+{
+  return rec->len <= TELEMETRY_DATA_SIZE && rec->topic_len > 0
+         && rec->topic_len <= TELEMETRY_TOPIC_SIZE;
+}
+/******************************************************************************/
+
+
+
+
+static uint32_t prvTelemetryRecSize(const TELEMETRY_REC_t *rec)
+{
+  return TELEMETRY_ALIGN(sizeof(*rec) + rec->topic_len + rec->len);
+}
+/******************************************************************************/
+
+
+
+
+static uint32_t prvTelemetrySectorEnd(uint32_t addr)
+{
+  return FLASH_LOG_ADDR + ((addr - FLASH_LOG_ADDR) / FLASH_LOG_SECTOR_SIZE + 1) * FLASH_LOG_SECTOR_SIZE;
+}
+/******************************************************************************/
+
+
+
+
+static uint32_t prvTelemetrySectorNext(uint32_t addr)
+{
+  uint32_t end = prvTelemetrySectorEnd(addr);
+
+  return end >= TELEMETRY_FLASH_END ? FLASH_LOG_ADDR : end;
+}
+/******************************************************************************/
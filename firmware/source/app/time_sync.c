@@ -0,0 +1,541 @@
+/**
+ ******************************************************************************
+ * @file           : time_sync.c
+ * @author         : Aleksandr Shabalin       <alexnv97@gmail.com>
+ * @brief          : DS3231 RTC synchronization with SNTP and drift correction
+ ******************************************************************************
+ * ----------------- Copyright (c) 2023 Aleksandr Shabalin------------------- *
+ ******************************************************************************
+ ******************************************************************************
+ *
+ * SNTP and RTC report whole seconds only, so both are sampled on the second
+ * change and compared on system tick base, offset is known to tens of ms.
+ * RTC is written on the next SNTP second change, writing seconds restarts
+ * DS3231 countdown chain.
+ *
+ * Offset accumulated since previous sync gives drift of RTC oscillator,
+ * it is compensated by aging offset register. Sync interval is doubled
+ * while offset stays small, RTC keeps time between syncs and time is read
+ * without network round trip.
+ *
+ * Sync takes a few seconds of polling, it runs in own low priority task
+ * requested by WiFi station task, which keeps supervising the link.
+ */
+
+
+/******************************************************************************/
+/* Includes ----------------------------------------------------------------- */
+/******************************************************************************/
+#include "time_sync.h"
+
+#include "esp/esp.h"
+#include "esp/esp_sntp.h"
+
+#include "rtc.h"
+#include "rtc_i2c.h"
+#include "log.h"
+#include "mem_layout.h"
+
+
+/******************************************************************************/
+/* Private defines ---------------------------------------------------------- */
+/******************************************************************************/
+#define TIME_SYNC_SERVER_1           "pool.ntp.org"
+#define TIME_SYNC_SERVER_2           "time.google.com"
+
+/* Time before this year is reported by ESP until SNTP is synchronized */
+#define TIME_SYNC_YEAR_MIN           (2023u)
+
+#define TIME_SYNC_INTERVAL_MIN_S     (3600u)
+#define TIME_SYNC_INTERVAL_MAX_S     (7u * 24u * 3600u)
+#define TIME_SYNC_RETRY_S            (60u)
+/* Offset below this doubles sync interval, above 4x of it resets interval */
+#define TIME_SYNC_STABLE_MS          (250)
+/* Shortest interval for drift estimate, sampling error is ~50 ms */
+#define TIME_SYNC_DRIFT_MIN_S        (12u * 3600u)
+/* Offset larger than this is RTC set by hand or lost, not drift */
+#define TIME_SYNC_DRIFT_MAX_MS       (60000)
+/* DS3231 aging offset step at 25 C */
+#define TIME_SYNC_AGING_PPB          (100)
+
+#define TIME_SYNC_EDGE_TIMEOUT_MS    (1500u)
+/* SNTP time is read by AT command, do not keep ESP busy while polling */
+#define TIME_SYNC_SNTP_POLL_MS       (50u)
+#define TIME_SYNC_RTC_RETRY_MS       (10000u)
+#define TIME_SYNC_RTC_RELOAD_MS      (3600u * 1000u)
+
+#define TIME_SYNC_DAY_S              (86400u)
+
+#define TIME_SYNC_FLAG_REQUEST       (0x0001u)
+
+
+/******************************************************************************/
+/* Private variables -------------------------------------------------------- */
+/******************************************************************************/
+typedef struct
+{
+  osThreadId_t task;
+  bool configured;
+  bool aging_read;
+  bool time_valid;
+  uint32_t time_s;
+  uint32_t time_tick;
+  uint32_t rtc_try_tick;
+  uint32_t next_tick;
+  uint32_t last_sync_s;
+  TIME_SYNC_STAT_t stat;
+} TIME_SYNC_t;
+
+MEM_CCMRAM_THREAD(TimeSyncTask, 256 * 4);
+
+const osThreadAttr_t TimeSyncTask_attr =
+{
+  .name = "TimeSyncTask",
+  MEM_CCMRAM_THREAD_ATTR(TimeSyncTask),
+  .priority = (osPriority_t) osPriorityLow,
+};
+
+static TIME_SYNC_t time_sync;
+
+
+/******************************************************************************/
+/* Private function prototypes ---------------------------------------------- */
+/******************************************************************************/
+static void prvTimeSyncTask(void *argument);
+static void prvTimeSyncProcess(void);
+static bool prvTimeSyncSntpEdge(uint32_t *epoch, uint32_t *tick);
+static bool prvTimeSyncRtcEdge(uint32_t *epoch, uint32_t *tick);
+static bool prvTimeSyncRtcWrite(uint32_t epoch);
+static void prvTimeSyncSet(uint32_t time_s, uint32_t tick);
+static void prvTimeSyncDrift(int32_t offset_ms, uint32_t now_s);
+static uint32_t prvTimeSyncEpoch(uint16_t year, uint8_t month, uint8_t date,
+                                 uint8_t hours, uint8_t minutes, uint8_t seconds);
+static void prvTimeSyncCivil(uint32_t epoch, RTC_DATE_t *date, RTC_TIME_t *time);
+
+
+/******************************************************************************/
+
+
+/**
+ * @brief          Start synchronization task
+ */
+void TimeSync_Init(void)
+{
+  if (time_sync.task == NULL)
+    time_sync.task = osThreadNew(prvTimeSyncTask, NULL, &TimeSyncTask_attr);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Request synchronization, called from WiFi station task
+ *                 while internet connection is available
+ *
+ * Does not block, RTC is synchronized by own task when it is due.
+ */
+void TimeSync_Request(void)
+{
+  if (time_sync.task != NULL)
+    osThreadFlagsSet(time_sync.task, TIME_SYNC_FLAG_REQUEST);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Load time from RTC when it is unknown or loaded an hour ago,
+ *                 called from RTC task
+ *
+ * RTC is read again hourly so tick clock error does not accumulate.
+ */
+void TimeSync_LoadRtc(void)
+{
+  RTC_DATE_t date;
+  RTC_TIME_t time;
+  uint32_t now = osKernelGetTickCount();
+  uint32_t prev_tick;
+  bool prev_valid;
+  int32_t lock;
+
+  lock = osKernelLock();
+  prev_valid = time_sync.time_valid;
+  prev_tick = time_sync.time_tick;
+  osKernelRestoreLock(lock);
+
+  if ((prev_valid && now - prev_tick < TIME_SYNC_RTC_RELOAD_MS)
+      || (time_sync.rtc_try_tick != 0 && now - time_sync.rtc_try_tick < TIME_SYNC_RTC_RETRY_MS))
+    return;
+
+  time_sync.rtc_try_tick = now;
+
+  //Date and time in one read, midnight between them gives a day of error
+  if (RtcI2cGetDateTime(&date, &time) == RTC_OK && date.year >= TIME_SYNC_YEAR_MIN)
+  {
+    uint32_t time_s = prvTimeSyncEpoch(date.year, date.month, date.date,
+                                       time.hours, time.minutes, time.seconds);
+
+    lock = osKernelLock();
+    //SNTP sync finished meanwhile is more accurate than RTC seconds
+    if (time_sync.time_valid == prev_valid && time_sync.time_tick == prev_tick)
+    {
+      time_sync.time_s = time_s;
+      time_sync.time_tick = now;
+      time_sync.time_valid = true;
+    }
+    osKernelRestoreLock(lock);
+  }
+
+  RtcI2cSetMode(RTC_I2C_IDLE);
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Get current time, does not access RTC
+ * @retval         uint32_t: Seconds since 1970-01-01 UTC, 0 if time is unknown
+ *
+ * Time loaded from RTC or SNTP is counted by system tick in between.
+ */
+uint32_t TimeSync_GetTime(void)
+{
+  uint32_t time_s, time_tick;
+  bool time_valid;
+  int32_t lock;
+
+  lock = osKernelLock();
+  time_valid = time_sync.time_valid;
+  time_s = time_sync.time_s;
+  time_tick = time_sync.time_tick;
+  osKernelRestoreLock(lock);
+
+  if (!time_valid)
+    return 0;
+
+  return time_s + (osKernelGetTickCount() - time_tick) / 1000u;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Get synchronization statistics
+ * @param[out]     stat: Output statistics
+ */
+void TimeSync_GetStat(TIME_SYNC_STAT_t *stat)
+{
+  *stat = time_sync.stat;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Synchronization task, sleeps until it is requested
+ * @param[in]      argument: Not used
+ */
+static void prvTimeSyncTask(void *argument)
+{
+  (void)argument;
+
+  for (;;)
+  {
+    osThreadFlagsWait(TIME_SYNC_FLAG_REQUEST, osFlagsWaitAny, osWaitForever);
+    prvTimeSyncProcess();
+  }
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Synchronize RTC with SNTP when it is due
+ */
+static void prvTimeSyncProcess(void)
+{
+  uint32_t ntp_s, ntp_tick;
+  uint32_t rtc_s, rtc_tick;
+  uint32_t elapsed;
+  int32_t offset_ms = 0;
+  bool rtc_read;
+
+  if (time_sync.next_tick != 0 && (int32_t)(osKernelGetTickCount() - time_sync.next_tick) < 0)
+    return;
+
+  time_sync.next_tick = osKernelGetTickCount() + TIME_SYNC_RETRY_S * 1000u;
+
+  if (!time_sync.configured)
+  {
+    if (esp_sntp_configure(1, 0, TIME_SYNC_SERVER_1, TIME_SYNC_SERVER_2, NULL, NULL, NULL, 1) != espOK)
+      return;
+
+    time_sync.configured = true;
+    time_sync.stat.interval_s = TIME_SYNC_INTERVAL_MIN_S;
+  }
+
+  //Read failure leaves aging unknown, it is read again on the next sync
+  if (!time_sync.aging_read)
+  {
+    int8_t aging;
+
+    if (RtcI2cGetAging(&aging) == RTC_OK)
+    {
+      time_sync.stat.aging = aging;
+      time_sync.aging_read = true;
+    }
+    RtcI2cSetMode(RTC_I2C_IDLE);
+  }
+
+  if (!prvTimeSyncSntpEdge(&ntp_s, &ntp_tick))
+    return;
+
+  rtc_read = prvTimeSyncRtcEdge(&rtc_s, &rtc_tick);
+  if (rtc_read)
+  {
+    //Both clocks mapped to the same tick
+    int64_t diff = ((int64_t)rtc_s - (int64_t)ntp_s) * 1000 - (int32_t)(rtc_tick - ntp_tick);
+
+    if (diff > TIME_SYNC_DRIFT_MAX_MS || diff < -TIME_SYNC_DRIFT_MAX_MS)
+      rtc_read = false;
+    else
+      offset_ms = (int32_t)diff;
+  }
+
+  if (rtc_read)
+  {
+    prvTimeSyncDrift(offset_ms, ntp_s);
+  }
+  else
+  {
+    time_sync.stat.interval_s = TIME_SYNC_INTERVAL_MIN_S;
+    time_sync.last_sync_s = 0;
+  }
+
+  //Write RTC on the next SNTP second change
+  elapsed = (osKernelGetTickCount() - ntp_tick) / 1000u + 1u;
+  ntp_s += elapsed;
+  osDelayUntil(ntp_tick + elapsed * 1000u);
+
+  if (prvTimeSyncRtcWrite(ntp_s))
+  {
+    time_sync.last_sync_s = ntp_s;
+  }
+  else
+  {
+    PrintfLogsCRLF(CLR_RD"RTC write FAIL!"CLR_DEF);
+    time_sync.last_sync_s = 0;
+  }
+
+  prvTimeSyncSet(ntp_s, osKernelGetTickCount());
+
+  time_sync.stat.syncs++;
+  time_sync.stat.offset_ms = offset_ms;
+  time_sync.next_tick = osKernelGetTickCount() + time_sync.stat.interval_s * 1000u;
+
+  PrintfLogsCRLF(CLR_GR"RTC synchronized, offset %ld ms, drift %ld ppb, aging %d, next sync in %lu s"CLR_DEF,
+                 (long)offset_ms, (long)time_sync.stat.drift_ppb, (int)time_sync.stat.aging,
+                 (unsigned long)time_sync.stat.interval_s);
+}
+/******************************************************************************/
+
+
+
+
+static bool prvTimeSyncSntpEdge(uint32_t *epoch, uint32_t *tick)
+{
+  esp_datetime_t dt;
+  uint32_t start = osKernelGetTickCount();
+  uint32_t first, now;
+
+  if (esp_sntp_gettime(&dt, NULL, NULL, 1) != espOK || dt.year < TIME_SYNC_YEAR_MIN)
+    return false;
+
+  first = prvTimeSyncEpoch(dt.year, dt.month, dt.date, dt.hours, dt.minutes, dt.seconds);
+
+  do
+  {
+    osDelay(TIME_SYNC_SNTP_POLL_MS);
+    if (esp_sntp_gettime(&dt, NULL, NULL, 1) != espOK)
+      return false;
+
+    now = prvTimeSyncEpoch(dt.year, dt.month, dt.date, dt.hours, dt.minutes, dt.seconds);
+  }
+  while (now == first && osKernelGetTickCount() - start < TIME_SYNC_EDGE_TIMEOUT_MS);
+
+  if (now == first)
+    return false;
+
+  *epoch = now;
+  *tick = osKernelGetTickCount();
+
+  return true;
+}
+/******************************************************************************/
+
+
+
+
+static bool prvTimeSyncRtcEdge(uint32_t *epoch, uint32_t *tick)
+{
+  RTC_DATE_t date;
+  RTC_TIME_t time;
+  uint32_t start = osKernelGetTickCount();
+  uint8_t first;
+  bool res = false;
+
+  if (RtcI2cGetTime(&time) != RTC_OK)
+    goto exit;
+
+  first = time.seconds;
+
+  do
+  {
+    osDelay(1);
+    if (RtcI2cGetTime(&time) != RTC_OK)
+      goto exit;
+  }
+  while (time.seconds == first && osKernelGetTickCount() - start < TIME_SYNC_EDGE_TIMEOUT_MS);
+
+  *tick = osKernelGetTickCount();
+
+  //Date is read after edge, midnight is at least ~1 s away
+  if (time.seconds == first || RtcI2cGetDate(&date) != RTC_OK)
+    goto exit;
+
+  *epoch = prvTimeSyncEpoch(date.year, date.month, date.date, time.hours, time.minutes, time.seconds);
+  res = true;
+
+exit:
+  RtcI2cSetMode(RTC_I2C_IDLE);
+  return res;
+}
+/******************************************************************************/
+
+
+
+
+static bool prvTimeSyncRtcWrite(uint32_t epoch)
+{
+  RTC_DATE_t date;
+  RTC_TIME_t time;
+  bool res;
+
+  prvTimeSyncCivil(epoch, &date, &time);
+
+  res = RtcI2cSetDateTime(&date, &time) == RTC_OK;
+
+  RtcI2cSetMode(RTC_I2C_IDLE);
+  return res;
+}
+/******************************************************************************/
+
+
+
+
+static void prvTimeSyncSet(uint32_t time_s, uint32_t tick)
+{
+  //Pair is read by other tasks, update it at once
+  int32_t lock = osKernelLock();
+
+  time_sync.time_s = time_s;
+  time_sync.time_tick = tick;
+  time_sync.time_valid = true;
+  osKernelRestoreLock(lock);
+}
+/******************************************************************************/
+
+
+
+
+static void prvTimeSyncDrift(int32_t offset_ms, uint32_t now_s)
+{
+  int32_t offset_abs = offset_ms < 0 ? -offset_ms : offset_ms;
+
+  if (time_sync.last_sync_s != 0 && now_s - time_sync.last_sync_s >= TIME_SYNC_DRIFT_MIN_S)
+  {
+    int32_t step;
+    int32_t aging;
+
+    time_sync.stat.drift_ppb = (int32_t)((int64_t)offset_ms * 1000000 / (int64_t)(now_s - time_sync.last_sync_s));
+
+    //RTC running fast has positive offset, larger aging slows it down
+    step = (time_sync.stat.drift_ppb + (time_sync.stat.drift_ppb < 0 ? -TIME_SYNC_AGING_PPB / 2 : TIME_SYNC_AGING_PPB / 2))
+           / TIME_SYNC_AGING_PPB;
+    aging = time_sync.stat.aging + step;
+
+    if (aging > INT8_MAX)
+      aging = INT8_MAX;
+    else if (aging < INT8_MIN)
+      aging = INT8_MIN;
+
+    //Step is relative to register value, nothing is written until it is known
+    if (time_sync.aging_read && aging != time_sync.stat.aging
+        && RtcI2cSetAging((int8_t)aging) == RTC_OK)
+      time_sync.stat.aging = (int8_t)aging;
+
+    RtcI2cSetMode(RTC_I2C_IDLE);
+  }
+
+  if (offset_abs <= TIME_SYNC_STABLE_MS)
+  {
+    time_sync.stat.interval_s *= 2u;
+    if (time_sync.stat.interval_s > TIME_SYNC_INTERVAL_MAX_S)
+      time_sync.stat.interval_s = TIME_SYNC_INTERVAL_MAX_S;
+  }
+  else if (offset_abs > 4 * TIME_SYNC_STABLE_MS)
+  {
+    time_sync.stat.interval_s = TIME_SYNC_INTERVAL_MIN_S;
+  }
+}
+/******************************************************************************/
+
+
+
+
+static uint32_t prvTimeSyncEpoch(uint16_t year, uint8_t month, uint8_t date,
+                                 uint8_t hours, uint8_t minutes, uint8_t seconds)
+{
+  uint32_t y = year - (month <= 2u ? 1u : 0u);
+  uint32_t era = y / 400u;
+  uint32_t yoe = y - era * 400u;
+  uint32_t doy = (153u * (month > 2u ? month - 3u : month + 9u) + 2u) / 5u + date - 1u;
+  uint32_t doe = yoe * 365u + yoe / 4u - yoe / 100u + doy;
+  uint32_t days = era * 146097u + doe - 719468u;
+
+  return days * TIME_SYNC_DAY_S + hours * 3600u + minutes * 60u + seconds;
+}
+/******************************************************************************/
+
+
+
+
+static void prvTimeSyncCivil(uint32_t epoch, RTC_DATE_t *date, RTC_TIME_t *time)
+{
+  uint32_t days = epoch / TIME_SYNC_DAY_S + 719468u;
+  uint32_t secs = epoch % TIME_SYNC_DAY_S;
+  uint32_t era = days / 146097u;
+  uint32_t doe = days - era * 146097u;
+  uint32_t yoe = (doe - doe / 1460u + doe / 36524u - doe / 146096u) / 365u;
+  uint32_t doy = doe - (365u * yoe + yoe / 4u - yoe / 100u);
+  uint32_t mp = (5u * doy + 2u) / 153u;
+  uint32_t month = mp < 10u ? mp + 3u : mp - 9u;
+
+  date->date = doy - (153u * mp + 2u) / 5u + 1u;
+  date->month = month;
+  date->year = (yoe + era * 400u + (month <= 2u ? 1u : 0u)) % 100u;
+  //1970-01-01 was Thursday, Monday is day 1
+  date->day = (epoch / TIME_SYNC_DAY_S + 3u) % 7u + 1u;
+
+  time->hours = secs / 3600u;
+  time->minutes = secs / 60u % 60u;
+  time->seconds = secs % 60u;
+  time->ms = 0;
+}
+/******************************************************************************/
@@ -0,0 +1,146 @@
+/**
+ ******************************************************************************
+ * @file           : flash.c
+ * @author         : Aleksandr Shabalin       <alexnv97@gmail.com>
+ * @brief          : Internal flash erase and program driver
+ ******************************************************************************
+ * ----------------- Copyright (c) 2023 Aleksandr Shabalin------------------- *
+ ******************************************************************************
+ ******************************************************************************
+ */
+
+/******************************************************************************/
+/* Includes ----------------------------------------------------------------- */
+/******************************************************************************/
+#include "stm32f4xx.h"
+
+#include "flash.h"
+
+
+/******************************************************************************/
+/* Private defines ---------------------------------------------------------- */
+/******************************************************************************/
+#define FLASH_KEY1                   (0x45670123u)
+#define FLASH_KEY2                   (0xCDEF89ABu)
+
+#define FLASH_SR_ERRORS              (FLASH_SR_OPERR | FLASH_SR_WRPERR | FLASH_SR_PGAERR | \
+                                      FLASH_SR_PGPERR | FLASH_SR_PGSERR)
+
+
+/******************************************************************************/
+/* Private function prototypes ---------------------------------------------- */
+/******************************************************************************/
+static void prvFlashUnlock(void);
+static void prvFlashLock(void);
+static bool prvFlashWait(void);
+
+
+/******************************************************************************/
+
+
+/**
+ * @brief          Erase one flash sector
+ * @param[in]      sector: Sector number
+ * @retval         bool: 'true' if sector was erased
+ *
+ * CPU is stalled on flash fetch until erase ends, 128 KB sector takes 1-2 s.
+ */
+bool Flash_EraseSector(uint8_t sector)
+{
+  bool res;
+
+  prvFlashUnlock();
+
+  FLASH->CR &= ~(FLASH_CR_PSIZE | FLASH_CR_SNB);
+  FLASH->CR |= FLASH_CR_PSIZE_1 | ((uint32_t)sector << FLASH_CR_SNB_Pos) | FLASH_CR_SER;
+  FLASH->CR |= FLASH_CR_STRT;
+  res = prvFlashWait();
+  FLASH->CR &= ~(FLASH_CR_SER | FLASH_CR_SNB);
+
+  /* Data cache may still hold erased lines */
+  FLASH->ACR &= ~FLASH_ACR_DCEN;
+  FLASH->ACR |= FLASH_ACR_DCRST;
+  FLASH->ACR &= ~FLASH_ACR_DCRST;
+  FLASH->ACR |= FLASH_ACR_DCEN;
+
+  prvFlashLock();
+
+  return res;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Program words to erased flash
+ * @param[in]      addr: Word aligned flash address
+ * @param[in]      data: Words to program
+ * @param[in]      words: Number of words
+ * @retval         bool: 'true' if all words were programmed
+ */
+bool Flash_Program(uint32_t addr, const uint32_t *data, uint32_t words)
+{
+  bool res = true;
+
+  prvFlashUnlock();
+
+  FLASH->CR &= ~FLASH_CR_PSIZE;
+  FLASH->CR |= FLASH_CR_PSIZE_1 | FLASH_CR_PG;
+
+  for (uint32_t i = 0; i < words && res; i++)
+  {
+    *(volatile uint32_t *)(addr + i * sizeof(uint32_t)) = data[i];
+    __DSB();
+    res = prvFlashWait();
+  }
+
+  FLASH->CR &= ~FLASH_CR_PG;
+
+  prvFlashLock();
+
+  return res;
+}
+/******************************************************************************/
+
+
+
+
+static void prvFlashUnlock(void)
+{
+  if (FLASH->CR & FLASH_CR_LOCK)
+  {
+    FLASH->KEYR = FLASH_KEY1;
+    FLASH->KEYR = FLASH_KEY2;
+  }
+
+  prvFlashWait();
+  FLASH->SR = FLASH_SR_EOP | FLASH_SR_ERRORS;
+}
+/******************************************************************************/
+
+
+
+
+static void prvFlashLock(void)
+{
+  FLASH->CR |= FLASH_CR_LOCK;
+}
+/******************************************************************************/
+
+
+
+
+static bool prvFlashWait(void)
+{
+  while (FLASH->SR & FLASH_SR_BSY);
+
+  if (FLASH->SR & FLASH_SR_ERRORS)
+  {
+    FLASH->SR = FLASH_SR_ERRORS;
+    return false;
+  }
+
+  return true;
+}
+/******************************************************************************/
@@ -19,6 +19,12 @@
 #include "esp/system/esp_ll.h"
 #include "esp/esp_sta.h"
 #include "esp/esp_private.h"
+#include "esp/esp_mem.h"
+#include "esp/esp_mempool.h"
+
+#include "mqtt_client.h"
+#include "telemetry.h"
+#include "config.h"
 
 
 /******************************************************************************/
@@ -38,12 +44,15 @@
 #define _CMD_TIME                   "time"
 
 #define _CMD_WIFI                   "wifi"
+#define _CMD_MEM                    "mem"
+#define _CMD_LOCK                   "lock"
+#define _CMD_MQTT                   "mqtt"
 
 /* Arguments for set/clear */
 #define _SCMD_RD                    "?"
 #define _SCMD_SAVE                  "save"
 
-#define _NUM_OF_CMD                 9
+#define _NUM_OF_CMD                 11
 #define _NUM_OF_SETCLEAR_SCMD       2
 
 #if MICRORL_CFG_USE_ECHO_OFF
@@ -67,7 +76,7 @@ microrl_t microrl;
 microrl_t *microrl_ptr = &microrl;
 
 char *keyword[] = {_CMD_HELP, _CMD_CLEAR, _CMD_LOGIN, _CMD_LOGOUT
-        , _CMD_CALENDAR, _CMD_DATE, _CMD_BACK, _CMD_TIME};    //available  commands
+        , _CMD_CALENDAR, _CMD_DATE, _CMD_BACK, _CMD_TIME, _CMD_MEM, _CMD_LOCK, _CMD_MQTT};    //available  commands
 
 char *read_save_key[] = {_SCMD_RD, _SCMD_SAVE};            // 'read/save' command arguments
 char *compl_word [_NUM_OF_CMD + 1];                        // array for completion
@@ -84,6 +93,9 @@ bool esp8266_update;
 void prvConsoleClearScreenSimple(microrl_t *microrl_ptr);
 static void prvConsolePrint(microrl_t *microrl_ptr, const char *str);
 void prvConsolePrintCalendar(void);
+static void prvConsolePrintMemStat(void);
+static void prvConsolePrintLockStat(void);
+static void prvConsolePrintMqttStat(void);
 
 
 /******************************************************************************/
@@ -218,6 +230,18 @@ int ConsoleExecute(microrl_t *microrl_ptr, int argc, const char * const *argv) {
       Console_WIFiPrintMenu();
       microrl_set_execute_callback(microrl_ptr, ConsoleWiFi);
     }
+    else if (strcmp(argv[i], _CMD_MEM) == CONSOLE_MATCH)
+    {
+      prvConsolePrintMemStat();
+    }
+    else if (strcmp(argv[i], _CMD_LOCK) == CONSOLE_MATCH)
+    {
+      prvConsolePrintLockStat();
+    }
+    else if (strcmp(argv[i], _CMD_MQTT) == CONSOLE_MATCH)
+    {
+      prvConsolePrintMqttStat();
+    }
     else
     {
       ConsoleError();
@@ -558,6 +582,9 @@ void ConsolePrintHelp(void)
   PrintfConsoleCRLF("\tlogout              - end session");
   PrintfConsoleCRLF("\tcalendar            - calendar config menu");
   PrintfConsoleCRLF("\twifi                - start wifi");
+  PrintfConsoleCRLF("\tmem                 - ESP memory statistics");
+  PrintfConsoleCRLF("\tlock                - ESP lock contention statistics");
+  PrintfConsoleCRLF("\tmqtt                - MQTT client statistics");
 
 #if MICRORL_CFG_USE_COMPLETE
   PrintfConsoleCRLF("Use TAB key for completion");
@@ -633,6 +660,130 @@ void prvConsolePrintCalendar(void)
 
 
 
+/**
+ * @brief          Print ESP heap and memory pools statistics
+ */
+static void prvConsolePrintMemStat(void)
+{
+#if ESP_CFG_MEM_STAT
+  static const char *tag_names[ESP_MEM_TAG_END] = {"none", "pbuf", "msg", "conn buff", "timeout"};
+  esp_mem_stat_t mem_stat;
+
+  esp_mem_get_stat(&mem_stat);
+
+  PrintfConsoleCRLF("");
+  PrintfConsoleCRLF("\t"CLR_GR"ESP heap:"CLR_DEF);
+  PrintfConsoleCRLF("\ttotal %u, free %u, min free %u", (unsigned)mem_stat.total, (unsigned)mem_stat.free,
+                    (unsigned)mem_stat.min_free);
+  PrintfConsoleCRLF("\tlargest free block %u, free blocks %u", (unsigned)mem_stat.largest_free,
+                    (unsigned)mem_stat.free_blocks);
+  PrintfConsoleCRLF("\tallocs %lu, frees %lu, fails %lu (last %u bytes)", (unsigned long)mem_stat.alloc_cnt,
+                    (unsigned long)mem_stat.free_cnt, (unsigned long)mem_stat.fail_cnt, (unsigned)mem_stat.last_fail_size);
+
+  PrintfConsoleCRLF("\t"CLR_GR"Allocation sizes:"CLR_DEF);
+  for (uint8_t i = 0; i < ESP_MEM_STAT_HIST_LEN; i++)
+  {
+    if (i < ESP_MEM_STAT_HIST_LEN - 1)
+    {
+      PrintfConsoleCRLF("\t<= %4u: %lu", (unsigned)(16u << i), (unsigned long)mem_stat.hist[i]);
+    }
+    else
+    {
+      PrintfConsoleCRLF("\t>  %4u: %lu", (unsigned)(16u << (i - 1)), (unsigned long)mem_stat.hist[i]);
+    }
+  }
+
+#if ESP_CFG_MEM_STAT_TAG
+  PrintfConsoleCRLF("\t"CLR_GR"Usage by type (bytes / max / blocks):"CLR_DEF);
+  for (uint8_t i = 0; i < ESP_MEM_TAG_END; i++)
+  {
+    PrintfConsoleCRLF("\t%-10s %u / %u / %u", tag_names[i], (unsigned)mem_stat.tags[i].bytes,
+                      (unsigned)mem_stat.tags[i].max_bytes, (unsigned)mem_stat.tags[i].blocks);
+  }
+#else
+  UNUSED(tag_names);
+#endif /* ESP_CFG_MEM_STAT_TAG */
+#endif /* ESP_CFG_MEM_STAT */
+
+  static const char *pool_names[ESP_MEMPOOL_END] = {"pbuf", "pbuf small", "msg", "timeout"};
+  esp_mempool_stat_t pool_stat;
+
+  PrintfConsoleCRLF("\t"CLR_GR"Memory pools (used / max / num, heap fallbacks):"CLR_DEF);
+  for (uint8_t i = 0; i < ESP_MEMPOOL_END; i++)
+  {
+    esp_mempool_get_stat((esp_mempool_id_t)i, &pool_stat);
+    PrintfConsoleCRLF("\t%-10s %u / %u / %u, %u", pool_names[i], (unsigned)pool_stat.used,
+                      (unsigned)pool_stat.max_used, (unsigned)pool_stat.num, (unsigned)pool_stat.fallback);
+  }
+  PrintfConsoleCRLF("");
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Print ESP lock contention statistics
+ */
+static void prvConsolePrintLockStat(void)
+{
+#if ESP_CFG_LOCK_STAT
+  static const char *lock_names[ESP_LOCK_END] = {"core", "timeout", "mem"};
+  esp_lock_stat_t lock_stat;
+
+  PrintfConsoleCRLF("");
+  PrintfConsoleCRLF("\t"CLR_GR"ESP locks (acquired / contended, wait total / max ms):"CLR_DEF);
+  for (uint8_t i = 0; i < ESP_LOCK_END; i++)
+  {
+    esp_lock_get_stat((esp_lock_id_t)i, &lock_stat);
+    PrintfConsoleCRLF("\t%-10s %lu / %lu, %lu / %lu", lock_names[i], (unsigned long)lock_stat.acquired,
+                      (unsigned long)lock_stat.contended, (unsigned long)lock_stat.wait_total,
+                      (unsigned long)lock_stat.wait_max);
+  }
+  PrintfConsoleCRLF("");
+#else
+  PrintfConsoleCRLF("\tLock statistics are disabled");
+#endif /* ESP_CFG_LOCK_STAT */
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Print MQTT client statistics
+ */
+static void prvConsolePrintMqttStat(void)
+{
+  esp_mqtt_client_stat_t mqtt_stat;
+  TELEMETRY_STAT_t tlm_stat;
+
+  MQTTClient_GetStat(&mqtt_stat);
+  Telemetry_GetStat(&tlm_stat);
+
+  PrintfConsoleCRLF("");
+  PrintfConsoleCRLF("\t"CLR_GR"MQTT client (%s):"CLR_DEF, MQTTClient_IsConnected() ? "connected" : "disconnected");
+  PrintfConsoleCRLF("\tpublish sent %lu, acked %lu, failed %lu, received %lu",
+                    (unsigned long)mqtt_stat.pub_sent, (unsigned long)mqtt_stat.pub_acked,
+                    (unsigned long)mqtt_stat.pub_failed, (unsigned long)mqtt_stat.pub_recv);
+  PrintfConsoleCRLF("\tTCP sends %lu, bytes %lu, rate %lu msg/s", (unsigned long)mqtt_stat.tcp_sends,
+                    (unsigned long)mqtt_stat.tx_bytes, (unsigned long)mqtt_stat.pub_rate);
+  PrintfConsoleCRLF("\t%s, connects %lu, link %lu ms, CONNACK %lu ms, ESP SSL buffer %u bytes",
+                    config.mqtt.tls ? "TLS" : "TCP", (unsigned long)mqtt_stat.connects,
+                    (unsigned long)mqtt_stat.link_time, (unsigned long)mqtt_stat.connack_time,
+                    (unsigned)MQTTClient_GetSslBufferSize());
+  PrintfConsoleCRLF("\tqueued RAM %lu, flash %lu, stored %lu, sent %lu, expired %lu, dropped %lu, seq %lu",
+                    (unsigned long)tlm_stat.ram_count, (unsigned long)tlm_stat.flash_count,
+                    (unsigned long)tlm_stat.stored, (unsigned long)tlm_stat.sent,
+                    (unsigned long)tlm_stat.expired, (unsigned long)tlm_stat.dropped,
+                    (unsigned long)tlm_stat.seq);
+  PrintfConsoleCRLF("");
+}
+/******************************************************************************/
+
+
+
+
 /**
  * @brief          Set help print function
  */
@@ -16,6 +16,8 @@
 
 #include "stm32f4xx_ll_dma.h"
 
+#include "mem_layout.h"
+
 #if    !WIFI_USE_LWESP
 #include "esp/system/esp_ll.h"
 #include "esp/esp_sta.h"
@@ -38,15 +40,18 @@ osThreadId_t TxTaskHandle;
 
 osMessageQueueId_t uartRxQueueHandle;
 
+MEM_CCMRAM_THREAD(RxTask, 256 * 4);
+MEM_CCMRAM_THREAD(TxTask, 256 * 4);
+
 const osThreadAttr_t RxTask_attributes = {
       .name = "RxTask",
-      .stack_size = 256 * 4,
+      MEM_CCMRAM_THREAD_ATTR(RxTask),
       .priority = (osPriority_t) osPriorityNormal,
 };
 
 const osThreadAttr_t TxTask_attributes = {
       .name = "TxTask",
-      .stack_size = 256 * 4,
+      MEM_CCMRAM_THREAD_ATTR(TxTask),
       .priority = (osPriority_t) osPriorityNormal,
 };
 
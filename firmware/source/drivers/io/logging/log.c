@@ -15,6 +15,7 @@
 #include "log.h"
 
 #include "lwprintf/lwprintf.h"
+#include "mem_layout.h"
 
 
 /******************************************************************************/
@@ -30,8 +31,8 @@
 osMessageQueueId_t consoleQueueHandle;
 osMessageQueueId_t logsQueueHandle;
 
-static lwprintf_t console_print;
-static lwprintf_t logs;
+static lwprintf_t console_print MEM_CCMRAM;
+static lwprintf_t logs MEM_CCMRAM;
 
 const osMessageQueueAttr_t consoleQueueAttributes = {
         .name = "consoleQueue",
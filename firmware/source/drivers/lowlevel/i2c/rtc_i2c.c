@@ -39,6 +39,8 @@
 #define I2C_REQUEST_READ              (0x01)
 
 #define I2C_BUFFER_SIZE               (8u)
+/* Write of full buffer takes ~0.25 ms at 400 kHz */
+#define I2C_TX_TIMEOUT_MS             (10u)
 
 #define RTC_I2C_NUM_OF_MODES          (255u)
 
@@ -275,6 +277,58 @@ uint8_t RtcI2cGetTime(RTC_TIME_t *time)
 
 
 
+/**
+ * @brief          RTC I2C get date and time in one transfer
+ * @param[in]      date: pointer to @ref RTC_DATE_t structure
+ * @param[in]      time: pointer to @ref RTC_TIME_t structure
+ * @return         Current error instance
+ *
+ * Registers from seconds to year are read at once, DS3231 latches them
+ * on START condition, so midnight can not pass between time and date.
+ */
+uint8_t RtcI2cGetDateTime(RTC_DATE_t *date, RTC_TIME_t *time)
+{
+  uint8_t read_buffer[7];
+  uint8_t rc;
+
+  rc = osSemaphoreAcquire(RtcI2cSemphoreHandle, osWaitForever);
+  if (rc != osOK)
+    return RTC_I2C_RECEIVE_ERROR;
+
+  rc = RtcI2cReadBufferInterrupt(RTC_HW_ADDRESS, RTC_REG_SECONDS, read_buffer, sizeof(read_buffer));
+
+  if (rc != RTC_OK)
+  {
+    osSemaphoreRelease(RtcI2cSemphoreHandle);
+    return rc;
+  }
+
+  time->ms = prvGetTicks();
+  if (time->ms > 999)
+    time->ms = 999;
+
+  time->seconds = ((read_buffer[0] >> 4) * 10) + (read_buffer[0] & 0x0F);
+  time->minutes = ((read_buffer[1] >> 4) * 10) + (read_buffer[1] & 0x0F);
+
+  if (read_buffer[2] & 0x40)
+    time->hours = ((read_buffer[2] & 0x10) ? 10 : 0) + (read_buffer[2] & 0x0F);
+  else
+    time->hours = ((read_buffer[2] & 0x20) ? 20 : 0) + ((read_buffer[2] & 0x10) ? 10 : 0) + (read_buffer[2] & 0x0F);
+
+  date->day   = read_buffer[3];
+  date->date  = ((read_buffer[4] >> 4) * 10) + (read_buffer[4] & 0x0F);
+  date->month = ((read_buffer[5] & 0x10) ? 10 : 0) + (read_buffer[5] & 0x0F);
+  date->year  = 2000 + ((read_buffer[5] & 0x80) ? 100 : 0) + ((read_buffer[6] >> 4) * 10) + (read_buffer[6] & 0x0F);
+
+  osSemaphoreRelease(RtcI2cSemphoreHandle);
+
+  return RTC_OK;
+}
+/******************************************************************************/
+
+
+
+
 /**
  * @brief          RTC I2C set date
  * @param[in]      date: pointer to @ref RTC_DATE_t structure
@@ -327,6 +381,96 @@ uint8_t RtcI2cSetTime(RTC_TIME_t *time)
 
 
 
+/**
+ * @brief          RTC I2C set date and time in one transfer
+ * @param[in]      date: pointer to @ref RTC_DATE_t structure, year of century
+ * @param[in]      time: pointer to @ref RTC_TIME_t structure
+ * @return         Current error instance
+ *
+ * Registers from seconds to year are written at once, so time can not
+ * roll over between time and date writes.
+ */
+uint8_t RtcI2cSetDateTime(RTC_DATE_t *date, RTC_TIME_t *time)
+{
+  uint8_t write_buffer[7];
+  uint8_t rc;
+
+  rc = osSemaphoreAcquire(RtcI2cSemphoreHandle, osWaitForever);
+  if (rc != osOK)
+    return RTC_I2C_TRANSMIT_ERROR;
+
+  write_buffer[0] = ((time->seconds / 10) << 4) | ((time->seconds % 10) & 0x0F);
+  write_buffer[1] = ((time->minutes / 10) << 4) | ((time->minutes % 10) & 0x0F);
+  write_buffer[2] = ((time->hours   / 10) << 4) | ((time->hours   % 10) & 0x0F);
+  write_buffer[3] = date->day & 0x07;
+  write_buffer[4] = ((date->date  / 10) << 4) | ((date->date  % 10) & 0x0F);
+  write_buffer[5] = ((date->month / 10) << 4) | ((date->month % 10) & 0x0F);
+  write_buffer[6] = ((date->year  / 10) << 4) | ((date->year  % 10) & 0x0F);
+
+  rc = RtcI2cWriteBufferInterrupt(RTC_HW_ADDRESS, RTC_REG_SECONDS, write_buffer, sizeof(write_buffer));
+
+  osSemaphoreRelease(RtcI2cSemphoreHandle);
+  return rc;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          RTC I2C get aging offset
+ * @param[in]      aging: pointer to aging offset, signed, ~0.1 ppm per LSB
+ * @return         Current error instance
+ */
+uint8_t RtcI2cGetAging(int8_t *aging)
+{
+  uint8_t rc;
+
+  rc = osSemaphoreAcquire(RtcI2cSemphoreHandle, osWaitForever);
+  if (rc != osOK)
+    return RTC_I2C_RECEIVE_ERROR;
+
+  rc = RtcI2cReadBufferInterrupt(RTC_HW_ADDRESS, RTC_REG_AGING_OFFSET, (uint8_t *)aging, 1);
+
+  osSemaphoreRelease(RtcI2cSemphoreHandle);
+  return rc;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          RTC I2C set aging offset
+ * @param[in]      aging: aging offset, positive value slows oscillator down
+ * @return         Current error instance
+ *
+ * Temperature conversion is started to apply new offset immediately,
+ * otherwise it is applied on the next conversion up to 64 s later.
+ */
+uint8_t RtcI2cSetAging(int8_t aging)
+{
+  uint8_t value = (uint8_t)aging;
+  uint8_t control = RTC_CONTROL_CONV;
+  uint8_t rc;
+
+  rc = osSemaphoreAcquire(RtcI2cSemphoreHandle, osWaitForever);
+  if (rc != osOK)
+    return RTC_I2C_TRANSMIT_ERROR;
+
+  rc = RtcI2cWriteBufferInterrupt(RTC_HW_ADDRESS, RTC_REG_AGING_OFFSET, &value, 1);
+
+  if (rc == RTC_OK)
+    rc = RtcI2cWriteBufferInterrupt(RTC_HW_ADDRESS, RTC_REG_CONTROL, &control, 1);
+
+  osSemaphoreRelease(RtcI2cSemphoreHandle);
+  return rc;
+}
+/******************************************************************************/
+
+
+
+
 /**
  * @brief          RTC I2C read buffer with interrupt
  * @param[in]      device: number of I2C device
@@ -377,6 +521,8 @@ uint8_t RtcI2cReadBufferInterrupt(uint8_t device, uint8_t address, uint8_t *buff
  * @param[in]      buffer: pointer to @ref buffer to write from
  * @param[in]      length: length of writing message in bytes
  * @return         Current error instance
+ *
+ * Returns when transfer is finished, buffer of driver is free for the next one.
  */
 uint8_t RtcI2cWriteBufferInterrupt(uint8_t device, uint8_t address, uint8_t *buffer, uint8_t length)
 {
@@ -402,6 +548,18 @@ uint8_t RtcI2cWriteBufferInterrupt(uint8_t device, uint8_t address, uint8_t *buf
   if (res != RTC_OK)
     return RTC_I2C_TRANSMIT_ERROR;
 
+  //Cleared by IRQ when the last byte is sent
+  for (uint8_t i = 0; rtc_i2c.mode_write; i++)
+  {
+    if (i >= I2C_TX_TIMEOUT_MS)
+    {
+      prvStopTx();
+      res = RTC_I2C_TRANSMIT_ERROR;
+      break;
+    }
+    osDelay(1);
+  }
+
   osMutexRelease(RtcI2cMutexHandle);
 
   return res;
@@ -16,6 +16,8 @@
 
 #include "rtc.h"
 #include "rtc_i2c.h"
+#include "mem_layout.h"
+#include "time_sync.h"
 
 
 /******************************************************************************/
@@ -28,9 +30,11 @@
 /******************************************************************************/
 osThreadId_t RtcTaskHandle;
 
+MEM_CCMRAM_THREAD(RtcTask, 128 * 4);
+
 const osThreadAttr_t RtcTask_attributes = {
     .name = "RtcTask",
-    .stack_size = 128 * 4,
+    MEM_CCMRAM_THREAD_ATTR(RtcTask),
     .priority = (osPriority_t) osPriorityNormal,
 };
 
@@ -70,6 +74,8 @@ void RtcTask(void *argument)
 
   for (;;)
   {
+    //Time for timestamps is read here, not in tasks asking for it
+    TimeSync_LoadRtc();
 
     if (RtcGetError() != RTC_OK)
     {
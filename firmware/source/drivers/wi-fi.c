@@ -25,6 +25,11 @@
 #include "log.h"
 #include "io_system.h"
 #include "config.h"
+#include "mem_layout.h"
+#include "mqtt_client.h"
+#include "mqtt_broker.h"
+#include "backoff.h"
+#include "time_sync.h"
 
 /******************************************************************************/
 /* Private defines ---------------------------------------------------------- */
@@ -55,6 +60,24 @@
 
 #define WIFI_RECEIVE_TIMEOUT         (1000u)
 
+#define WIFI_RETRY_MIN_MS            (1000u)
+#define WIFI_RETRY_MAX_MS            (60000u)
+
+/* Station task thread flags, flag 0x01 is used by backoff */
+#define WIFI_FLAG_LINK_DOWN          (0x00000002u)
+#define WIFI_FLAG_GOT_IP             (0x00000004u)
+#define WIFI_FLAGS_LINK              (WIFI_FLAG_LINK_DOWN | WIFI_FLAG_GOT_IP)
+
+#define WIFI_EVT_MASK                (ESP_EVT_MASK(ESP_EVT_AT_VERSION_NOT_SUPPORTED) | ESP_EVT_MASK(ESP_EVT_INIT_FINISH) | \
+                                      ESP_EVT_MASK(ESP_EVT_RESET_DETECTED) | ESP_EVT_MASK(ESP_EVT_RESET) | \
+                                      ESP_EVT_MASK(ESP_EVT_RESTORE) | ESP_EVT_MASK(ESP_EVT_CMD_TIMEOUT) | \
+                                      ESP_EVT_MASK(ESP_EVT_WIFI_CONNECTED) | ESP_EVT_MASK(ESP_EVT_WIFI_GOT_IP) | \
+                                      ESP_EVT_MASK(ESP_EVT_WIFI_DISCONNECTED) | ESP_EVT_MASK(ESP_EVT_WIFI_IP_ACQUIRED) | \
+                                      ESP_EVT_MASK(ESP_EVT_STA_LIST_AP) | ESP_EVT_MASK(ESP_EVT_STA_JOIN_AP) | \
+                                      ESP_EVT_MASK(ESP_EVT_STA_INFO_AP) | ESP_EVT_MASK(ESP_EVT_PING) | \
+                                      ESP_EVT_MASK(ESP_EVT_AP_CONNECTED_STA) | ESP_EVT_MASK(ESP_EVT_AP_DISCONNECTED_STA) | \
+                                      ESP_EVT_MASK(ESP_EVT_AP_IP_STA) | ESP_EVT_MASK(ESP_EVT_SERVER))
+
 /******************************************************************************/
 /* Private variables -------------------------------------------------------- */
 /******************************************************************************/
@@ -62,15 +85,18 @@
 osThreadId_t WiFiApTaskHandle;
 osThreadId_t WiFiStTaskHandle;
 
+MEM_CCMRAM_THREAD(WifiApTask, 512 * 4);
+MEM_CCMRAM_THREAD(WifiStTask, 512 * 4);
+
 const osThreadAttr_t WifiApTask_attributes = {
       .name = "WifiApTask",
-      .stack_size = 512 * 4,
+      MEM_CCMRAM_THREAD_ATTR(WifiApTask),
       .priority = (osPriority_t) osPriorityNormal,
 };
 
 const osThreadAttr_t WifiStTask_attributes = {
       .name = "WifiStTask",
-      .stack_size = 512 * 4,
+      MEM_CCMRAM_THREAD_ATTR(WifiStTask),
       .priority = (osPriority_t) osPriorityNormal,
 };
 #endif /* WIFI_CMSIS_OS2_ENA */
@@ -109,6 +135,8 @@ typedef struct
   bool sta_ready;
   bool host_connected;
   bool rd_ok;
+
+  BACKOFF_t backoff;
 } WIFI_DATA_t;
 
 static WIFI_DATA_t wifi;
@@ -119,21 +147,19 @@ static WIFI_DATA_t wifi;
 /******************************************************************************/
 uint8_t prvWiFiResetWithDelay(void);
 uint8_t prvWiFiSetMode(uint8_t mode);
-uint8_t prvWiFiListAp(esp_ap_t *access_point, size_t *access_point_find, size_t apsl);
-uint8_t prvWiFiAccessPointsFound(size_t access_point_find, esp_ap_t *access_point, bool *config_ap_found);
+uint8_t prvWiFiListAp(bool *config_ap_found);
+static uint8_t prvWiFiApFoundCallback(const esp_ap_t *access_point, void *argument);
 uint8_t prvWiFiStaJoin(void);
+uint8_t prvWiFiStaFastJoin(void);
+void prvWiFiStaCache(void);
 uint8_t prvWiFiCopyIp(esp_ip_t *ip);
+void prvWiFiStNotify(uint32_t flags);
 uint8_t prvWiFiStaIsJoined(void);
 uint8_t prvWiFiPing(void);
 uint8_t prvWiFiParseIp(const char **str, esp_ip_t *ip);
 uint8_t prvWiFiSetIp(esp_ip_t *ip, esp_ip_t *gw, esp_ip_t *nm);
 uint8_t prvWiFiApConfigure(const char *ssid, const char *password, uint8_t channel, esp_ecn_t encryption, uint8_t max_stations, uint8_t hide, uint8_t def, const esp_api_cmd_evt_fn evt_fn, void *const evt_argument, const uint32_t blocking);
 uint8_t prvWiFiApListSta(esp_sta_t *stations, size_t *stations_quantity, const uint32_t blocking, size_t stal);
-uint8_t prvWiFiConnectionNew(WIFI_DATA_t *wifi);
-uint8_t prvWiFiBindConnection(esp_netconn_p netconnection_server, uint16_t port);
-uint8_t prvWiFiListenConnection(esp_netconn_p netconnection_server);
-uint8_t prvWiFiAcceptConnection(esp_netconn_p netconnection_server, esp_netconn_p *netconnection_client);
-uint8_t prvWiFiReceiveConnection(esp_netconn_p netconnection_client, esp_pbuf_p* pbuf);
 uint8_t prvWiFiCloseConnection(esp_conn_p connection, const uint32_t blocking);
 
 #if !WIFI_USE_LWESP
@@ -142,8 +168,6 @@ char *ESPErrorHandler(espr_t error);
 #endif
 
 void prvWiFiStationList(esp_sta_t *stations, size_t stations_quantity);
-void prvWiFiSetReceiveTimeout(esp_netconn_p netconnection_client, uint32_t timeout);
-void prvWiFiConcatenatePacketBuffers(esp_pbuf_p head, const esp_pbuf_p tail);
 void prvWiFiFreePacketBuffer(esp_pbuf_p packet_buffer);
 void prvWiFiNetConnectionClose(esp_netconn_p netconnection_client);
 void prvWiFiNetConnectionDelete(esp_netconn_p netconnection_client);
@@ -168,6 +192,12 @@ void WiFiInit(void)
 
   if (output != espOK)
     PrintfLogsCRLF(CLR_RD"ESP init FAIL! (%s)"CLR_DEF, ESPErrorHandler(output));
+  else
+  {
+    esp_evt_set_mask(esp_callback_function, WIFI_EVT_MASK);
+    /* Poll tick is needed only by MQTT client, it enables it while connected */
+    esp_conn_set_poll_interval(0);
+  }
 
 #if WIFI_CMSIS_OS2_ENA
   WiFiStTaskHandle = NULL;
@@ -257,24 +287,28 @@ void WiFiApTask(void *argument)
 
   uint8_t res = espOK;
 
+  Backoff_Init(&wifi.backoff, WIFI_RETRY_MIN_MS, WIFI_RETRY_MAX_MS);
+
   for (;;)
   {
+    //Previous attempt failed, wait before the next one
+    if (res != espOK)
+      Backoff_Wait(&wifi.backoff);
+
     if (WiFiGetError() != WIFI_OK)
     {
       WiFiErrorHandler(WiFiGetError());
+      res = espERR;
       continue;
     }
 
-    wifi.netconnection_server = NULL;
-    wifi.netconnection_client = NULL;
-
     res = prvWiFiResetWithDelay();
 
     if (res != espOK)
       continue;
 
     wifi.ap_ready = false;
-    esp_sta_t stations[1];
+    esp_sta_t stations[MQTT_BROKER_MAX_CLIENTS];
     size_t stations_quantity;
 
     res = prvWiFiSetMode(ESP_MODE_AP);
@@ -322,77 +356,23 @@ void WiFiApTask(void *argument)
       continue;
 
     prvWiFiStationList(stations, stations_quantity);
-    res = prvWiFiConnectionNew(&wifi);
-
-    if (res != espOK)
-      continue;
-
-    res = prvWiFiBindConnection(wifi.netconnection_server, config.mqtt.port);
+    res = MQTTBroker_Start(config.mqtt.port);
 
     if (res != espOK)
       continue;
 
-    res = prvWiFiListenConnection(wifi.netconnection_server);
-
-    if (res != espOK)
-      continue;
+    Backoff_Reset(&wifi.backoff);
+    wifi.ap_ready = true;
 
     for (;;)
     {
-      res = prvWiFiAcceptConnection(wifi.netconnection_server, &wifi.netconnection_client);
-
-      if (res != espOK)
-      {
-        if (wifi.restart)
-        {
-          wifi.restart = false;
-          break;
-        }
-        continue;
-      }
-
-      wifi.host_connected = true;
-      esp_pbuf_p packet_buffer = NULL;
-
-      prvWiFiSetReceiveTimeout(wifi.netconnection_client, WIFI_RECEIVE_TIMEOUT);
-
-      for (;;)
-      {
-        res = prvWiFiReceiveConnection(wifi.netconnection_client, &packet_buffer);
+      MQTTBroker_Process(WIFI_RECEIVE_TIMEOUT);
 
-        if (res == espTIMEOUT)
-        {
-          if (!wifi.host_connected)
-            break;
-          if (wifi.restart)
-            break;
-        }
-        else if (res != espOK)
-          break;
-
-        PrintfLogsCRLF(CLR_GR"NETCONN data received, %u/%u bytes"CLR_DEF, (int) esp_pbuf_length(packet_buffer, 1), (int) esp_pbuf_length(packet_buffer, 0));
-
-        if (wifi.packet_buffer == NULL)
-          wifi.packet_buffer = packet_buffer;
-        else
-          prvWiFiConcatenatePacketBuffers(wifi.packet_buffer, packet_buffer);
-
-        //TODO WRITE BROKET PARSER
-
-        prvWiFiFreePacketBuffer(wifi.packet_buffer);
-        wifi.packet_buffer = NULL;
-      }
-
-      if (wifi.netconnection_client)
-      {
-        prvWiFiNetConnectionClose(wifi.netconnection_client);
-        prvWiFiNetConnectionDelete(wifi.netconnection_client);
-        wifi.netconnection_client = NULL;
-      }
-      if (wifi.packet_buffer != NULL)
+      if (wifi.restart)
       {
-        prvWiFiFreePacketBuffer(wifi.packet_buffer);
-        wifi.packet_buffer = NULL;
+        wifi.restart = false;
+        MQTTBroker_Stop();
+        break;
       }
     }
   }
@@ -413,100 +393,116 @@ void WiFiStTask(void *argument)
   while (!wifi.esp_ready)
     osDelay(100);
 
-  uint8_t errors_scan_ap   = 0;
-  uint8_t errors_join_st   = 0;
-  uint8_t errors_net_check = 0;
   uint8_t res = espOK;
 
+  Backoff_Init(&wifi.backoff, WIFI_RETRY_MIN_MS, WIFI_RETRY_MAX_MS);
+
   for (;;)
   {
     if (WiFiGetError() != WIFI_OK)
     {
       WiFiErrorHandler(WiFiGetError());
+      Backoff_Wait(&wifi.backoff);
       continue;
     }
 
     wifi.connection = NULL;
+    uint32_t connect_start = osKernelGetTickCount();
 
     //WiFi reset with delay
     res = prvWiFiResetWithDelay();
 
     if (res != espOK)
+    {
+      Backoff_Wait(&wifi.backoff);
       continue;
-
-    esp_ap_t access_point[10];
-    size_t access_point_find;
+    }
 
     //WiFi set mode ST
     res = prvWiFiSetMode(ESP_MODE_STA);
 
     if (res != espOK)
+    {
+      Backoff_Wait(&wifi.backoff);
       continue;
+    }
+
+    //WiFi join last good access point directly, scan only if it fails
+    bool fast_join = config.wifi.fast_join && config.wifi.channel != 0;
+
+    if (fast_join)
+    {
+      res = prvWiFiStaFastJoin();
+
+      if (res != espOK)
+      {
+        //Drop cache, next attempt starts from reset with DHCP and full scan
+        config.wifi.channel = 0;
+        continue;
+      }
+    }
 
     //WiFi start searching for access point
-    bool config_ap_found = false;
+    bool config_ap_found = fast_join;
 
     while (!config_ap_found)
     {
       PrintfLogsCRLF("WiFi Access points scanning ...");
       IndicationLedYellowBlink(5);
 
-      res = prvWiFiListAp(access_point, &access_point_find, ESP_ARRAYSIZE(access_point));
-
-      if (res != espOK)
-        continue;
-
-      //WiFi check founded access points
-      res = prvWiFiAccessPointsFound(access_point_find, access_point, &config_ap_found);
+      //WiFi scan stops reporting access points when configured one is found
+      res = prvWiFiListAp(&config_ap_found);
 
-      if (!config_ap_found)
+      if (res != espOK || !config_ap_found)
       {
-        osDelay(5000);
-        if (++errors_scan_ap > WIFI_MAX_SCAN_ERRORS)
-        {
-          osDelay(60000);
-          errors_scan_ap = 0;
-          continue;
-        }
+        config_ap_found = false;
+        Backoff_Wait(&wifi.backoff);
+        continue;
       }
 
-      errors_scan_ap = 0;
       IndicationLedYellowBlink(2);
       PrintfLogsCRLF("WiFi connecting to \"%s\" network ...", config.wifi.ssid);
 
       //WiFi join as station to access point
       res = prvWiFiStaJoin();
 
-      if (res != espOK)
+      //WiFi copy IP
+      if (res == espOK)
       {
-        config_ap_found = false;
-        osDelay(1000);
-        if (++errors_join_st > WIFI_MAX_JOIN_ERRORS)
-        {
-          osDelay(30000);
-          errors_join_st = 0;
-          continue;
-        }
-        else
-          continue;
+        esp_ip_t ip;
+        res = prvWiFiCopyIp(&ip);
       }
 
-      //WiFi copy IP
-      esp_ip_t ip;
-      res = prvWiFiCopyIp(&ip);
-
-      errors_join_st = 0;
-
       if (res != espOK)
-        continue;
+      {
+        config_ap_found = false;
+        Backoff_Wait(&wifi.backoff);
+      }
     }
 
+    Backoff_Reset(&wifi.backoff);
+    prvWiFiStaCache();
+    PrintfLogsCRLF(CLR_GR"WiFi joined in %lu ms (%s)"CLR_DEF, (unsigned long)(osKernelGetTickCount() - connect_start),
+                   fast_join ? "fast join" : "full scan");
+
     PrintfLogsCRLF("Checking \"%s\" for internet connection ...", config.wifi.ssid);
 
+    //Link supervision, task sleeps until ESP event or next internet check
+    uint32_t check_delay = 0;
+    osThreadFlagsClear(WIFI_FLAGS_LINK);
+
     for (;;)
     {
-      if (!prvWiFiStaIsJoined())
+      uint32_t flags = osThreadFlagsWait(WIFI_FLAGS_LINK, osFlagsWaitAny, check_delay);
+
+      if (flags & osFlagsError)
+        flags = 0;
+
+      if ((flags & WIFI_FLAG_LINK_DOWN) || !prvWiFiStaIsJoined())
+      {
+        PrintfLogsCRLF(CLR_YL"WiFi link to \"%s\" lost"CLR_DEF, config.wifi.ssid);
         break;
+      }
 
       if (wifi.restart)
       {
@@ -514,39 +510,49 @@ void WiFiStTask(void *argument)
         break;
       }
 
-      if (!wifi.sta_ready)
-      {
-        res = prvWiFiPing();
+      //Check timeout expired or new IP lease, check internet now
+      res = prvWiFiPing();
+
+      //Broker answers keep-alive, lost ping is not worth new TLS handshake
+      if (res != espOK && MQTTClient_IsConnected())
+        res = espOK;
 
-        if (res != espOK)
+      if (res != espOK)
+      {
+        if (wifi.sta_ready)
         {
-          if (++errors_net_check > WIFI_MAX_NET_CHECK_ERRORS)
-          {
-            errors_net_check = 0;
-            continue;
-          }
-          else
-          {
-            osDelay(1000);
-            continue;
-          }
+          PrintfLogsCRLF(CLR_RD"Internet connection \"%s\" lost!"CLR_DEF, config.wifi.ssid);
+          MQTTClient_Stop();
+          wifi.sta_ready = false;
         }
+        check_delay = Backoff_Next(&wifi.backoff);
+        continue;
+      }
 
-        errors_net_check = 0;
+      Backoff_Reset(&wifi.backoff);
+      check_delay = (uint32_t)config.wifi.net_check_s * 1000u;
+
+      if (!wifi.sta_ready)
+      {
         IndicationLedYellowBlink(3);
         wifi.sta_ready = true;
 
-        PrintfLogsCRLF(CLR_GR"Internet connection \"%s\" OK"CLR_DEF, config.wifi.ssid);
+        PrintfLogsCRLF(CLR_GR"Internet connection \"%s\" OK, connected in %lu ms"CLR_DEF, config.wifi.ssid,
+                       (unsigned long)(osKernelGetTickCount() - connect_start));
 
-//        if (!mqtt_wifi_transport && !esp8266_onair)
-//        {
-//          PrintfLogsCRLF(CLR_GR"Switching MQTT transport to WiFi"CLR_DEF);
-//          MQTTClient_Stop();
-//        }
+        MQTTClient_Start();
+      }
+      else if (!MQTTClient_IsConnected())
+      {
+        //Broker closed connection, open it again
+        MQTTClient_Start();
       }
 
-      osDelay(100);
+      TimeSync_Request();
     }
+
+    MQTTClient_Stop();
+    wifi.sta_ready = false;
   }
 
   osThreadTerminate(NULL);
@@ -1100,16 +1106,18 @@ uint8_t prvWiFiSetMode(uint8_t mode)
 
 
 /**
- * @brief          Wi-Fi ST_mode list of access points
+ * @brief          Wi-Fi ST_mode scan of access points
+ * @param[out]     config_ap_found: Set to true when configured access point is found
  * @return         Current espr_t struct state
  */
-uint8_t prvWiFiListAp(esp_ap_t *access_point, size_t *access_point_find, size_t apsl)
+uint8_t prvWiFiListAp(bool *config_ap_found)
 {
   uint8_t res = espOK;
 
-  res = esp_sta_list_ap(NULL, access_point, apsl, access_point_find, NULL, NULL, 1);
+  res = esp_sta_scan_ap(NULL, 0, prvWiFiApFoundCallback, config_ap_found, NULL, NULL, 1);
 
   PrintfLogsCRLF(CLR_DEF"WiFi Access point scan: (%s)"CLR_DEF, ESPErrorHandler(res));
+  PrintfLogsCRLF("WiFi Access point \"%s\" is (%s)"CLR_DEF, config.wifi.ssid, *config_ap_found ? "found" : "not found");
 
   return res;
 }
@@ -1119,24 +1127,24 @@ uint8_t prvWiFiListAp(esp_ap_t *access_point, size_t *access_point_find, size_t
 
 
 /**
- * @brief          Wi-Fi access poits check
- * @return         Current espr_t struct state
+ * @brief          Wi-Fi access point found during scan, called from ESP thread
+ * @param[in]      access_point: Found access point
+ * @param[out]     argument: Pointer to bool, set to true when configured access point is found
+ * @return         0 to stop reporting access points, 1 to continue
  */
-uint8_t prvWiFiAccessPointsFound(size_t access_point_find, esp_ap_t *access_point, bool *config_ap_found)
+static uint8_t prvWiFiApFoundCallback(const esp_ap_t *access_point, void *argument)
 {
-  uint8_t res = espOK;
+  bool *config_ap_found = argument;
 
-  for (uint8_t i = 0; i < access_point_find; i++)
-  {
-    PrintfLogsCRLF(CLR_GR"Wifi AP found: \"%s\", RSSI: %i dBm"CLR_DEF, access_point[i].ssid, access_point[i].rssi);
+  PrintfLogsCRLF(CLR_GR"Wifi AP found: \"%s\", RSSI: %i dBm"CLR_DEF, access_point->ssid, access_point->rssi);
 
-    if (strcmp(config.wifi.ssid, access_point[i].ssid) == 0)
-      *config_ap_found = true;
+  if (strcmp(config.wifi.ssid, access_point->ssid) == 0)
+  {
+    *config_ap_found = true;
+    return 0;
   }
 
-  PrintfLogsCRLF("WiFi Access point \"%s\" is (%s)"CLR_DEF, config.wifi.ssid, ESPErrorHandler(res));
-
-  return res;
+  return 1;
 }
 /******************************************************************************/
 
@@ -1158,6 +1166,63 @@ uint8_t prvWiFiStaJoin(void)
   return res;
 }
 /******************************************************************************/
+uint8_t prvWiFiStaFastJoin(void)
+{
+  uint8_t res = espOK;
+  esp_mac_t bssid;
+  esp_ip_t ip;
+
+  memcpy(bssid.mac, config.wifi.bssid, sizeof(bssid.mac));
+
+  PrintfLogsCRLF("WiFi fast join to \"%s\" (%02X:%02X:%02X:%02X:%02X:%02X, channel %u) ...", config.wifi.ssid,
+                 bssid.mac[0], bssid.mac[1], bssid.mac[2], bssid.mac[3], bssid.mac[4], bssid.mac[5],
+                 (unsigned)config.wifi.channel);
+
+  //Cached lease as static IP skips DHCP
+  if (config.wifi.fast_static_ip)
+  {
+    esp_ip_t gw, nm;
+
+    memcpy(ip.ip, config.wifi.ip, sizeof(ip.ip));
+    memcpy(gw.ip, config.wifi.gw, sizeof(gw.ip));
+    memcpy(nm.ip, config.wifi.nm, sizeof(nm.ip));
+    res = esp_sta_setip(&ip, &gw, &nm, WIFI_NOT_DEFAULT, NULL, NULL, WIFI_BLOCKING);
+
+    if (res != espOK)
+    {
+      PrintfLogsCRLF(CLR_RD"WiFi static IP set FAIL! (%s)"CLR_DEF, ESPErrorHandler(res));
+      return res;
+    }
+  }
+
+  res = esp_sta_join(config.wifi.ssid, config.wifi.passw, &bssid, WIFI_NOT_DEFAULT, NULL, NULL, WIFI_BLOCKING);
+  PrintfLogsCRLF(CLR_DEF"WiFi fast join (%s)"CLR_DEF, ESPErrorHandler(res));
+
+  if (res != espOK)
+    return res;
+
+  return prvWiFiCopyIp(&ip);
+}
+/******************************************************************************/
+void prvWiFiStaCache(void)
+{
+  esp_sta_info_ap_t info;
+  esp_ip_t ip, gw, nm;
+
+  if (esp_sta_get_ap_info(&info, NULL, NULL, WIFI_BLOCKING) != espOK ||
+      esp_sta_copy_ip(&ip, &gw, &nm) != espOK)
+  {
+    config.wifi.channel = 0;
+    return;
+  }
+
+  memcpy(config.wifi.bssid, info.mac.mac, sizeof(config.wifi.bssid));
+  memcpy(config.wifi.ip, ip.ip, sizeof(config.wifi.ip));
+  memcpy(config.wifi.gw, gw.ip, sizeof(config.wifi.gw));
+  memcpy(config.wifi.nm, nm.ip, sizeof(config.wifi.nm));
+  config.wifi.channel = info.ch;
+}
+/******************************************************************************/
 
 
 
@@ -1205,6 +1270,19 @@ uint8_t prvWiFiCopyIp(esp_ip_t *ip)
   return res;
 }
 /******************************************************************************/
+void prvWiFiStNotify(uint32_t flags)
+{
+#if WIFI_CMSIS_OS2_ENA
+  osThreadId_t st_task = WiFiStTaskHandle;
+
+  //Wake station task supervising the link
+  if (st_task != NULL)
+    osThreadFlagsSet(st_task, flags);
+#else
+  (void)flags;
+#endif /* WIFI_CMSIS_OS2_ENA */
+}
+/******************************************************************************/
 
 
 
@@ -1322,105 +1400,6 @@ void prvWiFiStationList(esp_sta_t *stations, size_t stations_quantity)
 
 
 
-/**
- * @brief          Wi-Fi create new netconn connection
- * @return         Current espr_t struct state
- */
-uint8_t prvWiFiConnectionNew(WIFI_DATA_t *wifi)
-{
-  wifi->ap_ready = true;
-  wifi->netconnection_server = esp_netconn_new(ESP_NETCONN_TYPE_TCP);
-
-  if (wifi->netconnection_server == NULL)
-  {
-    PrintfLogsCRLF(CLR_RD"Cannot create netconn_server NETCONN"CLR_DEF);
-    if (wifi->netconnection_server)
-    {
-      prvWiFiNetConnectionClose(wifi->netconnection_server);
-      prvWiFiNetConnectionDelete(wifi->netconnection_server);
-    }
-    return espERRCONNFAIL;
-  }
-
-  return espOK;
-}
-/******************************************************************************/
-
-
-
-
-/**
- * @brief          Wi-Fi bind a connection to a specific port
- * @return         Current espr_t struct state
- */
-uint8_t prvWiFiBindConnection(esp_netconn_p netconnection_server, uint16_t port)
-{
-  uint8_t res = espOK;
-
-  res = esp_netconn_bind(netconnection_server, port);
-
-  PrintfLogsCRLF(CLR_DEF"Netconn on port %u (%s)"CLR_DEF, config.mqtt.port, ESPErrorHandler(res));
-
-  return res;
-}
-/******************************************************************************/
-
-
-
-
-/**
- * @brief          Wi-Fi listen on previously binded connection
- * @return         Current espr_t struct state
- */
-uint8_t prvWiFiListenConnection(esp_netconn_p netconnection_server)
-{
-  uint8_t res = espOK;
-
-  res = esp_netconn_listen(netconnection_server);
-
-  PrintfLogsCRLF(CLR_DEF"Listening to net connection (%s)"CLR_DEF, ESPErrorHandler(res));
-
-  return res;
-}
-/******************************************************************************/
-
-
-
-
-/**
- * @brief          Wi-Fi accept a new connection
- * @return         Current espr_t struct state
- */
-uint8_t prvWiFiAcceptConnection(esp_netconn_p netconnection_server, esp_netconn_p *netconnection_client)
-{
-  uint8_t res = espOK;
-
-  res = esp_netconn_accept(netconnection_server, netconnection_client);
-
-  PrintfLogsCRLF(CLR_DEF"Accept to new connection (%s)"CLR_DEF, ESPErrorHandler(res));
-
-  return res;
-}
-/******************************************************************************/
-
-
-
-
-/**
- * @brief          Wi-Fi set timeout for receiving data
- * @return         NONE
- */
-void prvWiFiSetReceiveTimeout(esp_netconn_p netconnection_client, uint32_t timeout)
-{
-
-  esp_netconn_set_receive_timeout(netconnection_client, timeout);
-  PrintfLogsCRLF(CLR_DEF"Receive timeout is set to"CLR_GR "(%u)" "seconds"CLR_DEF, timeout);
-}
-/******************************************************************************/
-
-
-
-
 /**
  * @brief          Wi-Fi free packet buffer
  * @return         NONE
@@ -1435,25 +1414,6 @@ void prvWiFiFreePacketBuffer(esp_pbuf_p packet_buffer)
 
 
 
-/**
- * @brief          Wi-Fi receive data from connection
- * @return         Current espr_t struct state
- */
-uint8_t prvWiFiReceiveConnection(esp_netconn_p netconnection_client, esp_pbuf_p* pbuf)
-{
-  uint8_t res = espOK;
-
-  res = esp_netconn_receive(netconnection_client, pbuf);
-
-  PrintfLogsCRLF(CLR_DEF"NETCONN data receiving (%s)"CLR_DEF, ESPErrorHandler(res));
-
-  return res;
-}
-/******************************************************************************/
-
-
-
-
 /**
  * @brief          Wi-Fi connection close
  * @return         Current espr_t struct state
@@ -1473,20 +1433,6 @@ uint8_t prvWiFiCloseConnection(esp_conn_p connection, const uint32_t blocking)
 
 
 
-/**
- * @brief          Wi-Fi concatenate 2 packet buffers together to one big packet
- * @return         NONE
- */
-void prvWiFiConcatenatePacketBuffers(esp_pbuf_p head, const esp_pbuf_p tail)
-{
-  esp_pbuf_cat(head, tail);
-  PrintfLogsCRLF(CLR_DEF"Concatenated 2 buffers into one");
-}
-/******************************************************************************/
-
-
-
-
 /**
  * @brief          Wi-Fi close netconn connection
  * @return         NONE
@@ -1536,7 +1482,9 @@ espr_t esp_callback_function(esp_evt_t* event)
         wifi.ap_ready = false;
         wifi.sta_ready = false;
         wifi.host_connected = false;
+        MQTTClient_EspReset();
         PrintfLogsCRLF("WiFi to reset ...");
+        prvWiFiStNotify(WIFI_FLAG_LINK_DOWN);
         break;
       }
       case ESP_EVT_RESET:
@@ -1545,6 +1493,7 @@ espr_t esp_callback_function(esp_evt_t* event)
         wifi.ap_ready = false;
         wifi.sta_ready = false;
         wifi.host_connected = false;
+        MQTTClient_EspReset();
         PrintfLogsCRLF(CLR_GR"WiFi reset OK"CLR_DEF);
         break;
       }
@@ -1554,6 +1503,7 @@ espr_t esp_callback_function(esp_evt_t* event)
         wifi.ap_ready = false;
         wifi.sta_ready = false;
         wifi.host_connected = false;
+        MQTTClient_EspReset();
         PrintfLogsCRLF(CLR_GR"WiFi restore OK"CLR_DEF);
         break;
       }
@@ -1565,18 +1515,21 @@ espr_t esp_callback_function(esp_evt_t* event)
       case ESP_EVT_WIFI_CONNECTED:
       {
         PrintfLogsCRLF(CLR_GR"WiFi AP connected OK"CLR_DEF);
-        wifi.sta_ready = true;
+        Backoff_Kick(&wifi.backoff);
         break;
       }
       case ESP_EVT_WIFI_GOT_IP:
       {
         PrintfLogsCRLF(CLR_GR"WiFi AP got IP"CLR_DEF);
+        Backoff_Kick(&wifi.backoff);
+        prvWiFiStNotify(WIFI_FLAG_GOT_IP);
         break;
       }
       case ESP_EVT_WIFI_DISCONNECTED:
       {
         PrintfLogsCRLF(CLR_RD"WiFi AP disconnected!"CLR_DEF);
         wifi.host_connected = false;
+        prvWiFiStNotify(WIFI_FLAG_LINK_DOWN);
 //        if (mqtt_wifi_transport)
 //          MQTTClient_Stop();
         break;
@@ -1620,6 +1573,7 @@ espr_t esp_callback_function(esp_evt_t* event)
         esp_mac_t *mac;
         mac = esp_evt_ap_connected_sta_get_mac(event);
         PrintfLogsCRLF(CLR_GR"WiFi station connected MAC %X:%X:%X:%X:%X:%X"CLR_DEF, mac->mac[0], mac->mac[1], mac->mac[2], mac->mac[3], mac->mac[4], mac->mac[5]);
+        Backoff_Kick(&wifi.backoff);
         break;
       }
       case ESP_EVT_AP_DISCONNECTED_STA:
@@ -34,6 +34,9 @@
 #include "rtc_i2c.h"
 #include "log.h"
 #include "config.h"
+#include "telemetry.h"
+#include "status.h"
+#include "time_sync.h"
 
 #include "lwprintf/lwprintf.h"
 #include "console.h"
@@ -42,10 +45,21 @@
 #include "FreeRTOS.h"
 #include "cmsis_os.h"
 
+#include "mem_layout.h"
+
 
 /******************************************************************************/
 /* Private variables -------------------------------------------------------- */
 /******************************************************************************/
+/* CCMRAM bounds from linker script */
+extern uint32_t _sccmram;
+extern uint32_t _eccmram;
+
+static StaticTask_t idle_task_cb MEM_CCMRAM;
+static StackType_t idle_task_stack[configMINIMAL_STACK_SIZE] MEM_CCMRAM;
+
+static StaticTask_t timer_task_cb MEM_CCMRAM;
+static StackType_t timer_task_stack[configTIMER_TASK_STACK_DEPTH] MEM_CCMRAM;
 
 
 /******************************************************************************/
@@ -65,6 +79,9 @@ void prvGPIOConfig(void);
  */
 int main(void)
 {
+  //Startup code clears .bss only, CCMRAM variables are zeroed here before use
+  memset(&_sccmram, 0, (size_t)((uint8_t *)&_eccmram - (uint8_t *)&_sccmram));
+
   prvInitializeMCU();
   osKernelInitialize();
   osKernelStart();
@@ -89,6 +106,10 @@ void prvInitializeMCU(void)
   IoSystemInit();
   RtcInitTask();
   ConfigInit();
+  //Before any task can publish, messages are stored while offline
+  Telemetry_Init();
+  Status_Init();
+  TimeSync_Init();
 }
 /******************************************************************************/
 
@@ -183,6 +204,36 @@ void prvGPIOConfig(void)
 
 
 
+/**
+ * @brief          Idle task memory in CCMRAM, called by kernel on start
+ */
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer,
+                                   uint32_t *pulIdleTaskStackSize)
+{
+  *ppxIdleTaskTCBBuffer = &idle_task_cb;
+  *ppxIdleTaskStackBuffer = idle_task_stack;
+  *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+/******************************************************************************/
+
+
+
+
+/**
+ * @brief          Timer task memory in CCMRAM, called by kernel on start
+ */
+void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer, StackType_t **ppxTimerTaskStackBuffer,
+                                    uint32_t *pulTimerTaskStackSize)
+{
+  *ppxTimerTaskTCBBuffer = &timer_task_cb;
+  *ppxTimerTaskStackBuffer = timer_task_stack;
+  *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+/******************************************************************************/
+
+
+
+
 
 /******************************************************************************/
 /*           Cortex-M4 Processor Interruption and Exception Handlers          */